@@ -30,6 +30,7 @@
 #include "itemset.h"
 #include "metadata.h"
 #include "vfolder.h"
+#include "xml.h"
 
 /* You can find a schema description used by this version of Liferea at:
    http://lzone.de/wiki/doku.php?id=liferea:v1.8:db_schema */
@@ -40,7 +41,17 @@ gboolean searchFolderRebuild = FALSE;
 /** hash of all prepared statements */
 static GHashTable *statements = NULL;
 
+/** item load statistics */
+static gulong itemLoadCount = 0;	/* full item loads */
+static gulong itemLightLoadCount = 0;	/* light item loads */
+static gulong itemDetailLoadCount = 0;	/* description/metadata loads for light items */
+
+/** item access latencies */
+static metricsHistogram itemLoadLatency;
+static metricsHistogram itemUpdateLatency;
+
 static void db_view_remove (const gchar *id);
+static void db_maintenance_stop (void);
 
 static void
 db_prepare_stmt (sqlite3_stmt **stmt, const gchar *sql) 
@@ -154,11 +165,19 @@ db_get_schema_version (void)
 	return schemaVersion;
 }
 
+/* Transactions can be nested, only the outermost one is
+   committed. This allows bulk updates spanning many calls
+   which use transactions on their own. */
+static guint transactionDepth = 0;
+
 static void
 db_begin_transaction (void)
 {
 	gchar	*sql, *err;
 	gint	res;
+
+	if (transactionDepth++ > 0)
+		return;
 	
 	sql = sqlite3_mprintf ("BEGIN");
 	res = sqlite3_exec (db, sql, NULL, NULL, &err);
@@ -173,6 +192,10 @@ db_end_transaction (void)
 {
 	gchar	*sql, *err;
 	gint	res;
+
+	g_return_if_fail (transactionDepth > 0);
+	if (--transactionDepth > 0)
+		return;
 	
 	sql = sqlite3_mprintf ("END");
 	res = sqlite3_exec (db, sql, NULL, NULL, &err);
@@ -182,53 +205,6 @@ db_end_transaction (void)
 	sqlite3_free (err);
 }
 
-#define VACUUM_ON_FRAGMENTATION_RATIO	10
-
-static void
-db_vacuum (void)
-{
-	sqlite3_stmt	*stmt;
-	gint		res, page_count, freelist_count;
-
-	/* Determine fragmentation ratio using 
-
-		PRAGMA page_count
-		PRAGMA freelist_count
-
-	   as suggested by adriatic in this blog post
-	   http://jeff.ecchi.ca/blog/2011/12/24/investigating-lifereas-startup-performance/#comment-19989	
-	   and perform VACUUM only when needed.
-	 */
-
-	db_prepare_stmt (&stmt, "PRAGMA page_count");
-	sqlite3_reset (stmt);
-	res = sqlite3_step (stmt);
-	if (SQLITE_ROW != res) 
-		g_error ("Could not determine page count (error code %d)!", res);
-	page_count = sqlite3_column_int (stmt, 0);
-	sqlite3_finalize (stmt);
-
-	db_prepare_stmt (&stmt, "PRAGMA freelist_count");
-	sqlite3_reset (stmt);
-	res = sqlite3_step (stmt);
-	if (SQLITE_ROW != res) 
-		g_error ("Could not determine free list count (error code %d)!", res);
-	freelist_count = sqlite3_column_int (stmt, 0);
-	sqlite3_finalize (stmt);
-
-	float fragmentation = (100 * (float)freelist_count/page_count);
-	if (fragmentation > VACUUM_ON_FRAGMENTATION_RATIO) {
-		debug2 (DEBUG_DB, "Performing VACUUM as freelist count/page count ratio %2.2f > %d", 
-		                  fragmentation, VACUUM_ON_FRAGMENTATION_RATIO);
-		debug_start_measurement (DEBUG_DB);
-		db_exec ("VACUUM;");
-		debug_end_measurement (DEBUG_DB, "VACUUM");
-	} else {
-		debug2 (DEBUG_DB, "No VACUUM as freelist count/page count ratio %2.2f <= %d", 
-		                  fragmentation, VACUUM_ON_FRAGMENTATION_RATIO);
-	}
-}
-
 static void
 db_open (void)
 {
@@ -244,12 +220,143 @@ db_open (void)
 
 	sqlite3_extended_result_codes (db, TRUE);
 
+	/* Only effective for new DBs, existing ones are converted
+	   by a VACUUM on shutdown (see db_maintenance_vacuum_step()) */
+	db_exec("PRAGMA auto_vacuum=INCREMENTAL");
 	db_exec("PRAGMA journal_mode=WAL");
 	db_exec("PRAGMA page_size=32768");
 	db_exec("PRAGMA synchronous=NORMAL");
 }
 
-#define SCHEMA_TARGET_VERSION 10
+#define SCHEMA_TARGET_VERSION 12
+
+/* Sanitizes the HTML column of all rows found by the given select
+   statement (returning id and HTML) using the given update statement
+   (taking HTML and id). Used for migrating to schema version 11. */
+/* Sanitizes the selected HTML the same way as when it is added:
+   item descriptions using xhtml_sanitize() and metadata values of
+   HTML type using xhtml_strip_dhtml(). Metadata rows are selected
+   as (rowid, value, key), other rows as (rowid, html). */
+static void
+db_sanitize_html (const gchar *selectSql, const gchar *updateSql, gboolean metadata)
+{
+	sqlite3_stmt	*selectStmt, *updateStmt;
+	guint		count = 0;
+
+	db_prepare_stmt (&selectStmt, selectSql);
+	db_prepare_stmt (&updateStmt, updateSql);
+
+	while (sqlite3_step (selectStmt) == SQLITE_ROW) {
+		const gchar	*html = (const gchar *)sqlite3_column_text (selectStmt, 1);
+		gchar		*sanitized;
+
+		if (metadata) {
+			const gchar *key = (const gchar *)sqlite3_column_text (selectStmt, 2);
+
+			if (!key || !metadata_is_html (key))
+				continue;
+			sanitized = xhtml_strip_dhtml (html);
+		} else {
+			sanitized = xhtml_sanitize (html);
+		}
+
+		if (!g_str_equal (html, sanitized)) {
+			sqlite3_reset (updateStmt);
+			sqlite3_bind_text (updateStmt, 1, sanitized, -1, SQLITE_TRANSIENT);
+			sqlite3_bind_int64 (updateStmt, 2, sqlite3_column_int64 (selectStmt, 0));
+			if (SQLITE_DONE != sqlite3_step (updateStmt))
+				g_warning ("HTML sanitizing update failed (%s)", sqlite3_errmsg (db));
+			count++;
+		}
+		g_free (sanitized);
+	}
+
+	sqlite3_finalize (updateStmt);
+	sqlite3_finalize (selectStmt);
+
+	debug1 (DEBUG_DB, "sanitized HTML of %u rows", count);
+}
+
+/* Item metadata is stored packed in the "metadata" column of the
+   items table as a sequence of NUL terminated key and value strings.
+   The values of keys search folder rules filter on are additionally
+   stored in the metadata table, so they can be queried using SQL. */
+
+static gboolean
+db_metadata_key_is_indexed (const gchar *key)
+{
+	return g_str_equal (key, "enclosure") || g_str_equal (key, "category");
+}
+
+static void
+db_metadata_pack_cb (const gchar *key, const gchar *value, guint index, gpointer user_data)
+{
+	GString	*packed = (GString *)user_data;
+
+	g_string_append_len (packed, key, strlen (key) + 1);
+	g_string_append_len (packed, value, strlen (value) + 1);
+}
+
+/* Returns a newly allocated packed metadata blob or NULL for an empty list */
+static gchar *
+db_metadata_pack (GSList *metadata, gsize *len)
+{
+	GString	*packed;
+
+	*len = 0;
+	if (!metadata)
+		return NULL;
+
+	packed = g_string_new (NULL);
+	metadata_list_foreach (metadata, db_metadata_pack_cb, packed);
+	*len = packed->len;
+
+	return g_string_free (packed, FALSE);
+}
+
+/* Migrates the metadata table rows into packed metadata (schema 12) */
+static void
+db_metadata_migrate_to_packed (void)
+{
+	sqlite3_stmt	*selectStmt, *updateStmt;
+	GString		*packed = g_string_new (NULL);
+	gint64		itemId = -1;
+	guint		count = 0;
+	gboolean	more;
+
+	db_prepare_stmt (&selectStmt, "SELECT item_id,key,value FROM metadata ORDER BY item_id,nr");
+	db_prepare_stmt (&updateStmt, "UPDATE items SET metadata = ? WHERE item_id = ?");
+
+	do {
+		more = (SQLITE_ROW == sqlite3_step (selectStmt));
+
+		/* write the collected metadata on each item change */
+		if (packed->len && (!more || itemId != sqlite3_column_int64 (selectStmt, 0))) {
+			sqlite3_reset (updateStmt);
+			sqlite3_bind_blob (updateStmt, 1, packed->str, packed->len, SQLITE_TRANSIENT);
+			sqlite3_bind_int64 (updateStmt, 2, itemId);
+			if (SQLITE_DONE != sqlite3_step (updateStmt))
+				g_warning ("Packing metadata of item %" G_GINT64_FORMAT " failed (%s)", itemId, sqlite3_errmsg (db));
+			g_string_truncate (packed, 0);
+			count++;
+		}
+
+		if (more) {
+			const gchar *key = (const gchar *)sqlite3_column_text (selectStmt, 1);
+			const gchar *value = (const gchar *)sqlite3_column_text (selectStmt, 2);
+
+			itemId = sqlite3_column_int64 (selectStmt, 0);
+			if (key && value)
+				db_metadata_pack_cb (key, value, 0, packed);
+		}
+	} while (more);
+
+	sqlite3_finalize (updateStmt);
+	sqlite3_finalize (selectStmt);
+	g_string_free (packed, TRUE);
+
+	debug1 (DEBUG_DB, "packed metadata of %u items", count);
+}
 
 /* opening or creation of database */
 void
@@ -434,15 +541,42 @@ db_init (void)
 
 			searchFolderRebuild = TRUE;
 		}
+
+		if (db_get_schema_version () == 10) {
+			/* HTML is now sanitized once when adding items instead of on each rendering */
+			debug0 (DEBUG_DB, "migrating from schema version 10 to 11 (sanitizing stored HTML)");
+			db_begin_transaction ();
+			db_sanitize_html ("SELECT item_id,description FROM items WHERE description LIKE '%<%'",
+			                  "UPDATE items SET description = ? WHERE item_id = ?", FALSE);
+			db_sanitize_html ("SELECT rowid,value,key FROM metadata WHERE value LIKE '%<%'",
+			                  "UPDATE metadata SET value = ? WHERE rowid = ?", TRUE);
+			db_sanitize_html ("SELECT rowid,value,key FROM subscription_metadata WHERE value LIKE '%<%'",
+			                  "UPDATE subscription_metadata SET value = ? WHERE rowid = ?", TRUE);
+			db_exec ("REPLACE INTO info (name, value) VALUES ('schemaVersion',11);");
+			db_end_transaction ();
+		}
+
+		if (db_get_schema_version () == 11) {
+			/* Item metadata is packed into a column of the items table,
+			   the metadata table keeps only the keys rules filter on.
+			   This is not optional: keeping both representations would
+			   mean writing every value twice or two load code paths,
+			   and the row per value table is what made loads and
+			   updates slow. There is no migration back, a DB of
+			   schema 12 can't be used by older Liferea versions. */
+			debug0 (DEBUG_DB, "migrating from schema version 11 to 12 (packing item metadata)");
+			db_begin_transaction ();
+			db_exec ("ALTER TABLE items ADD COLUMN metadata BLOB;");
+			db_metadata_migrate_to_packed ();
+			db_exec ("DELETE FROM metadata WHERE key NOT IN ('enclosure','category');");
+			db_exec ("REPLACE INTO info (name, value) VALUES ('schemaVersion',12);");
+			db_end_transaction ();
+		}
 	}
 
 	if (SCHEMA_TARGET_VERSION != db_get_schema_version ())
 		g_error ("Fatal: DB schema version not up-to-date! Running with --debug-db could give some hints about the problem!");
 	
-	/* Vacuuming... */
-
-	db_vacuum ();
-	
 	/* Schema creation */
 		
 	debug_start_measurement (DEBUG_DB);
@@ -466,6 +600,7 @@ db_init (void)
         	 "   date		INTEGER,"
         	 "   comment_feed_id	TEXT,"
 		 "   comment            INTEGER,"
+		 "   metadata		BLOB,"
 		 "   PRIMARY KEY (item_id)"
         	 ");");
 
@@ -536,41 +671,9 @@ db_init (void)
 	db_exec ("DROP TRIGGER item_removal;");
 	db_exec ("DROP TRIGGER subscription_removal;");
 		
-	/* 3. Cleanup of DB */
-
-	/* Note: do not check on subscriptions here, as non-subscription node
-	   types (e.g. news bin) do contain items too. */
-	debug0 (DEBUG_DB, "Checking for items without a feed list node...\n");
-	db_exec ("DELETE FROM items WHERE comment = 0 AND node_id NOT IN "
-        	 "(SELECT node_id FROM node);");
-        	 
-        debug0 (DEBUG_DB, "Checking for comments without parent item...\n");
-	db_exec ("BEGIN; "
-	         "   CREATE TEMP TABLE tmp_id ( id );"
-	         "   INSERT INTO tmp_id SELECT item_id FROM items WHERE comment = 1 AND parent_item_id NOT IN (SELECT item_id FROM items WHERE comment = 0);"
-	         /* limit to 1000 items as it is very slow */
-	         "   DELETE FROM items WHERE item_id IN (SELECT id FROM tmp_id LIMIT 1000);"
-	         "   DROP TABLE tmp_id;"
-		 "END;");
-        
-	debug0 (DEBUG_DB, "Checking for search folder items without a feed list node...\n");
-	db_exec ("DELETE FROM search_folder_items WHERE parent_node_id NOT IN "
-        	 "(SELECT node_id FROM node);");
-
-	debug0 (DEBUG_DB, "Checking for search folder items without a search folder...\n");
-	db_exec ("DELETE FROM search_folder_items WHERE node_id NOT IN "
-        	 "(SELECT node_id FROM node);");
-
-	debug0 (DEBUG_DB, "Checking for search folder with comments...\n");
-	db_exec ("DELETE FROM search_folder_items WHERE comment = 1;");
-
-	debug0 (DEBUG_DB, "Checking for subscription metadata without node...\n");
-	db_exec ("DELETE FROM subscription_metadata WHERE node_id NOT IN "
-          	 "(SELECT node_id FROM node);");
-
-	debug0 (DEBUG_DB, "DB cleanup finished. Continuing startup.");
-		
-	/* 4. Creating triggers (after cleanup so it is not slowed down by triggers) */
+	/* 3. Cleanup of the DB is done later in the background, see db_maintenance_schedule() */
+
+	/* 4. Creating triggers */
 
 	/* This trigger does explicitely not remove comments! */
 	db_exec ("CREATE TRIGGER item_removal DELETE ON items "
@@ -629,9 +732,34 @@ db_init (void)
 		          "item_id,"
 			  "parent_item_id, "
 		          "node_id, "
-			  "parent_node_id "
+			  "parent_node_id, "
+			  "metadata "
 	                  " FROM items WHERE item_id = ?");      
 	
+	db_new_statement ("itemLoadLightStmt",
+	                  "SELECT "
+	                  "title,"
+	                  "read,"
+	                  "updated,"
+	                  "popup,"
+	                  "marked,"
+	                  "source,"
+	                  "source_id,"
+	                  "valid_guid,"
+	                  "NULL,"
+	                  "date,"
+		          "comment_feed_id,"
+		          "comment,"
+		          "item_id,"
+			  "parent_item_id, "
+		          "node_id, "
+			  "parent_node_id, "
+			  "EXISTS (SELECT 1 FROM metadata WHERE metadata.item_id = items.item_id AND key = 'enclosure') "
+	                  " FROM items WHERE item_id = ?");
+
+	db_new_statement ("itemDetailsLoadStmt",
+	                  "SELECT description,metadata FROM items WHERE item_id = ?");
+
 	db_new_statement ("itemUpdateStmt",
 	                  "REPLACE INTO items ("
 	                  "title,"
@@ -649,8 +777,9 @@ db_init (void)
 	                  "item_id,"
 	                  "parent_item_id,"
 	                  "node_id,"
-	                  "parent_node_id"
-	                  ") values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
+	                  "parent_node_id,"
+	                  "metadata"
+	                  ") values (?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?,?)");
 			
 	db_new_statement ("itemStateUpdateStmt",
 			  "UPDATE items SET read=?, marked=?, updated=? "
@@ -666,9 +795,9 @@ db_init (void)
 	db_new_statement ("duplicatesMarkReadStmt",
  	                  "UPDATE items SET read = 1, updated = 0 WHERE source_id = ?");
 						
-	db_new_statement ("metadataLoadStmt",
-	                  "SELECT key,value,nr FROM metadata WHERE item_id = ? ORDER BY nr");
-			
+	db_new_statement ("metadataRemoveStmt",
+	                  "DELETE FROM metadata WHERE item_id = ?");
+
 	db_new_statement ("metadataUpdateStmt",
 	                  "REPLACE INTO metadata (item_id,nr,key,value) VALUES (?,?,?,?)");
 			
@@ -725,6 +854,11 @@ db_init (void)
 
 	db_new_statement ("nodeRemoveStmt",
 	                  "DELETE FROM node WHERE node_id = ?;");
+
+	db_new_statement ("rowCountStmt",
+	                  "SELECT (SELECT count(*) FROM items), "
+	                  "       (SELECT count(*) FROM metadata), "
+	                  "       (SELECT count(*) FROM subscription_metadata);");
 			  
 	g_assert (sqlite3_get_autocommit (db));
 	
@@ -744,6 +878,12 @@ db_deinit (void)
 		g_hash_table_destroy (statements);	
 		statements = NULL;
 	}
+
+	db_maintenance_stop ();
+	item_header_cache_free ();
+
+	debug3 (DEBUG_DB, "item loads: %lu full, %lu light, %lu light with details loaded later",
+	        itemLoadCount, itemLightLoadCount, itemDetailLoadCount);
 		
 	if (SQLITE_OK != sqlite3_close (db))
 		g_warning ("DB close failed: %s", sqlite3_errmsg (db));
@@ -753,40 +893,53 @@ db_deinit (void)
 	debug_exit ("db_deinit");
 }
 
+void
+db_begin_bulk_update (void)
+{
+	db_begin_transaction ();
+}
+
+void
+db_end_bulk_update (void)
+{
+	db_end_transaction ();
+}
+
 static GSList *
 db_metadata_list_append (GSList *metadata, const char *key, const char *value)
 {
+	/* values were checked and sanitized before being saved */
 	if (metadata_is_type_registered (key))
-		metadata = metadata_list_append (metadata, key, value);
+		metadata = metadata_list_append_checked (metadata, key, value);
 	else
 		debug1 (DEBUG_DB, "Trying to load unregistered metadata type %s from DB.", key);
 
 	return metadata;
 }
 
+/* Unpacks the given packed metadata column into the item */
 static GSList *
-db_item_metadata_load(itemPtr item) 
+db_item_metadata_unpack (itemPtr item, sqlite3_stmt *stmt, gint column)
 {
 	GSList		*metadata = NULL;
-	sqlite3_stmt 	*stmt;
-	gint		res;
+	const gchar	*packed, *end;
 
-	stmt = db_get_statement ("metadataLoadStmt");
-	res = sqlite3_bind_int (stmt, 1, item->id);
-	if (SQLITE_OK != res)
-		g_error ("db_item_load_metadata: sqlite bind failed (error code %d)!", res);
+	packed = (const gchar *)sqlite3_column_blob (stmt, column);
+	end = packed + sqlite3_column_bytes (stmt, column);
+
+	while (packed && packed < end) {
+		const gchar *key = packed;
+		const gchar *value = key + strlen (key) + 1;
+
+		if (value >= end)
+			break;	/* truncated blob */
+		packed = value + strlen (value) + 1;
 
-	while (sqlite3_step (stmt) == SQLITE_ROW) {
-		const char *key, *value;
-		key = sqlite3_column_text(stmt, 0);
-		value = sqlite3_column_text(stmt, 1);
 		if (g_str_equal (key, "enclosure"))
 			item->hasEnclosure = TRUE;
-		metadata = db_metadata_list_append (metadata, key, value); 
+		metadata = db_metadata_list_append (metadata, key, value);
 	}
 
-	sqlite3_finalize (stmt);
-
 	return metadata;
 }
 
@@ -796,33 +949,44 @@ db_item_metadata_update_cb (const gchar *key,
                             guint index,
                             gpointer user_data) 
 {
-	sqlite3_stmt	*stmt;
-	itemPtr		item = (itemPtr)user_data;
+	sqlite3_stmt	*stmt = (sqlite3_stmt *)user_data;
 	gint		res;
 
-	stmt = db_get_statement ("metadataUpdateStmt");
-	sqlite3_bind_int  (stmt, 1, item->id);
+	if (!db_metadata_key_is_indexed (key))
+		return;
+
+	sqlite3_reset (stmt);
 	sqlite3_bind_int  (stmt, 2, index);
 	sqlite3_bind_text (stmt, 3, key, -1, SQLITE_TRANSIENT);
 	sqlite3_bind_text (stmt, 4, value, -1, SQLITE_TRANSIENT);
 	res = sqlite3_step (stmt);
 	if (SQLITE_DONE != res) 
 		g_warning ("Update in \"metadata\" table failed (error code=%d, %s)", res, sqlite3_errmsg (db));
-
-	sqlite3_finalize (stmt);
-
 }
 
+/* Updates the metadata table index rows, the packed metadata
+   itself is written together with the item. */
 static void
-db_item_metadata_update(itemPtr item) 
+db_item_metadata_update (itemPtr item) 
 {
-	metadata_list_foreach(item->metadata, db_item_metadata_update_cb, item);
+	sqlite3_stmt	*stmt;
+
+	stmt = db_get_statement ("metadataRemoveStmt");
+	sqlite3_bind_int (stmt, 1, item->id);
+	if (SQLITE_DONE != sqlite3_step (stmt))
+		g_warning ("Removing from \"metadata\" table failed (%s)", sqlite3_errmsg (db));
+	sqlite3_finalize (stmt);
+
+	stmt = db_get_statement ("metadataUpdateStmt");
+	sqlite3_bind_int (stmt, 1, item->id);
+	metadata_list_foreach (item->metadata, db_item_metadata_update_cb, stmt);
+	sqlite3_finalize (stmt);
 }
 
 /* Item structure loading methods */
 
 static itemPtr
-db_load_item_from_columns (sqlite3_stmt *stmt) 
+db_load_item_from_columns (sqlite3_stmt *stmt, gboolean light) 
 {
 	const gchar	*tmp;
 
@@ -848,13 +1012,20 @@ db_load_item_from_columns (sqlite3_stmt *stmt)
 	if (tmp)
 		item->source = g_strdup (tmp);
 		
+	if (light) {
+		/* description and metadata are loaded on demand */
+		item->light = TRUE;
+		item->hasEnclosure = sqlite3_column_int (stmt, 16)?TRUE:FALSE;
+		return item;
+	}
+
 	tmp = sqlite3_column_text(stmt, 8);
 	if (tmp)
 		item->description = g_strdup (tmp);
 	else
 		item->description = g_strdup ("");
 
-	item->metadata = db_item_metadata_load (item);
+	item->metadata = db_item_metadata_unpack (item, stmt, 16);
 
 	return item;
 }
@@ -883,20 +1054,21 @@ db_itemset_load (const gchar *id)
 	return itemSet;
 }
 
-itemPtr
-db_item_load (gulong id) 
+static itemPtr
+db_item_load_internal (gulong id, gboolean light)
 {
 	sqlite3_stmt	*stmt;
 	itemPtr 	item = NULL;
+	gint64		start = g_get_monotonic_time ();
 
-	debug1 (DEBUG_DB, "loading item %lu", id);
+	debug2 (DEBUG_DB, "loading item %lu%s", id, light?" (light)":"");
 	debug_start_measurement (DEBUG_DB);
 	
-	stmt = db_get_statement ("itemLoadStmt");
+	stmt = db_get_statement (light?"itemLoadLightStmt":"itemLoadStmt");
 	sqlite3_bind_int (stmt, 1, id);
 
 	if (sqlite3_step (stmt) == SQLITE_ROW) {
-		item = db_load_item_from_columns (stmt);
+		item = db_load_item_from_columns (stmt, light);
 		(void) sqlite3_step (stmt);
 	} else {
 		debug1 (DEBUG_DB, "Could not load item with id %lu!", id);
@@ -904,11 +1076,204 @@ db_item_load (gulong id)
 	
 	sqlite3_finalize (stmt);
 
-	debug_end_measurement (DEBUG_DB, "item load");
+	if (light)
+		itemLightLoadCount++;
+	else
+		itemLoadCount++;
+
+	metrics_histogram_add_since (&itemLoadLatency, start);
+
+	debug_end_measurement (DEBUG_DB, light?"light item load":"item load");
 
 	return item;
 }
 
+itemPtr
+db_item_load (gulong id) 
+{
+	return db_item_load_internal (id, FALSE);
+}
+
+itemPtr
+db_item_load_light (gulong id) 
+{
+	return db_item_load_internal (id, TRUE);
+}
+
+void
+db_item_load_details (itemPtr item)
+{
+	sqlite3_stmt	*stmt;
+	const gchar	*tmp = NULL;
+
+	g_assert (item->light);
+
+	debug1 (DEBUG_DB, "loading description and metadata of item %lu", item->id);
+	debug_start_measurement (DEBUG_DB);
+
+	item->light = FALSE;
+	itemDetailLoadCount++;
+
+	metadata_list_free (item->metadata);
+	item->metadata = NULL;
+
+	stmt = db_get_statement ("itemDetailsLoadStmt");
+	sqlite3_bind_int (stmt, 1, item->id);
+	if (sqlite3_step (stmt) == SQLITE_ROW) {
+		tmp = sqlite3_column_text (stmt, 0);
+		item->metadata = db_item_metadata_unpack (item, stmt, 1);
+	}
+
+	g_free (item->description);
+	item->description = g_strdup (tmp?tmp:"");
+	sqlite3_finalize (stmt);
+
+	debug_end_measurement (DEBUG_DB, "item details load");
+}
+
+void
+db_item_get_load_counts (gulong *loads, gulong *lightLoads, gulong *detailLoads)
+{
+	*loads = itemLoadCount;
+	*lightLoads = itemLightLoadCount;
+	*detailLoads = itemDetailLoadCount;
+}
+
+const metricsHistogram *
+db_item_get_load_latency (void)
+{
+	return &itemLoadLatency;
+}
+
+const metricsHistogram *
+db_item_get_update_latency (void)
+{
+	return &itemUpdateLatency;
+}
+
+void
+db_get_row_counts (gulong *items, gulong *itemMetadata, gulong *subscriptionMetadata)
+{
+	sqlite3_stmt	*stmt;
+	gint		res;
+
+	*items = *itemMetadata = *subscriptionMetadata = 0;
+
+	if (!db)
+		return;
+
+	debug_start_measurement (DEBUG_DB);
+
+	stmt = db_get_statement ("rowCountStmt");
+	res = sqlite3_step (stmt);
+	if (SQLITE_ROW == res) {
+		*items = sqlite3_column_int64 (stmt, 0);
+		*itemMetadata = sqlite3_column_int64 (stmt, 1);
+		*subscriptionMetadata = sqlite3_column_int64 (stmt, 2);
+	} else {
+		g_warning ("row counting failed (error code=%d, %s)", res, sqlite3_errmsg (db));
+	}
+	sqlite3_finalize (stmt);
+
+	debug_end_measurement (DEBUG_DB, "counting rows");
+}
+
+/* Item header access for the item header cache and the item list
+   model. These helpers allow fetching the few columns needed to
+   render or filter item list rows for a page of item ids without
+   loading full items. */
+
+/* stay well below SQLITE_MAX_VARIABLE_NUMBER */
+#define DB_ITEM_HEADERS_PAGE_SIZE	500
+
+void
+db_item_headers_load (const gulong *ids, guint count, dbItemHeaderFunc func, gpointer user_data)
+{
+	sqlite3_stmt	*stmt;
+	guint		offset, i, len;
+
+	debug_start_measurement (DEBUG_DB);
+
+	for (offset = 0; offset < count; offset += DB_ITEM_HEADERS_PAGE_SIZE) {
+		GString *sql = g_string_new ("SELECT item_id,title,read,updated,marked,date,source_id,valid_guid,"
+		                             "comment,parent_item_id,node_id,parent_node_id FROM items WHERE item_id IN (");
+
+		len = MIN (DB_ITEM_HEADERS_PAGE_SIZE, count - offset);
+		for (i = 0; i < len; i++)
+			g_string_append (sql, i?",?":"?");
+		g_string_append (sql, ")");
+
+		db_prepare_stmt (&stmt, sql->str);
+		g_string_free (sql, TRUE);
+
+		for (i = 0; i < len; i++)
+			sqlite3_bind_int (stmt, i + 1, ids[offset + i]);
+
+		while (sqlite3_step (stmt) == SQLITE_ROW) {
+			struct itemHeader header;
+
+			header.id		= sqlite3_column_int (stmt, 0);
+			header.title		= (const gchar *)sqlite3_column_text (stmt, 1);
+			header.readStatus	= sqlite3_column_int (stmt, 2)?1:0;
+			header.updateStatus	= sqlite3_column_int (stmt, 3)?1:0;
+			header.flagStatus	= sqlite3_column_int (stmt, 4)?1:0;
+			header.time		= sqlite3_column_int (stmt, 5);
+			header.sourceId		= (const gchar *)sqlite3_column_text (stmt, 6);
+			header.validGuid	= sqlite3_column_int (stmt, 7)?1:0;
+			header.isComment	= sqlite3_column_int (stmt, 8)?1:0;
+			header.parentItemId	= sqlite3_column_int (stmt, 9);
+			header.nodeId		= (const gchar *)sqlite3_column_text (stmt, 10);
+			header.parentNodeId	= (const gchar *)sqlite3_column_text (stmt, 11);
+
+			(*func) (&header, user_data);
+		}
+
+		sqlite3_finalize (stmt);
+	}
+
+	debug_end_measurement (DEBUG_DB, "item header load");
+}
+
+guint
+db_item_ids_sort_by_title (const gulong *ids, guint count, gboolean reversed, gulong *result)
+{
+	sqlite3_stmt	*stmt;
+	guint		i, n = 0;
+
+	debug_start_measurement (DEBUG_DB);
+
+	/* Let SQLite do the title sorting using a temporary id table,
+	   so the titles never need to be in memory all at once */
+	db_exec ("CREATE TEMP TABLE IF NOT EXISTS item_list_sort (item_id INTEGER PRIMARY KEY);");
+	db_exec ("DELETE FROM item_list_sort;");
+
+	db_begin_transaction ();
+	db_prepare_stmt (&stmt, "INSERT OR IGNORE INTO item_list_sort (item_id) VALUES (?)");
+	for (i = 0; i < count; i++) {
+		sqlite3_reset (stmt);
+		sqlite3_bind_int (stmt, 1, ids[i]);
+		if (SQLITE_DONE != sqlite3_step (stmt))
+			g_warning ("item sort id insert failed (%s)", sqlite3_errmsg (db));
+	}
+	sqlite3_finalize (stmt);
+	db_end_transaction ();
+
+	db_prepare_stmt (&stmt, reversed?
+	                 "SELECT items.item_id FROM item_list_sort JOIN items ON items.item_id = item_list_sort.item_id "
+	                 "ORDER BY items.title COLLATE NOCASE DESC, items.item_id DESC":
+	                 "SELECT items.item_id FROM item_list_sort JOIN items ON items.item_id = item_list_sort.item_id "
+	                 "ORDER BY items.title COLLATE NOCASE ASC, items.item_id ASC");
+	while ((sqlite3_step (stmt) == SQLITE_ROW) && (n < count))
+		result[n++] = sqlite3_column_int (stmt, 0);
+	sqlite3_finalize (stmt);
+
+	db_exec ("DELETE FROM item_list_sort;");
+
+	debug_end_measurement (DEBUG_DB, "item title sort");
+
+	return n;
+}
+
 /* Item modification methods */
 
 static int
@@ -1008,10 +1373,17 @@ void
 db_item_update (itemPtr item) 
 {
 	sqlite3_stmt	*stmt;
+	gchar		*packed;
+	gsize		packedLen;
 	gint		res;
+	gint64		start = g_get_monotonic_time ();
 	
 	debug2 (DEBUG_DB, "update of item \"%s\" (id=%lu)", item->title, item->id);
 	debug_start_measurement (DEBUG_DB);
+
+	/* never overwrite the description and metadata of light items */
+	if (item->light)
+		db_item_load_details (item);
 	
 	db_begin_transaction ();
 
@@ -1040,6 +1412,12 @@ db_item_update (itemPtr item)
 	sqlite3_bind_text (stmt, 15, item->nodeId, -1, SQLITE_TRANSIENT);
 	sqlite3_bind_text (stmt, 16, item->parentNodeId, -1, SQLITE_TRANSIENT);
 
+	packed = db_metadata_pack (item->metadata, &packedLen);
+	if (packed)
+		sqlite3_bind_blob (stmt, 17, packed, packedLen, g_free);
+	else
+		sqlite3_bind_null (stmt, 17);
+
 	res = sqlite3_step (stmt);
 
 	if (SQLITE_DONE != res) 
@@ -1052,6 +1430,10 @@ db_item_update (itemPtr item)
 
 	db_end_transaction ();
 
+	item_header_update (item);
+
+	metrics_histogram_add_since (&itemUpdateLatency, start);
+
 	debug_end_measurement (DEBUG_DB, "item update");
 }
 
@@ -1080,6 +1462,8 @@ db_item_state_update (itemPtr item)
 	
 	sqlite3_finalize (stmt);
 
+	item_header_update (item);
+
 	debug_end_measurement (DEBUG_DB, "item state update");
 
 }
@@ -1101,6 +1485,8 @@ db_item_remove (gulong id)
 		g_warning ("item remove failed (error code=%d, %s)", res, sqlite3_errmsg (db));
 
 	sqlite3_finalize (stmt);
+
+	item_header_remove (id);
 }
 
 GSList * 
@@ -1175,6 +1561,8 @@ db_itemset_remove_all (const gchar *id)
 
 	sqlite3_finalize (stmt);
 
+	item_header_remove_node (id);
+
 }
 
 void 
@@ -1529,7 +1917,9 @@ db_subscription_update (subscriptionPtr subscription)
 	
 	sqlite3_finalize (stmt);
 
-	db_subscription_metadata_update (subscription);
+	/* Metadata not yet loaded is unchanged (see subscription_load_metadata()) */
+	if (subscription->metadataLoaded)
+		db_subscription_metadata_update (subscription);
 		
 	debug_end_measurement (DEBUG_DB, "subscription update");
 }
@@ -1583,24 +1973,6 @@ db_node_update (nodePtr node)
 	debug_end_measurement (DEBUG_DB, "node update");
 }
 
-static gboolean
-db_node_find (nodePtr node, gpointer id)
-{
-	GSList *iter;
-
-	if (g_str_equal (node->id, (gchar *)id))
-		return TRUE;
-
-	iter = node->children;
-	while (iter) {
-		if (db_node_find ((nodePtr)iter->data, id))
-			return TRUE;
-		iter = g_slist_next (iter);
-	}
-
-	return FALSE;
-}
-
 static void
 db_node_remove (const gchar *id)
 {
@@ -1618,7 +1990,7 @@ db_node_remove (const gchar *id)
 }
 
 void
-db_node_cleanup (nodePtr root)
+db_node_cleanup (void)
 {
 	sqlite3_stmt	*stmt;
 
@@ -1629,7 +2001,7 @@ db_node_cleanup (nodePtr root)
 	while (sqlite3_step (stmt) == SQLITE_ROW) {
 		/* Drop node ids not in feed list anymore */
 		const gchar *id = sqlite3_column_text (stmt, 0);
-		if (id && !db_node_find (root, (gpointer)id)) {
+		if (id && !node_is_used_id (id)) {
 			db_subscription_remove (id);	/* in case it is a subscription */
 			db_node_remove (id);		/* in case it is a folder */
 		}
@@ -1637,3 +2009,243 @@ db_node_cleanup (nodePtr root)
 
 	sqlite3_finalize (stmt);
 }
+
+/* Background DB maintenance
+
+   The orphan cleanup and the VACUUM used to be run by db_init() which
+   delayed the startup considerably for large DBs. Now they are run in
+   short low priority idle callbacks some time after the startup. Each
+   cleanup task scans a limited rowid range per step and continues with
+   the next range in the next step. */
+
+#define DB_MAINTENANCE_DELAY		30	/* seconds after scheduling */
+#define DB_MAINTENANCE_SLICE_TIME	20000	/* max time per idle callback in µs */
+#define DB_MAINTENANCE_RANGE		2000	/* rowids checked per step */
+#define DB_MAINTENANCE_VACUUM_PAGES	"64"	/* pages freed per step */
+#define VACUUM_ON_FRAGMENTATION_RATIO	10
+
+typedef struct dbMaintenanceTask {
+	const gchar	*description;
+	const gchar	*maxRowIdSql;	/**< query for the largest rowid to check */
+	const gchar	*sql;		/**< query with the rowid range as parameters 1 and 2 */
+	gboolean	selectItems;	/**< TRUE if sql returns item ids to be removed, FALSE if sql deletes */
+} dbMaintenanceTask;
+
+/* Note: do not check on subscriptions here, as non-subscription node
+   types (e.g. news bin) do contain items too. */
+static const dbMaintenanceTask maintenanceTasks[] = {
+	{ "items without a feed list node",
+	  "SELECT MAX(item_id) FROM items",
+	  "SELECT item_id FROM items WHERE item_id > ? AND item_id <= ? AND comment = 0 AND "
+	  "NOT EXISTS (SELECT 1 FROM node WHERE node.node_id = items.node_id)",
+	  TRUE },
+	{ "comments without parent item",
+	  "SELECT MAX(item_id) FROM items",
+	  "SELECT item_id FROM items AS c WHERE item_id > ? AND item_id <= ? AND comment = 1 AND "
+	  "NOT EXISTS (SELECT 1 FROM items AS p WHERE p.item_id = c.parent_item_id AND p.comment = 0)",
+	  TRUE },
+	{ "search folder items without a feed list node, search folder or with comments",
+	  "SELECT MAX(rowid) FROM search_folder_items",
+	  "DELETE FROM search_folder_items WHERE rowid > ? AND rowid <= ? AND ("
+	  "NOT EXISTS (SELECT 1 FROM node WHERE node.node_id = search_folder_items.parent_node_id) OR "
+	  "NOT EXISTS (SELECT 1 FROM node WHERE node.node_id = search_folder_items.node_id) OR "
+	  "EXISTS (SELECT 1 FROM items WHERE items.item_id = search_folder_items.item_id AND items.comment = 1))",
+	  FALSE },
+	{ "subscription metadata without node",
+	  "SELECT MAX(rowid) FROM subscription_metadata",
+	  "DELETE FROM subscription_metadata WHERE rowid > ? AND rowid <= ? AND "
+	  "NOT EXISTS (SELECT 1 FROM node WHERE node.node_id = subscription_metadata.node_id)",
+	  FALSE }
+};
+
+static struct dbMaintenance {
+	guint		timeout;	/**< delayed start timeout source */
+	guint		idle;		/**< idle source while running */
+	guint		task;		/**< index of the current task */
+	gint64		cursor;		/**< last checked rowid of the current task */
+	gint64		maxRowId;	/**< largest rowid to check for the current task */
+	gulong		removed;	/**< rows removed by the current task */
+	gboolean	vacuumOnShutdown;	/**< TRUE if a full VACUUM is to be done in db_deinit() */
+} maintenance;
+
+static gint
+db_get_pragma_int (const gchar *sql)
+{
+	sqlite3_stmt	*stmt;
+	gint		res, value;
+
+	db_prepare_stmt (&stmt, sql);
+	res = sqlite3_step (stmt);
+	if (SQLITE_ROW != res)
+		g_error ("Could not run \"%s\" (error code %d)!", sql, res);
+	value = sqlite3_column_int (stmt, 0);
+	sqlite3_finalize (stmt);
+
+	return value;
+}
+
+/* Runs one step of the current cleanup task, returns TRUE when the task is finished */
+static gboolean
+db_maintenance_cleanup_step (void)
+{
+	const dbMaintenanceTask	*task = &maintenanceTasks[maintenance.task];
+	sqlite3_stmt		*stmt;
+	gint			res;
+
+	if (0 == maintenance.cursor) {
+		db_prepare_stmt (&stmt, task->maxRowIdSql);
+		if (SQLITE_ROW == sqlite3_step (stmt))
+			maintenance.maxRowId = sqlite3_column_int64 (stmt, 0);
+		sqlite3_finalize (stmt);
+		debug1 (DEBUG_DB, "Checking for %s...", task->description);
+	}
+
+	if (maintenance.cursor >= maintenance.maxRowId) {
+		debug2 (DEBUG_DB, "Removed %lu %s", maintenance.removed, task->description);
+		return TRUE;
+	}
+
+	db_prepare_stmt (&stmt, task->sql);
+	sqlite3_bind_int64 (stmt, 1, maintenance.cursor);
+	sqlite3_bind_int64 (stmt, 2, maintenance.cursor + DB_MAINTENANCE_RANGE);
+
+	if (task->selectItems) {
+		GSList	*ids = NULL, *iter;
+
+		/* Removal via db_item_remove() keeps the item header cache coherent */
+		while (SQLITE_ROW == (res = sqlite3_step (stmt)))
+			ids = g_slist_prepend (ids, GUINT_TO_POINTER (sqlite3_column_int (stmt, 0)));
+		sqlite3_finalize (stmt);
+
+		for (iter = ids; iter; iter = g_slist_next (iter)) {
+			db_item_remove (GPOINTER_TO_UINT (iter->data));
+			maintenance.removed++;
+		}
+		g_slist_free (ids);
+	} else {
+		res = sqlite3_step (stmt);
+		sqlite3_finalize (stmt);
+		maintenance.removed += sqlite3_changes (db);
+	}
+
+	if (SQLITE_DONE != res)
+		g_warning ("DB maintenance step failed (error code %d, %s)", res, sqlite3_errmsg (db));
+
+	maintenance.cursor += DB_MAINTENANCE_RANGE;
+
+	return FALSE;
+}
+
+/* Frees some pages per step, returns TRUE when done */
+static gboolean
+db_maintenance_vacuum_step (void)
+{
+	gint	page_count, freelist_count;
+	float	fragmentation;
+
+	freelist_count = db_get_pragma_int ("PRAGMA freelist_count");
+	if (0 == freelist_count)
+		return TRUE;
+
+	/* 2 = incremental auto vacuum */
+	if (2 == db_get_pragma_int ("PRAGMA auto_vacuum")) {
+		db_exec ("PRAGMA incremental_vacuum(" DB_MAINTENANCE_VACUUM_PAGES ");");
+		return FALSE;
+	}
+
+	/* DBs created before auto vacuum was enabled need one full VACUUM
+	   to be converted. Only do it when a VACUUM is needed anyway, and
+	   never from the main loop, as it rewrites the whole file. It is
+	   done on shutdown when no window is shown anymore.
+
+	   Fragmentation ratio check as suggested by adriatic in this blog post
+	   http://jeff.ecchi.ca/blog/2011/12/24/investigating-lifereas-startup-performance/#comment-19989
+	 */
+	page_count = db_get_pragma_int ("PRAGMA page_count");
+	fragmentation = (100 * (float)freelist_count/page_count);
+	if (fragmentation > VACUUM_ON_FRAGMENTATION_RATIO) {
+		debug2 (DEBUG_DB, "Scheduling VACUUM on shutdown as freelist count/page count ratio %2.2f > %d",
+		                  fragmentation, VACUUM_ON_FRAGMENTATION_RATIO);
+		maintenance.vacuumOnShutdown = TRUE;
+	} else {
+		debug2 (DEBUG_DB, "No VACUUM as freelist count/page count ratio %2.2f <= %d",
+		                  fragmentation, VACUUM_ON_FRAGMENTATION_RATIO);
+	}
+
+	return TRUE;
+}
+
+static gboolean
+db_maintenance_run (gpointer user_data)
+{
+	gint64	deadline = g_get_monotonic_time () + DB_MAINTENANCE_SLICE_TIME;
+	guint	count = G_N_ELEMENTS (maintenanceTasks);
+
+	if (maintenance.task < count) {
+		db_begin_transaction ();
+		while (maintenance.task < count && g_get_monotonic_time () < deadline) {
+			if (db_maintenance_cleanup_step ()) {
+				maintenance.task++;
+				maintenance.cursor = 0;
+				maintenance.maxRowId = 0;
+				maintenance.removed = 0;
+			}
+		}
+		db_end_transaction ();
+		return TRUE;
+	}
+
+	/* Vacuuming last, outside of any transaction */
+	if (transactionDepth > 0)
+		return TRUE;	/* retry after the bulk update */
+
+	while (g_get_monotonic_time () < deadline) {
+		if (db_maintenance_vacuum_step ()) {
+			debug0 (DEBUG_DB, "DB maintenance finished.");
+			maintenance.idle = 0;
+			return FALSE;
+		}
+	}
+
+	return TRUE;
+}
+
+static gboolean
+db_maintenance_start (gpointer user_data)
+{
+	maintenance.timeout = 0;
+	maintenance.idle = g_idle_add_full (G_PRIORITY_LOW, db_maintenance_run, NULL, NULL);
+
+	return FALSE;
+}
+
+void
+db_maintenance_schedule (void)
+{
+	if (maintenance.timeout || maintenance.idle)
+		return;
+
+	memset (&maintenance, 0, sizeof (maintenance));
+	maintenance.timeout = g_timeout_add_seconds (DB_MAINTENANCE_DELAY, db_maintenance_start, NULL);
+}
+
+static void
+db_maintenance_stop (void)
+{
+	if (maintenance.timeout)
+		g_source_remove (maintenance.timeout);
+	if (maintenance.idle)
+		g_source_remove (maintenance.idle);
+
+	maintenance.timeout = 0;
+	maintenance.idle = 0;
+
+	/* One-time conversion to incremental auto vacuum */
+	if (maintenance.vacuumOnShutdown) {
+		debug_start_measurement (DEBUG_DB);
+		db_exec ("PRAGMA auto_vacuum=INCREMENTAL;");
+		db_exec ("VACUUM;");
+		debug_end_measurement (DEBUG_DB, "VACUUM");
+		maintenance.vacuumOnShutdown = FALSE;
+	}
+}
@@ -24,7 +24,9 @@
 #include <glib.h>
 
 #include "item.h"
+#include "item_header.h"
 #include "itemset.h"
+#include "metrics.h"
 #include "subscription.h"
 #include "update.h"
 
@@ -38,6 +40,18 @@ void    db_init (void);
  */
 void    db_deinit (void);
 
+/**
+ * Starts a transaction for a larger number of DB writes, e.g.
+ * on feed list import. Calls can be nested, the transaction is
+ * committed by the outermost db_end_bulk_update().
+ */
+void	db_begin_bulk_update (void);
+
+/**
+ * Ends a transaction started with db_begin_bulk_update().
+ */
+void	db_end_bulk_update (void);
+
 /* item set access (note: item sets are identified by the node id string) */
 
 /**
@@ -107,6 +121,85 @@ gboolean        db_itemset_get (itemSetPtr itemSet, gulong offset, guint limit);
  */
 itemPtr	db_item_load(gulong id);
 
+/**
+ * Loads the item specified by id from the DB without its
+ * description and metadata (see item_load_light()).
+ *
+ * @param id		the id
+ *
+ * @returns new item structure, must be free'd using item_unload()
+ */
+itemPtr	db_item_load_light (gulong id);
+
+/**
+ * Loads the description and metadata of a light item.
+ *
+ * @param item		the light item
+ */
+void	db_item_load_details (itemPtr item);
+
+/**
+ * Returns item load statistics to check how often
+ * light items actually needed their details.
+ *
+ * @param loads		returns the number of full item loads
+ * @param lightLoads	returns the number of light item loads
+ * @param detailLoads	returns the number of detail loads for light items
+ */
+void	db_item_get_load_counts (gulong *loads, gulong *lightLoads, gulong *detailLoads);
+
+/**
+ * Returns the latency histogram of item loads.
+ *
+ * @returns the histogram (owned by the DB layer)
+ */
+const metricsHistogram * db_item_get_load_latency (void);
+
+/**
+ * Returns the latency histogram of item updates.
+ *
+ * @returns the histogram (owned by the DB layer)
+ */
+const metricsHistogram * db_item_get_update_latency (void);
+
+/**
+ * Counts the rows of the item and metadata tables. Runs three
+ * count queries, so it should only be called on request.
+ *
+ * @param items			returns the number of items
+ * @param itemMetadata		returns the number of filterable item metadata rows
+ * @param subscriptionMetadata	returns the number of subscription metadata rows
+ */
+void	db_get_row_counts (gulong *items, gulong *itemMetadata, gulong *subscriptionMetadata);
+
+typedef void (*dbItemHeaderFunc)(itemHeaderPtr header, gpointer user_data);
+
+/**
+ * Loads the item header columns (titles, states, time and ids)
+ * of the given items without loading the complete items.
+ * The callback is invoked once per found item, in no specific order.
+ * The strings of the passed header are only valid during the callback.
+ *
+ * @param ids		array of item ids
+ * @param count		number of ids
+ * @param func		callback receiving the header of each item
+ * @param user_data	user data passed to func
+ */
+void	db_item_headers_load (const gulong *ids, guint count, dbItemHeaderFunc func, gpointer user_data);
+
+/**
+ * Sorts the given item ids by item title using the DB.
+ *
+ * @param ids		array of item ids
+ * @param count		number of ids
+ * @param reversed	TRUE for descending order
+ * @param result	array of at least count elements to store the
+ *			sorted ids in
+ *
+ * @returns number of ids stored in result (ids unknown to the DB are dropped)
+ */
+guint	db_item_ids_sort_by_title (const gulong *ids, guint count, gboolean reversed, gulong *result);
+
 /**
  * Updates all attributes of the item in the DB
  *
@@ -210,10 +303,16 @@ void db_node_update (nodePtr node);
 
 /**
  * Clean old nodes from the DB by comparing all DB nodes
- * against the OPML feed list.
- * 
- * @param root		the root node
+ * against the nodes of the loaded feed list.
+ */
+void db_node_cleanup (void);
+
+/**
+ * Schedules the removal of orphaned items and metadata and the
+ * freeing of unused DB pages. The maintenance runs in small steps
+ * in the background shortly after calling this method. To be
+ * called once the feed list is loaded.
  */
-void db_node_cleanup (nodePtr root);
+void db_maintenance_schedule (void);
 
 #endif
@@ -20,10 +20,18 @@
  */
 
 #include "dbus.h"
+#include "db.h"
 #include "debug.h"
+#include "feed.h"
+#include "feed_parser.h"
 #include "feedlist.h"
+#include "item_header.h"
+#include "itemset.h"
+#include "net.h"
 #include "net_monitor.h"
 #include "subscription.h"
+#include "update.h"
+#include "ui/feed_list_node.h"
 #include "ui/liferea_shell.h"
 
 static GDBusNodeInfo *introspection_data = NULL;
@@ -51,6 +59,12 @@ static const gchar introspection_xml[] =
 "    <method name='Refresh'>"
 "      <arg name='result' type='b' direction='out' />"
 "    </method>"
+"    <method name='GetStatistics'>"
+"      <arg name='statistics' type='a{sv}' direction='out' />"
+"    </method>"
+"    <signal name='Statistics'>"
+"      <arg name='statistics' type='a{sv}' />"
+"    </signal>"
 "  </interface>"
 "</node>";
 
@@ -96,6 +110,148 @@ liferea_dbus_refresh (LifereaDBus *self, GError **err)
 	return TRUE;
 }
 
+static void
+liferea_dbus_add_latency (GVariantBuilder *builder, const gchar *name, const metricsHistogram *histogram)
+{
+	gchar *key;
+
+	key = g_strdup_printf ("%s-count", name);
+	g_variant_builder_add (builder, "{sv}", key, g_variant_new_uint64 (histogram->count));
+	g_free (key);
+
+	key = g_strdup_printf ("%s-p50-ms", name);
+	g_variant_builder_add (builder, "{sv}", key, g_variant_new_double (metrics_histogram_percentile (histogram, 50) / 1000.0));
+	g_free (key);
+
+	key = g_strdup_printf ("%s-p95-ms", name);
+	g_variant_builder_add (builder, "{sv}", key, g_variant_new_double (metrics_histogram_percentile (histogram, 95) / 1000.0));
+	g_free (key);
+}
+
+static gdouble
+liferea_dbus_ratio (gulong part, gulong total)
+{
+	return total?((gdouble)part / total):0.0;
+}
+
+/* Collects the counters of the update pipeline, the network code
+   and the DB layer. Latencies are upper bounds in milliseconds.
+   Counting DB rows needs queries, so it is only done on request. */
+static GVariant *
+liferea_dbus_get_statistics (LifereaDBus *self, gboolean rowCounts, GError **err)
+{
+	GVariantBuilder	builder, hosts;
+	GHashTableIter	iter;
+	gpointer	host, count, health;
+	guint		queued, active, cached;
+	guint64		bytes;
+	gulong		responses, notModified, imUsed, hits, misses;
+	gulong		items, itemMetadata, subscriptionMetadata;
+	gulong		loads, lightLoads, detailLoads;
+	gulong		rowUpdates, rowUpdatesSaved;
+	gulong		feedsProcessed, feedsUnchanged;
+	gulong		requests, connections, tlsHandshakes;
+
+	g_variant_builder_init (&builder, G_VARIANT_TYPE ("a{sv}"));
+
+	update_get_job_counts (&queued, &active);
+	g_variant_builder_add (&builder, "{sv}", "update-jobs-queued", g_variant_new_uint32 (queued));
+	g_variant_builder_add (&builder, "{sv}", "update-jobs-active", g_variant_new_uint32 (active));
+
+	g_variant_builder_init (&hosts, G_VARIANT_TYPE ("a{su}"));
+	g_hash_table_iter_init (&iter, network_get_hosts_in_flight ());
+	while (g_hash_table_iter_next (&iter, &host, &count))
+		g_variant_builder_add (&hosts, "{su}", (const gchar *)host, GPOINTER_TO_INT (count));
+	g_variant_builder_add (&builder, "{sv}", "hosts-in-flight", g_variant_builder_end (&hosts));
+
+	/* host -> (state, consecutive failures, seconds until the next probe) */
+	g_variant_builder_init (&hosts, G_VARIANT_TYPE ("a{s(sux)}"));
+	g_hash_table_iter_init (&iter, update_get_failing_hosts ());
+	while (g_hash_table_iter_next (&iter, &host, &health)) {
+		updateHostPtr	h = (updateHostPtr)health;
+		const gchar	*state = h->probing?"probing":(h->retryTime?"parked":"failing");
+
+		g_variant_builder_add (&hosts, "{s(sux)}", (const gchar *)host, state, h->failures,
+		                       MAX (0, h->retryTime - g_get_monotonic_time ()) / G_USEC_PER_SEC);
+	}
+	g_variant_builder_add (&builder, "{sv}", "hosts-failing", g_variant_builder_end (&hosts));
+	g_variant_builder_add (&builder, "{sv}", "updates-postponed", g_variant_new_uint64 (update_get_postponed_count ()));
+
+	liferea_dbus_add_latency (&builder, "download", network_get_download_latency ());
+	liferea_dbus_add_latency (&builder, "parse", feed_parser_get_latency ());
+	liferea_dbus_add_latency (&builder, "merge", itemset_get_merge_latency ());
+	liferea_dbus_add_latency (&builder, "db-item-load", db_item_get_load_latency ());
+	liferea_dbus_add_latency (&builder, "db-item-update", db_item_get_update_latency ());
+
+	network_get_statistics (&bytes, &responses, &notModified, &imUsed);
+	g_variant_builder_add (&builder, "{sv}", "bytes-received", g_variant_new_uint64 (bytes));
+	g_variant_builder_add (&builder, "{sv}", "http-responses", g_variant_new_uint64 (responses));
+	g_variant_builder_add (&builder, "{sv}", "http-not-modified", g_variant_new_uint64 (notModified));
+	g_variant_builder_add (&builder, "{sv}", "http-not-modified-ratio", g_variant_new_double (liferea_dbus_ratio (notModified, responses)));
+	g_variant_builder_add (&builder, "{sv}", "http-im-used", g_variant_new_uint64 (imUsed));
+	g_variant_builder_add (&builder, "{sv}", "downloads-aborted", g_variant_new_uint64 (network_get_aborted_count ()));
+
+	network_get_connection_statistics (&requests, &connections, &tlsHandshakes);
+	g_variant_builder_add (&builder, "{sv}", "http-requests", g_variant_new_uint64 (requests));
+	g_variant_builder_add (&builder, "{sv}", "connections-opened", g_variant_new_uint64 (connections));
+	g_variant_builder_add (&builder, "{sv}", "connection-reuse-ratio", g_variant_new_double (liferea_dbus_ratio (requests - MIN (connections, requests), requests)));
+	g_variant_builder_add (&builder, "{sv}", "tls-handshakes", g_variant_new_uint64 (tlsHandshakes));
+	g_variant_builder_add (&builder, "{sv}", "connect-timeouts", g_variant_new_uint64 (network_get_connect_timeout_count ()));
+
+	feed_get_update_counts (&feedsProcessed, &feedsUnchanged);
+	g_variant_builder_add (&builder, "{sv}", "feed-updates-processed", g_variant_new_uint64 (feedsProcessed));
+	g_variant_builder_add (&builder, "{sv}", "feed-updates-unchanged", g_variant_new_uint64 (feedsUnchanged));
+
+	if (rowCounts) {
+		db_get_row_counts (&items, &itemMetadata, &subscriptionMetadata);
+		g_variant_builder_add (&builder, "{sv}", "db-items", g_variant_new_uint64 (items));
+		g_variant_builder_add (&builder, "{sv}", "db-item-metadata", g_variant_new_uint64 (itemMetadata));
+		g_variant_builder_add (&builder, "{sv}", "db-subscription-metadata", g_variant_new_uint64 (subscriptionMetadata));
+	}
+
+	item_header_get_cache_counts (&hits, &misses, &cached);
+	g_variant_builder_add (&builder, "{sv}", "item-header-cache-size", g_variant_new_uint32 (cached));
+	g_variant_builder_add (&builder, "{sv}", "item-header-cache-hits", g_variant_new_uint64 (hits));
+	g_variant_builder_add (&builder, "{sv}", "item-header-cache-misses", g_variant_new_uint64 (misses));
+	g_variant_builder_add (&builder, "{sv}", "item-header-cache-hit-rate", g_variant_new_double (liferea_dbus_ratio (hits, hits + misses)));
+
+	/* A light item load "hits" when the item details are never needed */
+	db_item_get_load_counts (&loads, &lightLoads, &detailLoads);
+	g_variant_builder_add (&builder, "{sv}", "item-loads", g_variant_new_uint64 (loads));
+	g_variant_builder_add (&builder, "{sv}", "light-item-loads", g_variant_new_uint64 (lightLoads));
+	g_variant_builder_add (&builder, "{sv}", "light-item-hit-rate", g_variant_new_double (liferea_dbus_ratio (lightLoads - MIN (detailLoads, lightLoads), lightLoads)));
+
+	feed_list_node_get_update_counts (&rowUpdates, &rowUpdatesSaved);
+	g_variant_builder_add (&builder, "{sv}", "feed-list-row-updates", g_variant_new_uint64 (rowUpdates));
+	g_variant_builder_add (&builder, "{sv}", "feed-list-row-updates-saved", g_variant_new_uint64 (rowUpdatesSaved));
+
+	return g_variant_builder_end (&builder);
+}
+
+static gboolean
+liferea_dbus_emit_statistics (gpointer user_data)
+{
+	LifereaDBus	*self = LIFEREA_DBUS (user_data);
+	GError		*error = NULL;
+
+	if (!self->connection)
+		return TRUE;
+
+	g_dbus_connection_emit_signal (self->connection,
+	                               NULL,
+	                               LF_DBUS_PATH,
+	                               LF_DBUS_SERVICE,
+	                               "Statistics",
+	                               g_variant_new ("(@a{sv})", liferea_dbus_get_statistics (self, FALSE, NULL)),
+	                               &error);
+	if (error) {
+		debug1 (DEBUG_GUI, "Could not emit statistics signal: %s", error->message);
+		g_error_free (error);
+	}
+
+	return TRUE;
+}
+
 static void
 handle_method_call (GDBusConnection       *connection,
 		    const gchar           *sender,
@@ -139,6 +295,10 @@ handle_method_call (GDBusConnection       *connection,
 		res = liferea_dbus_refresh (self, NULL);
 		g_dbus_method_invocation_return_value (invocation,
 			g_variant_new ("(b)", res));
+	} else if (g_str_equal (method_name, "GetStatistics")) {
+		GVariant *statistics = liferea_dbus_get_statistics (self, TRUE, NULL);
+		g_dbus_method_invocation_return_value (invocation,
+			g_variant_new ("(@a{sv})", statistics));
 	} else {
 		g_warning ("Unknown method name or unknown parameters: %s",
 			   method_name);
@@ -157,7 +317,8 @@ on_bus_acquired (GDBusConnection *connection,
 		 const gchar     *name,
 		 gpointer         user_data)
 {
-	guint id;
+	LifereaDBus	*self = LIFEREA_DBUS (user_data);
+	guint		id;
 
 	debug_enter ("on_bus_acquired");
 
@@ -169,12 +330,17 @@ on_bus_acquired (GDBusConnection *connection,
 						LF_DBUS_PATH,
 						introspection_data->interfaces[0],
 						&interface_vtable,
-						NULL,  /* user_data */
+						self,  /* user_data */
 						NULL,  /* user_data_free_func */
 						NULL); /* GError** */
 
 	g_assert (id > 0);
 
+	/* Periodically publish statistics for monitoring */
+	self->connection = g_object_ref (connection);
+	if (!self->statisticsTimeout)
+		self->statisticsTimeout = g_timeout_add_seconds (LF_DBUS_STATISTICS_INTERVAL, liferea_dbus_emit_statistics, self);
+
 	debug_exit ("on_bus_acquired");
 }
 
@@ -203,6 +369,15 @@ liferea_dbus_dispose (GObject *obj)
 
 	g_bus_unown_name (self->owner_id);
 
+	if (self->statisticsTimeout) {
+		g_source_remove (self->statisticsTimeout);
+		self->statisticsTimeout = 0;
+	}
+	if (self->connection) {
+		g_object_unref (self->connection);
+		self->connection = NULL;
+	}
+
 	G_OBJECT_CLASS (liferea_dbus_parent_class)->dispose (obj);
 }
 
@@ -229,7 +404,7 @@ liferea_dbus_new (void)
 					on_bus_acquired,
 					on_name_acquired,
 					on_name_lost,
-					NULL,
+					obj,
 					NULL);
 
 	debug_exit ("liferea_dbus_new");
@@ -22,14 +22,19 @@
 #ifndef __LIFEREA_DBUS_H__
 #define __LIFEREA_DBUS_H__
 
-#include <glib-object.h>
+#include <gio/gio.h>
 
 #define LF_DBUS_PATH "/org/gnome/feed/Reader"
 #define LF_DBUS_SERVICE "org.gnome.feed.Reader"
 
+/** interval of the "Statistics" signal in seconds */
+#define LF_DBUS_STATISTICS_INTERVAL	60
+
 typedef struct _LifereaDBus {
 	GObject parent;
 	guint owner_id;
+	GDBusConnection *connection;	/**< session bus connection (or NULL) */
+	guint statisticsTimeout;	/**< statistics signal timer source */
 } LifereaDBus;
 
 typedef struct _LifereaDBusClass {
@@ -28,13 +28,14 @@
 #include <stdarg.h>
 #include <stdio.h>
 #include <time.h>
+#include <unistd.h>
 #include <glib.h>
 
 #include "debug.h"
+#include "metrics.h"
 
 unsigned long debug_level = 0;
 static GHashTable * t2d = NULL; /**< per thread call tree depth */
-static GHashTable *startTimes = NULL;
 
 static const char *
 debug_get_prefix (unsigned long flag) 
@@ -79,26 +80,124 @@ debug_get_depth (void)
 	return GPOINTER_TO_INT (g_hash_table_lookup (t2d, self));
 }
 
+/* Measurements are kept as spans on a per thread stack, so they
+   can nest and threads don't interfere. Finished spans are counted
+   in a histogram per span name and, when tracing is enabled, kept
+   as trace events for the Chrome trace event export. */
+
+#define TRACE_FLUSH_EVENTS	256	/* thread buffer size before flushing */
+#define TRACE_MAX_EVENTS	1000000	/* limit of recorded trace events */
+
+typedef struct traceSpan {
+	const char	*function;	/**< key of the measurement */
+	gint64		start;		/**< monotonic start time in us */
+} traceSpan;
+
+typedef struct traceEvent {
+	const char	*name;		/**< interned span name */
+	unsigned long	flags;		/**< debug flags of the measurement */
+	gint64		start;
+	gint64		duration;
+	guint		tid;
+} traceEvent;
+
+typedef struct traceBuffer {
+	GArray		*spans;		/**< open spans (traceSpan) */
+	GArray		*events;	/**< finished events not yet flushed (traceEvent) */
+	guint		tid;		/**< thread number for the trace export */
+} traceBuffer;
+
+int debug_tracing = 0;
+
+static gchar	*traceFile = NULL;
+static gint64	traceStart = 0;
+static GMutex	traceLock;		/* protects all of the following */
+static GArray	*traceEvents = NULL;	/* flushed trace events */
+static guint	traceDropped = 0;
+static GHashTable *traceStatistics = NULL;	/* span name -> metricsHistogram */
+static guint	traceThreads = 0;
+
+static void
+debug_trace_flush (traceBuffer *buffer)
+{
+	guint	space;
+
+	if (!buffer->events->len)
+		return;
+
+	g_mutex_lock (&traceLock);
+	if (!traceEvents)
+		traceEvents = g_array_new (FALSE, FALSE, sizeof (traceEvent));
+	space = TRACE_MAX_EVENTS - MIN (TRACE_MAX_EVENTS, traceEvents->len);
+	g_array_append_vals (traceEvents, buffer->events->data, MIN (space, buffer->events->len));
+	if (buffer->events->len > space)
+		traceDropped += buffer->events->len - space;
+	g_mutex_unlock (&traceLock);
+
+	g_array_set_size (buffer->events, 0);
+}
+
+static void
+debug_trace_buffer_free (gpointer data)
+{
+	traceBuffer *buffer = (traceBuffer *)data;
+
+	/* keep the events of exiting threads */
+	debug_trace_flush (buffer);
+	g_array_free (buffer->spans, TRUE);
+	g_array_free (buffer->events, TRUE);
+	g_free (buffer);
+}
+
+static GPrivate traceBufferKey = G_PRIVATE_INIT (debug_trace_buffer_free);
+
+static traceBuffer *
+debug_trace_get_buffer (void)
+{
+	traceBuffer *buffer = g_private_get (&traceBufferKey);
+
+	if (!buffer) {
+		buffer = g_new0 (traceBuffer, 1);
+		buffer->spans = g_array_new (FALSE, FALSE, sizeof (traceSpan));
+		buffer->events = g_array_new (FALSE, FALSE, sizeof (traceEvent));
+		g_mutex_lock (&traceLock);
+		buffer->tid = ++traceThreads;
+		g_mutex_unlock (&traceLock);
+		g_private_set (&traceBufferKey, buffer);
+	}
+
+	return buffer;
+}
+
+static void
+debug_trace_count (const char *name, gint64 duration)
+{
+	metricsHistogram	*stats;
+
+	g_mutex_lock (&traceLock);
+	if (!traceStatistics)
+		traceStatistics = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+	stats = g_hash_table_lookup (traceStatistics, name);
+	if (!stats) {
+		stats = g_new0 (metricsHistogram, 1);
+		g_hash_table_insert (traceStatistics, (gpointer)name, stats);
+	}
+	metrics_histogram_add (stats, duration);
+	g_mutex_unlock (&traceLock);
+}
+
 void
 debug_start_measurement_func (const char * function)
 {
-	GTimeVal	*startTime = NULL;
+	traceSpan	span;
 	
 	if (!function)
 		return;
-		
-	if (!startTimes)
-		startTimes = g_hash_table_new (g_str_hash, g_str_equal);
-	
-	startTime = (GTimeVal *) g_hash_table_lookup (startTimes, function);
-	
-	if (!startTime)
-	{
-		startTime = g_new0 (GTimeVal, 1);
-		g_hash_table_insert (startTimes, g_strdup(function), startTime);
-	}
 
-	g_get_current_time (startTime);
+	span.function = function;
+	span.start = g_get_monotonic_time ();
+	g_array_append_val (debug_trace_get_buffer ()->spans, span);
 }
 
 void
@@ -106,41 +205,172 @@ debug_end_measurement_func (const char * function,
                             unsigned long flags, 
 			    const char *name)
 {
-	GTimeVal	*startTime = NULL;
-	GTimeVal	endTime;
-	unsigned long	duration = 0;
-	int		i;
+	traceBuffer	*buffer;
+	traceSpan	*span = NULL;
+	gint64		duration;
+	guint		i, depth;
 		
 	if (!function)
 		return;
-		
-	if (!startTimes)
-		return;
-	
-	startTime = g_hash_table_lookup (startTimes, function);
 
-	if (!startTime) 
+	buffer = debug_trace_get_buffer ();
+
+	/* Find the innermost open span of the function. Spans opened
+	   above it were never ended (e.g. an early return without
+	   debug_exit()) and are dropped. */
+	for (depth = buffer->spans->len; depth > 0; depth--) {
+		span = &g_array_index (buffer->spans, traceSpan, depth - 1);
+		if (g_str_equal (span->function, function))
+			break;
+	}
+	if (0 == depth)
 		return;
-		
-	g_get_current_time (&endTime);
-	g_time_val_add (&endTime, (-1) * startTime->tv_usec);
-	
-	if ((0 == endTime.tv_sec - startTime->tv_sec) &&
-	    (0 == endTime.tv_usec/1000))
+
+	duration = g_get_monotonic_time () - span->start;
+	name = g_intern_string (name);
+	debug_trace_count (name, duration);
+
+	if (debug_tracing) {
+		traceEvent event;
+
+		event.name = name;
+		event.flags = flags;
+		event.start = span->start;
+		event.duration = duration;
+		event.tid = buffer->tid;
+		g_array_append_val (buffer->events, event);
+		if (buffer->events->len >= TRACE_FLUSH_EVENTS)
+			debug_trace_flush (buffer);
+	}
+
+	g_array_set_size (buffer->spans, depth - 1);
+
+	if (!(debug_level & flags) || duration < 1000)
 		return;
-	
+
 	g_print ("%s: ", debug_get_prefix (flags));
 	if (debug_level & DEBUG_TRACE)
 		g_print ("[%p] ", g_thread_self ());
 	for (i = 0; i < debug_get_depth (); i++) 
 		g_print ("   ");
-	g_print ("= %s took %01ld,%03lds\n", name, 
-	                                   endTime.tv_sec - startTime->tv_sec, 
-					   endTime.tv_usec/1000);
-					     
-	duration = (endTime.tv_sec - startTime->tv_sec)*1000 + endTime.tv_usec/1000;
-	if (duration > 250)
-		debug2 (DEBUG_PERF, "function \"%s\" is slow! Took %dms.", name, duration);
+	g_print ("= %s took %01ld,%03lds\n", name,
+	         (long)(duration / G_USEC_PER_SEC),
+	         (long)((duration % G_USEC_PER_SEC) / 1000));
+
+	if (duration > 250 * 1000)
+		debug2 (DEBUG_PERF, "function \"%s\" is slow! Took %ldms.", name, (long)(duration / 1000));
+}
+
+void
+debug_trace_enable (const char *filename)
+{
+	g_free (traceFile);
+	traceFile = g_strdup (filename);
+	traceStart = g_get_monotonic_time ();
+	debug_tracing = 1;
+}
+
+static void
+debug_trace_write_string (GString *json, const char *str)
+{
+	g_string_append_c (json, '"');
+	for (; *str; str++) {
+		if (*str == '"' || *str == '\\')
+			g_string_append_c (json, '\\');
+		if ((guchar)*str < 0x20)
+			g_string_append_printf (json, "\\u%04x", (guchar)*str);
+		else
+			g_string_append_c (json, *str);
+	}
+	g_string_append_c (json, '"');
+}
+
+static void
+debug_trace_save (void)
+{
+	GString	*json;
+	GError	*error = NULL;
+	guint	i;
+
+	json = g_string_new ("{\"traceEvents\": [\n");
+	for (i = 0; traceEvents && i < traceEvents->len; i++) {
+		traceEvent	*event = &g_array_index (traceEvents, traceEvent, i);
+		gchar		*category = g_strstrip (g_strdup (debug_get_prefix (event->flags)));
+
+		/* complete events, times are in us */
+		g_string_append (json, "{\"name\": ");
+		debug_trace_write_string (json, event->name);
+		g_string_append_printf (json, ", \"cat\": \"%s\", \"ph\": \"X\", \"ts\": %" G_GINT64_FORMAT
+		                        ", \"dur\": %" G_GINT64_FORMAT ", \"pid\": %d, \"tid\": %u}%s\n",
+		                        category,
+		                        event->start - traceStart, event->duration, (int)getpid (), event->tid,
+		                        (i + 1 < traceEvents->len)?",":"");
+		g_free (category);
+	}
+	g_string_append (json, "],\n\"displayTimeUnit\": \"ms\"}\n");
+
+	if (!g_file_set_contents (traceFile, json->str, json->len, &error)) {
+		g_warning ("Could not write trace file \"%s\": %s", traceFile, error->message);
+		g_error_free (error);
+	}
+	if (traceDropped)
+		g_warning ("Trace event limit reached, %u events were dropped!", traceDropped);
+
+	g_string_free (json, TRUE);
+}
+
+static gint
+debug_trace_compare_total (gconstpointer a, gconstpointer b)
+{
+	const metricsHistogram *s1 = g_hash_table_lookup (traceStatistics, *(const char **)a);
+	const metricsHistogram *s2 = g_hash_table_lookup (traceStatistics, *(const char **)b);
+
+	return (s1->total < s2->total) - (s1->total > s2->total);
+}
+
+static void
+debug_trace_print_statistics (void)
+{
+	GPtrArray	*names;
+	GHashTableIter	iter;
+	gpointer	name;
+	guint		i;
+
+	names = g_ptr_array_new ();
+	g_hash_table_iter_init (&iter, traceStatistics);
+	while (g_hash_table_iter_next (&iter, &name, NULL))
+		g_ptr_array_add (names, name);
+	g_ptr_array_sort (names, debug_trace_compare_total);
+
+	g_print ("%s: %-36s %8s %10s %9s %9s %9s %9s\n", debug_get_prefix (DEBUG_PERF),
+	         "measurement", "count", "total ms", "avg ms", "p50 ms", "p99 ms", "max ms");
+	for (i = 0; i < names->len; i++) {
+		metricsHistogram *stats = g_hash_table_lookup (traceStatistics, g_ptr_array_index (names, i));
+
+		g_print ("%s: %-36s %8lu %10.1f %9.3f %9.3f %9.3f %9.3f\n", debug_get_prefix (DEBUG_PERF),
+		         (const char *)g_ptr_array_index (names, i), stats->count,
+		         stats->total / 1000.0, stats->total / 1000.0 / stats->count,
+		         metrics_histogram_percentile (stats, 50) / 1000.0,
+		         metrics_histogram_percentile (stats, 99) / 1000.0,
+		         stats->max / 1000.0);
+	}
+	g_ptr_array_free (names, TRUE);
+}
+
+void
+debug_trace_finish (void)
+{
+	traceBuffer *buffer = g_private_get (&traceBufferKey);
+
+	if (buffer)
+		debug_trace_flush (buffer);
+
+	g_mutex_lock (&traceLock);
+	if (traceFile)
+		debug_trace_save ();
+	if (traceStatistics && (debug_level & DEBUG_PERF))
+		debug_trace_print_statistics ();
+	g_mutex_unlock (&traceLock);
 }
  
 void
@@ -213,7 +443,7 @@ debug_enter (const char *name)
 {
 	debug1 (DEBUG_TRACE, "+ %s", name);
 	
-	if (debug_level & DEBUG_PERF)
+	if ((debug_level & DEBUG_PERF) || debug_tracing)
 		debug_start_measurement_func (name);
 }
 
@@ -222,6 +452,6 @@ debug_exit (const char *name)
 {
 	debug1 (DEBUG_TRACE, "- %s", name);
 	
-	if (debug_level & DEBUG_PERF)
+	if ((debug_level & DEBUG_PERF) || debug_tracing)
 		debug_end_measurement_func (name, DEBUG_PERF, name);
 }
@@ -42,28 +42,47 @@ typedef enum
 DebugFlags;
 
 /**
- * Method to save start time for a measurement.
+ * Method to start a measurement span. Spans are kept per thread
+ * and may be nested, also for recursive calls of a function.
  *
  * @param level		debugging flags that enable the measurement
- *
- * Not thread-safe!
  */
 extern void debug_start_measurement_func (const char * function);
 
-#define debug_start_measurement(level) if ((debug_level) & level) debug_start_measurement_func (PRETTY_FUNCTION)
+#define debug_start_measurement(level) if (((debug_level) & level) || debug_tracing) debug_start_measurement_func (PRETTY_FUNCTION)
 
 /**
- * Method to calculate the duration for a measurement.
- * The result will be printed to the debug trace.
+ * Method to end the innermost measurement span of the calling
+ * function. The duration is added to the statistics of the given
+ * measurement name and printed to the debug trace when the
+ * debugging flags are enabled.
  *
  * @param level		debugging flags that enable the measurement
  * @param name		name of the measurement
- *
- * Not thread-safe!
  */
 extern void debug_end_measurement_func (const char * function, unsigned long flags, const char *name);
 
-#define debug_end_measurement(level, name) if ((debug_level) & level) debug_end_measurement_func (PRETTY_FUNCTION, level, name)
+#define debug_end_measurement(level, name) if (((debug_level) & level) || debug_tracing) debug_end_measurement_func (PRETTY_FUNCTION, level, name)
+
+/**
+ * Enables recording of all measurements regardless of the
+ * debugging flags. The recorded spans are written on
+ * debug_trace_finish() as Chrome trace event JSON that can
+ * be loaded into chrome://tracing or other trace viewers.
+ *
+ * @param filename	the trace file to write
+ */
+extern void debug_trace_enable (const char *filename);
+
+/**
+ * Writes the trace file if tracing is enabled and prints
+ * duration statistics per measurement name when performance
+ * debugging (--debug-perf) is active. To be called on shutdown.
+ */
+extern void debug_trace_finish (void);
+
+/** non-zero if all measurements are to be recorded */
+extern int debug_tracing;
 
 /**
  * Enable debugging for one or more of the given debugging flags.
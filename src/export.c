@@ -19,11 +19,13 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
-#include <sys/stat.h>
+#include <glib/gstdio.h>
 
 #include "export.h"
 
 #include <libxml/tree.h>
+#include <libxml/xmlreader.h>
+#include <libxml/xmlwriter.h>
 
 #include "auth.h"
 #include "common.h"
@@ -131,83 +133,253 @@ export_node_children (nodePtr node, xmlNodePtr cur, gboolean trusted)
 	node_foreach_child_data (node, export_append_node_tag, &params);
 }
 
-gboolean
-export_OPML_feedlist (const gchar *filename, nodePtr node, gboolean trusted)
+/* The feed list is written asynchronously. On the main loop only a
+   detached OPML DOM is built as a snapshot of the feed list (the
+   node type export methods need the nodes and fill DOM nodes). The
+   snapshot is then serialized by a worker thread using a streaming
+   text writer and only written (atomically using a temporary file)
+   if it differs from what was last written to the file. */
+
+typedef struct exportJob {
+	gchar		*filename;
+	xmlDocPtr	doc;		/**< feed list snapshot, owned by the job */
+	gboolean	trusted;
+} *exportJobPtr;
+
+static GThreadPool	*exportPool = NULL;	/**< single thread serializing all exports */
+static GMutex		exportLock;		/**< protects exportChecksums */
+static GHashTable	*exportChecksums = NULL; /**< filename -> checksum of the last written file */
+
+static xmlDocPtr
+export_OPML_snapshot (nodePtr node, gboolean trusted)
 {
 	xmlDocPtr 	doc;
 	xmlNodePtr 	cur, opmlNode;
-	gboolean	error = FALSE;
-	gchar		*backupFilename;
-	int		old_umask = 0;
 
-	debug_enter ("export_OPML_feedlist");
-	
-	backupFilename = g_strdup_printf ("%s~", filename);
-	
-	doc = xmlNewDoc ("1.0");
-	if (doc) {	
-		opmlNode = xmlNewDocNode (doc, NULL, BAD_CAST"opml", NULL);
-		if (opmlNode) {
-			xmlNewProp (opmlNode, BAD_CAST"version", BAD_CAST"1.0");
-			
-			/* create head */
-			cur = xmlNewChild (opmlNode, NULL, BAD_CAST"head", NULL);
-			if (cur)
-				xmlNewTextChild (cur, NULL, BAD_CAST"title", BAD_CAST"Liferea Feed List Export");
-			
-			/* create body with feed list */
-			cur = xmlNewChild (opmlNode, NULL, BAD_CAST"body", NULL);
-			if (cur)
-				export_node_children (node, cur, trusted);
-			
-			xmlDocSetRootElement (doc, opmlNode);		
-		} else {
-			g_warning ("could not create XML feed node for feed cache document!");
-			error = TRUE;
-		}
-		
-		if (!trusted)
-			old_umask = umask (022);	/* give read permissions for other, per-default we wouldn't give it... */
+	doc = xmlNewDoc (BAD_CAST"1.0");
+	opmlNode = xmlNewDocNode (doc, NULL, BAD_CAST"opml", NULL);
+	xmlNewProp (opmlNode, BAD_CAST"version", BAD_CAST"1.0");
+	xmlDocSetRootElement (doc, opmlNode);
 
-		xmlSetDocCompressMode (doc, 0);
+	/* create head */
+	cur = xmlNewChild (opmlNode, NULL, BAD_CAST"head", NULL);
+	xmlNewTextChild (cur, NULL, BAD_CAST"title", BAD_CAST"Liferea Feed List Export");
 
-		if (-1 == xmlSaveFormatFile (backupFilename, doc, TRUE)) {
-			g_warning ("Could not export to OPML file!");
-			error = TRUE;
+	/* create body with feed list */
+	cur = xmlNewChild (opmlNode, NULL, BAD_CAST"body", NULL);
+	export_node_children (node, cur, trusted);
+
+	return doc;
+}
+
+static int
+export_write_element (xmlTextWriterPtr writer, xmlNodePtr cur)
+{
+	xmlAttrPtr	attr;
+	xmlChar		*value;
+	int		res = 0;
+
+	for (; cur && res >= 0; cur = cur->next) {
+		if (XML_TEXT_NODE == cur->type) {
+			res = xmlTextWriterWriteString (writer, cur->content);
+			continue;
 		}
-		
-		if (!trusted)
-			umask (old_umask);
-			
-		xmlFreeDoc (doc);
-		
-		if (!error) {
-			if (rename (backupFilename, filename) < 0) {
-				g_warning (_("Error renaming %s to %s\n"), backupFilename, filename);
-				error = TRUE;
-			}
+
+		if (XML_ELEMENT_NODE != cur->type)
+			continue;
+
+		res = xmlTextWriterStartElement (writer, cur->name);
+		for (attr = cur->properties; attr && res >= 0; attr = attr->next) {
+			value = xmlNodeGetContent ((xmlNodePtr)attr);
+			res = xmlTextWriterWriteAttribute (writer, attr->name, value?value:BAD_CAST"");
+			xmlFree (value);
 		}
-	} else {
-		g_warning ("Could not create XML document!");
-		error = TRUE;
+
+		if (res >= 0 && cur->children)
+			res = export_write_element (writer, cur->children);
+
+		if (res >= 0)
+			res = xmlTextWriterEndElement (writer);
 	}
-	
-	g_free (backupFilename);
-	
-	debug_exit ("export_OPML_feedlist");
-	return !error;
+
+	return res;
+}
+
+/* Serializes the snapshot into a buffer, returns NULL on error */
+static xmlBufferPtr
+export_OPML_serialize (xmlDocPtr doc)
+{
+	xmlTextWriterPtr	writer;
+	xmlBufferPtr		buffer;
+	int			res;
+
+	buffer = xmlBufferCreate ();
+	writer = xmlNewTextWriterMemory (buffer, 0);
+	if (!writer) {
+		xmlBufferFree (buffer);
+		return NULL;
+	}
+
+	xmlTextWriterSetIndent (writer, 1);
+	res = xmlTextWriterStartDocument (writer, "1.0", "UTF-8", NULL);
+	if (res >= 0)
+		res = export_write_element (writer, xmlDocGetRootElement (doc));
+	if (res >= 0)
+		res = xmlTextWriterEndDocument (writer);
+
+	xmlFreeTextWriter (writer);	/* flushes the buffer */
+
+	if (res < 0) {
+		xmlBufferFree (buffer);
+		return NULL;
+	}
+
+	return buffer;
+}
+
+static gboolean
+export_OPML_write (exportJobPtr job)
+{
+	xmlBufferPtr	buffer;
+	GError		*error = NULL;
+	gchar		*checksum;
+	gboolean	unchanged;
+
+	debug_start_measurement (DEBUG_CACHE);
+
+	buffer = export_OPML_serialize (job->doc);
+	if (!buffer) {
+		g_warning ("Could not export to OPML file!");
+		return FALSE;
+	}
+
+	checksum = g_compute_checksum_for_data (G_CHECKSUM_SHA1, xmlBufferContent (buffer), xmlBufferLength (buffer));
+
+	g_mutex_lock (&exportLock);
+	if (!exportChecksums)
+		exportChecksums = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	unchanged = !g_strcmp0 (checksum, g_hash_table_lookup (exportChecksums, job->filename));
+	g_mutex_unlock (&exportLock);
+
+	if (unchanged && g_file_test (job->filename, G_FILE_TEST_EXISTS)) {
+		debug1 (DEBUG_CACHE, "OPML export to %s skipped, feed list is unchanged", job->filename);
+		g_free (checksum);
+		xmlBufferFree (buffer);
+		debug_end_measurement (DEBUG_CACHE, "OPML export (unchanged)");
+		return TRUE;
+	}
+
+	/* Writes a temporary file and renames it */
+	if (!g_file_set_contents (job->filename, (const gchar *)xmlBufferContent (buffer), xmlBufferLength (buffer), &error)) {
+		g_warning ("Could not export to OPML file %s: %s", job->filename, error->message);
+		g_error_free (error);
+		g_free (checksum);
+		xmlBufferFree (buffer);
+		return FALSE;
+	}
+
+	/* give read permissions for other, per-default we wouldn't give it... */
+	if (!job->trusted)
+		g_chmod (job->filename, 0644);
+
+	g_mutex_lock (&exportLock);
+	g_hash_table_insert (exportChecksums, g_strdup (job->filename), checksum);
+	g_mutex_unlock (&exportLock);
+
+	xmlBufferFree (buffer);
+
+	debug_end_measurement (DEBUG_CACHE, "OPML export");
+
+	return TRUE;
+}
+
+static exportJobPtr
+export_job_new (const gchar *filename, nodePtr node, gboolean trusted)
+{
+	exportJobPtr job = g_new0 (struct exportJob, 1);
+
+	job->filename = g_strdup (filename);
+	job->doc = export_OPML_snapshot (node, trusted);
+	job->trusted = trusted;
+
+	return job;
+}
+
+static void
+export_job_free (exportJobPtr job)
+{
+	xmlFreeDoc (job->doc);
+	g_free (job->filename);
+	g_free (job);
 }
 
 static void
-import_parse_outline (xmlNodePtr cur, nodePtr parentNode, gboolean trusted)
+export_OPML_thread (gpointer data, gpointer user_data)
+{
+	exportJobPtr job = (exportJobPtr)data;
+
+	export_OPML_write (job);
+	export_job_free (job);
+}
+
+void
+export_OPML_flush (void)
+{
+	if (!exportPool)
+		return;
+
+	/* wait for all queued exports */
+	g_thread_pool_free (exportPool, FALSE, TRUE);
+	exportPool = NULL;
+}
+
+gboolean
+export_OPML_feedlist (const gchar *filename, nodePtr node, gboolean trusted)
+{
+	exportJobPtr	job;
+	gboolean	success;
+
+	debug_enter ("export_OPML_feedlist");
+
+	/* earlier asynchronous exports must not overwrite this one */
+	export_OPML_flush ();
+
+	job = export_job_new (filename, node, trusted);
+	success = export_OPML_write (job);
+	export_job_free (job);
+
+	debug_exit ("export_OPML_feedlist");
+
+	return success;
+}
+
+void
+export_OPML_feedlist_async (const gchar *filename, nodePtr node, gboolean trusted)
+{
+	debug_enter ("export_OPML_feedlist_async");
+
+	/* One thread only, so exports are written in order */
+	if (!exportPool)
+		exportPool = g_thread_pool_new (export_OPML_thread, NULL, 1, FALSE, NULL);
+
+	g_thread_pool_push (exportPool, export_job_new (filename, node, trusted), NULL);
+
+	debug_exit ("export_OPML_feedlist_async");
+}
+
+/* Creates the node of an outline and adds it to the feed list,
+   the node type specific import happens in import_outline_finish()
+   after all child outlines are imported. */
+static nodePtr
+import_outline_start (xmlNodePtr cur, nodePtr parentNode, gboolean trusted, gboolean *needsUpdate)
 {
 	gchar		*title, *typeStr, *tmp, *sortStr;
-	xmlNodePtr	child;
 	nodePtr		node;
 	nodeTypePtr	type = NULL;
-	gboolean	needsUpdate = FALSE;
 	
-	debug_enter("import_parse_outline");
+	debug_enter("import_outline_start");
+
+	*needsUpdate = FALSE;
 
 	/* 1. determine node type */
 	typeStr = xmlGetProp (cur, BAD_CAST"type");
@@ -265,10 +437,10 @@ import_parse_outline (xmlNodePtr cur, nodePtr parentNode, gboolean trusted)
 			node_set_id (node, id);
 			xmlFree (id);
 		} else {
-			needsUpdate = TRUE;
+			*needsUpdate = TRUE;
 		}
 	} else {
-		needsUpdate = TRUE;
+		*needsUpdate = TRUE;
 	}
 	
 	/* title */
@@ -333,18 +505,20 @@ import_parse_outline (xmlNodePtr cur, nodePtr parentNode, gboolean trusted)
 	/* 4. add to GUI parent */
 	feedlist_node_imported (node);
 
-	/* 5. import child nodes */
-	if (IS_FOLDER (node)) {
-		child = cur->xmlChildrenNode;
-		while (child) {
-			if (!xmlStrcmp (child->name, BAD_CAST"outline"))
-				import_parse_outline (child, node, trusted);
-			child = child->next;				
-		}
-	}
-	
+	debug_exit ("import_outline_start");
+
+	return node;
+}
+
+static void
+import_outline_finish (xmlNodePtr cur, nodePtr node, gboolean needsUpdate, gboolean trusted)
+{
+	debug_enter ("import_outline_finish");
+
+	/* 5. child nodes were imported by the caller */
+
 	/* 6. do node type specific parsing */
-	NODE_TYPE (node)->import (node, parentNode, cur, trusted);
+	NODE_TYPE (node)->import (node, node->parent, cur, trusted);
 
 	if (node->subscription) {
 		/* Handle OPML auth info (imported from subscription_import() */
@@ -356,10 +530,10 @@ import_parse_outline (xmlNodePtr cur, nodePtr parentNode, gboolean trusted)
 			liferea_auth_info_query (node->id);
 		}
 
-		/* 7. update immediately if necessary */
+		/* 7. update soon if necessary */
 		if (needsUpdate) {
-			debug1 (DEBUG_CACHE, "seems to be an import, setting new id: %s and doing first download...", node_get_id(node));
-			subscription_update (node->subscription, 0);
+			debug1 (DEBUG_CACHE, "seems to be an import, setting new id: %s and scheduling first download...", node_get_id(node));
+			subscription_schedule_update (node->subscription);
 		}
 	}
 
@@ -368,91 +542,165 @@ import_parse_outline (xmlNodePtr cur, nodePtr parentNode, gboolean trusted)
 	   silentely fail to work without node entry. */
 	db_node_update (node);
 
-	debug_exit ("import_parse_outline");
+	debug_exit ("import_outline_finish");
 }
 
+/** A folder outline whose child outlines are being imported */
+typedef struct importFolder {
+	nodePtr		node;
+	gboolean	needsUpdate;
+	gint		depth;		/**< reader depth of the folder outline */
+} *importFolderPtr;
+
 static void
-import_parse_body (xmlNodePtr n, nodePtr parentNode, gboolean trusted)
+import_parse_head (xmlNodePtr head, nodePtr parentNode)
 {
-	xmlNodePtr cur;
-	
-	cur = n->xmlChildrenNode;
-	while (cur) {
-		if (!xmlStrcmp (cur->name, BAD_CAST"outline"))
-			import_parse_outline (cur, parentNode, trusted);
-		cur = cur->next;
+	xmlNodePtr	cur;
+
+	for (cur = head->xmlChildrenNode; cur; cur = cur->next) {
+		if (cur->type == XML_ELEMENT_NODE && !xmlStrcmp (cur->name, BAD_CAST"title")) {
+			xmlChar *titleStr = xmlNodeListGetString (cur->doc, cur->xmlChildrenNode, 1);
+			if (titleStr) {
+				node_set_title (parentNode, titleStr);
+				xmlFree (titleStr);
+			}
+			break;
+		}
 	}
 }
 
-static void
-import_parse_OPML (xmlNodePtr n, nodePtr parentNode, gboolean trusted)
+/* The OPML document is streamed, so only the outline currently
+   parsed and its open parent folders are kept in memory. Outlines
+   other than non-empty folders are expanded into a subtree, so the
+   node type specific import can access child elements (e.g. the
+   rules of search folders). Returns the result of the last reader
+   step: 0 at the end of the document, -1 on errors. */
+static gint
+import_parse_OPML (xmlTextReaderPtr reader, const gchar *filename, nodePtr parentNode, gboolean showErrors, gboolean trusted, gboolean *empty)
 {
-	xmlNodePtr cur;
-	
-	cur = n->xmlChildrenNode;
-	while (cur) {
-		/* we ignore the head */
-		if (!xmlStrcmp (cur->name, BAD_CAST"body")) {
-			import_parse_body (cur, parentNode, trusted);
+	GSList		*folders = NULL;
+	gint		ret;
+
+	ret = xmlTextReaderRead (reader);
+	while (1 == ret) {
+		importFolderPtr	folder = folders?(importFolderPtr)folders->data:NULL;
+		const xmlChar	*name = xmlTextReaderConstLocalName (reader);
+		gint		depth = xmlTextReaderDepth (reader);
+		xmlNodePtr	cur;
+		nodePtr		node;
+		gboolean	needsUpdate;
+
+		if (XML_READER_TYPE_END_ELEMENT == xmlTextReaderNodeType (reader)) {
+			if (folder && folder->depth == depth) {
+				import_outline_finish (xmlTextReaderCurrentNode (reader), folder->node, folder->needsUpdate, trusted);
+				folders = g_slist_delete_link (folders, folders);
+				g_free (folder);
+			}
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		if (XML_READER_TYPE_ELEMENT != xmlTextReaderNodeType (reader)) {
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		if (0 == depth) {
+			*empty = FALSE;
+			if (xmlStrcmp (name, BAD_CAST"opml")) {
+				if (showErrors)
+					ui_show_error_box (_("\"%s\" is not a valid OPML document! Liferea cannot import this file!"), filename);
+				else
+					g_warning (_("\"%s\" is not a valid OPML document! Liferea cannot import this file!"), filename);
+				return 0;
+			}
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		if (1 == depth && !xmlStrcmp (name, BAD_CAST"body")) {
+			ret = xmlTextReaderRead (reader);
+			continue;
+		}
+
+		/* set title only when importing as folder and not as OPML source */
+		if (1 == depth && !trusted && !xmlStrcmp (name, BAD_CAST"head")) {
+			cur = xmlTextReaderExpand (reader);
+			if (cur)
+				import_parse_head (cur, parentNode);
+		}
+
+		/* Besides the body only outlines of folders are descended into,
+		   everything else including the head is skipped. */
+		if (1 == depth || xmlStrcmp (name, BAD_CAST"outline")) {
+			ret = xmlTextReaderNext (reader);
+			continue;
+		}
+
+		node = import_outline_start (xmlTextReaderCurrentNode (reader), folder?folder->node:parentNode, trusted, &needsUpdate);
+
+		if (IS_FOLDER (node) && !xmlTextReaderIsEmptyElement (reader)) {
+			folder = g_new0 (struct importFolder, 1);
+			folder->node = node;
+			folder->needsUpdate = needsUpdate;
+			folder->depth = depth;
+			folders = g_slist_prepend (folders, folder);
+			ret = xmlTextReaderRead (reader);
+		} else {
+			cur = xmlTextReaderExpand (reader);
+			if (!cur)
+				cur = xmlTextReaderCurrentNode (reader);
+			import_outline_finish (cur, node, needsUpdate, trusted);
+			ret = xmlTextReaderNext (reader);
 		}
-		cur = cur->next;
-	}	
+	}
+
+	/* On errors still finish the folders already added
+	   (folders do not import anything from the outline) */
+	while (folders) {
+		importFolderPtr folder = (importFolderPtr)folders->data;
+		import_outline_finish (NULL, folder->node, folder->needsUpdate, trusted);
+		folders = g_slist_delete_link (folders, folders);
+		g_free (folder);
+	}
+
+	return ret;
 }
 
 gboolean
 import_OPML_feedlist (const gchar *filename, nodePtr parentNode, gboolean showErrors, gboolean trusted)
 {
-	xmlDocPtr 	doc;
-	xmlNodePtr 	cur;
-	gboolean	error = FALSE;
+	xmlTextReaderPtr	reader;
+	gboolean		error = FALSE, empty = TRUE;
 	
 	debug1 (DEBUG_CACHE, "Importing OPML file: %s", filename);
-	
+
+	/* Nodes are written to the DB in a single transaction
+	   and added to the feed list view all at once. */
+	db_begin_bulk_update ();
+	feedlist_begin_bulk_import ();
+
 	/* read the feed list */
-	doc = xmlParseFile (filename);
-	if (!doc) {
+	reader = xmlReaderForFile (filename, NULL, 0);
+	if (!reader || import_parse_OPML (reader, filename, parentNode, showErrors, trusted, &empty) < 0) {
 		if (showErrors)
 			ui_show_error_box (_("XML error while reading OPML file! Could not import \"%s\"!"), filename);
 		else
 			g_warning (_("XML error while reading OPML file! Could not import \"%s\"!"), filename);
 		error = TRUE;
-	} else {
-		cur = xmlDocGetRootElement (doc);
-		if (!cur) {
-			if (showErrors)
-				ui_show_error_box (_("Empty document! OPML document \"%s\" should not be empty when importing."), filename);
-			else
-				g_warning (_("Empty document! OPML document \"%s\" should not be empty when importing."), filename);
-			error = TRUE;
-		} else {
-			if (!trusted) {
-				/* set title only when importing as folder and not as OPML source */
-				xmlNodePtr title = xpath_find (cur, "/opml/head/title"); 
-				if (title) {
-					xmlChar *titleStr = xmlNodeListGetString (title->doc, title->xmlChildrenNode, 1);
-					if (titleStr) {
-						node_set_title (parentNode, titleStr);
-						xmlFree (titleStr);
-					}
-				}
-			}
-		
-			while (cur) {
-				if (!xmlIsBlankNode (cur)) {
-					if (!xmlStrcmp (cur->name, BAD_CAST"opml")) {
-						import_parse_OPML (cur, parentNode, trusted);
-					} else {
-						if (showErrors)
-							ui_show_error_box (_("\"%s\" is not a valid OPML document! Liferea cannot import this file!"), filename);
-						else
-							g_warning (_("\"%s\" is not a valid OPML document! Liferea cannot import this file!"), filename);
-					}
-				}
-				cur = cur->next;
-			}
-		}
-		xmlFreeDoc (doc);
+	} else if (empty) {
+		if (showErrors)
+			ui_show_error_box (_("Empty document! OPML document \"%s\" should not be empty when importing."), filename);
+		else
+			g_warning (_("Empty document! OPML document \"%s\" should not be empty when importing."), filename);
+		error = TRUE;
 	}
+
+	if (reader)
+		xmlFreeTextReader (reader);
+
+	feedlist_end_bulk_import ();
+	db_end_bulk_update ();
 	
 	return !error;
 }
@@ -28,6 +28,7 @@
 /**
  * Exports a given feed list tree. Can be used to export
  * the static feed list but also to export subtrees.
+ * The file is written only if its content changes.
  *
  * @param filename	filename of export file
  * @param node		root node of the tree to export
@@ -39,6 +40,22 @@
  */
 gboolean export_OPML_feedlist(const gchar *filename, nodePtr node, gboolean internal);
 
+/**
+ * Like export_OPML_feedlist() but only takes a snapshot of the
+ * feed list tree and writes it in a background thread.
+ *
+ * @param filename	filename of export file
+ * @param node		root node of the tree to export
+ * @param internal	FALSE if export to other programs
+ *			is requested
+ */
+void export_OPML_feedlist_async (const gchar *filename, nodePtr node, gboolean internal);
+
+/**
+ * Waits until all asynchronous exports are written.
+ */
+void export_OPML_flush (void);
+
 /**
  * Reads an OPML file and inserts it into the feedlist.
  *
@@ -37,14 +37,399 @@
 #include "feed.h"
 #include "html.h"
 #include "metadata.h"
+#include "net.h"
+#include "node.h"
 
-typedef struct faviconDownloadCtxt {
+/* Favicon store
+
+   Decoding and scaling the favicon PNGs of all feeds on startup is
+   expensive. So all icons are kept pre-scaled to 16px and 32px
+   RGBA in a single cache file, which is memory mapped on startup.
+   The pixbufs of stored icons directly use the mapped data.
+
+   Identical icons (usually of feeds from the same host) are stored
+   only once. The PNG files are kept for HTML rendering and to
+   rebuild icons missing in the store.
+
+   File layout (native byte order):
+
+   header	magic, icon count, entry count
+   icons	per icon 16x16 and 32x32 RGBA pixels
+   entries	per favicon id: icon index, id length, id */
+
+#define FAVICON_STORE_MAGIC	0x3149464cu	/* "LFI1" */
+#define FAVICON_STORE_SAVE_DELAY	5	/* seconds */
+
+static const guint faviconSizes[] = { 16, 32 };
+
+#define FAVICON_SIZES	G_N_ELEMENTS (faviconSizes)
+#define FAVICON_ICON_BYTES	((16 * 16 + 32 * 32) * 4)
+
+typedef struct faviconStoreHeader {
+	guint32		magic;
+	guint32		icons;		/**< number of icons */
+	guint32		entries;	/**< number of favicon ids */
+	guint32		reserved;
+} faviconStoreHeader;
+
+typedef struct faviconIcon {
+	gchar		*checksum;			/**< checksum of the pixel data */
+	GdkPixbuf	*pixbufs[FAVICON_SIZES];	/**< pre-scaled icons */
+	guint32		index;				/**< icon index while saving */
+} *faviconIconPtr;
+
+static GHashTable	*faviconIcons = NULL;	/**< checksum -> faviconIconPtr */
+static GHashTable	*faviconIds = NULL;	/**< favicon id -> faviconIconPtr */
+static guint		faviconSaveTimer = 0;
+
+static void
+favicon_icon_free (gpointer data)
+{
+	faviconIconPtr	icon = (faviconIconPtr)data;
+	guint		i;
+
+	for (i = 0; i < FAVICON_SIZES; i++)
+		g_object_unref (icon->pixbufs[i]);
+	g_free (icon->checksum);
+	g_free (icon);
+}
+
+static void
+favicon_store_unmap (guchar *pixels, gpointer data)
+{
+	g_mapped_file_unref ((GMappedFile *)data);
+}
+
+static gchar *
+favicon_store_checksum (GdkPixbuf **pixbufs)
+{
+	GChecksum	*checksum;
+	gchar		*result;
+	guint		i, row;
+
+	checksum = g_checksum_new (G_CHECKSUM_SHA1);
+	for (i = 0; i < FAVICON_SIZES; i++)
+		for (row = 0; row < faviconSizes[i]; row++)
+			g_checksum_update (checksum, gdk_pixbuf_get_pixels (pixbufs[i]) + row * gdk_pixbuf_get_rowstride (pixbufs[i]), faviconSizes[i] * 4);
+	result = g_strdup (g_checksum_get_string (checksum));
+	g_checksum_free (checksum);
+
+	return result;
+}
+
+/* Takes ownership of the given pixbufs */
+static void
+favicon_store_add_icon (const gchar *id, GdkPixbuf **pixbufs)
+{
+	faviconIconPtr	icon;
+	gchar		*checksum;
+	guint		i;
+
+	checksum = favicon_store_checksum (pixbufs);
+	icon = g_hash_table_lookup (faviconIcons, checksum);
+	if (icon) {
+		for (i = 0; i < FAVICON_SIZES; i++)
+			g_object_unref (pixbufs[i]);
+		g_free (checksum);
+	} else {
+		icon = g_new0 (struct faviconIcon, 1);
+		icon->checksum = checksum;
+		for (i = 0; i < FAVICON_SIZES; i++)
+			icon->pixbufs[i] = pixbufs[i];
+		g_hash_table_insert (faviconIcons, icon->checksum, icon);
+	}
+
+	g_hash_table_insert (faviconIds, g_strdup (id), icon);
+}
+
+static void
+favicon_store_load (void)
+{
+	const faviconStoreHeader	*header;
+	GMappedFile	*map;
+	faviconIconPtr	*icons, duplicate;
+	const gchar	*data, *entry, *end;
+	gchar		*filename;
+	gsize		length;
+	guint		i, j;
+
+	faviconIcons = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, favicon_icon_free);
+	faviconIds = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	filename = common_create_cache_filename ("favicons", "icons", "cache");
+	map = g_mapped_file_new (filename, FALSE, NULL);
+	g_free (filename);
+	if (!map)
+		return;
+
+	data = g_mapped_file_get_contents (map);
+	length = g_mapped_file_get_length (map);
+	header = (const faviconStoreHeader *)data;
+	if (length < sizeof (faviconStoreHeader) ||
+	    header->magic != FAVICON_STORE_MAGIC ||
+	    (length - sizeof (faviconStoreHeader)) / FAVICON_ICON_BYTES < header->icons) {
+		debug0 (DEBUG_CACHE, "favicon store is invalid, ignoring it");
+		g_mapped_file_unref (map);
+		return;
+	}
+
+	icons = g_new0 (faviconIconPtr, header->icons);
+	for (i = 0; i < header->icons; i++) {
+		const gchar *pixels = data + sizeof (faviconStoreHeader) + i * FAVICON_ICON_BYTES;
+
+		icons[i] = g_new0 (struct faviconIcon, 1);
+		for (j = 0; j < FAVICON_SIZES; j++) {
+			icons[i]->pixbufs[j] = gdk_pixbuf_new_from_data ((const guchar *)pixels, GDK_COLORSPACE_RGB, TRUE, 8,
+			                                                 faviconSizes[j], faviconSizes[j], faviconSizes[j] * 4,
+			                                                 favicon_store_unmap, g_mapped_file_ref (map));
+			pixels += faviconSizes[j] * faviconSizes[j] * 4;
+		}
+		icons[i]->checksum = favicon_store_checksum (icons[i]->pixbufs);
+		duplicate = g_hash_table_lookup (faviconIcons, icons[i]->checksum);
+		if (duplicate) {
+			favicon_icon_free (icons[i]);
+			icons[i] = duplicate;
+		} else {
+			g_hash_table_insert (faviconIcons, icons[i]->checksum, icons[i]);
+		}
+	}
+
+	entry = data + sizeof (faviconStoreHeader) + header->icons * FAVICON_ICON_BYTES;
+	end = data + length;
+	for (i = 0; i < header->entries && entry + 2 * sizeof (guint32) <= end; i++) {
+		guint32	index, len;
+
+		memcpy (&index, entry, sizeof (guint32));
+		memcpy (&len, entry + sizeof (guint32), sizeof (guint32));
+		entry += 2 * sizeof (guint32);
+		if (index >= header->icons || len > (gsize)(end - entry))
+			break;
+
+		g_hash_table_insert (faviconIds, g_strndup (entry, len), icons[index]);
+		entry += len;
+	}
+
+	debug2 (DEBUG_CACHE, "loaded %u favicons for %u ids from favicon store", header->icons, g_hash_table_size (faviconIds));
+
+	g_free (icons);
+	g_mapped_file_unref (map);
+}
+
+static gboolean
+favicon_store_save (gpointer user_data)
+{
+	faviconStoreHeader	header;
+	GHashTableIter	iter;
+	gpointer	key, value;
+	GByteArray	*data;
+	GSList		*icons = NULL, *icon;
+	GError		*error = NULL;
+	gchar		*filename;
+	guint		i, row;
+
+	faviconSaveTimer = 0;
+
+	/* Only save icons still in use */
+	header.magic = FAVICON_STORE_MAGIC;
+	header.icons = 0;
+	header.entries = g_hash_table_size (faviconIds);
+	header.reserved = 0;
+
+	g_hash_table_iter_init (&iter, faviconIcons);
+	while (g_hash_table_iter_next (&iter, NULL, &value))
+		((faviconIconPtr)value)->index = G_MAXUINT32;
+
+	g_hash_table_iter_init (&iter, faviconIds);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		faviconIconPtr	icon = (faviconIconPtr)value;
+
+		if (icon->index == G_MAXUINT32) {
+			icon->index = header.icons++;
+			icons = g_slist_prepend (icons, icon);
+		}
+	}
+	icons = g_slist_reverse (icons);
+
+	data = g_byte_array_sized_new (sizeof (header) + header.icons * FAVICON_ICON_BYTES);
+	g_byte_array_append (data, (const guint8 *)&header, sizeof (header));
+
+	for (icon = icons; icon; icon = g_slist_next (icon)) {
+		GdkPixbuf **pixbufs = ((faviconIconPtr)icon->data)->pixbufs;
+
+		for (i = 0; i < FAVICON_SIZES; i++)
+			for (row = 0; row < faviconSizes[i]; row++)
+				g_byte_array_append (data, gdk_pixbuf_get_pixels (pixbufs[i]) + row * gdk_pixbuf_get_rowstride (pixbufs[i]), faviconSizes[i] * 4);
+	}
+
+	g_hash_table_iter_init (&iter, faviconIds);
+	while (g_hash_table_iter_next (&iter, &key, &value)) {
+		guint32	index = ((faviconIconPtr)value)->index;
+		guint32	len = strlen ((const gchar *)key);
+
+		g_byte_array_append (data, (const guint8 *)&index, sizeof (guint32));
+		g_byte_array_append (data, (const guint8 *)&len, sizeof (guint32));
+		g_byte_array_append (data, (const guint8 *)key, len);
+	}
+
+	/* A mapped old store stays valid as the new one is written
+	   to a temporary file which replaces it. */
+	filename = common_create_cache_filename ("favicons", "icons", "cache");
+	if (!g_file_set_contents (filename, (const gchar *)data->data, data->len, &error)) {
+		g_warning ("Could not save favicon store %s: %s", filename, error->message);
+		g_error_free (error);
+	} else {
+		debug2 (DEBUG_CACHE, "saved %u favicons for %u ids to favicon store", header.icons, header.entries);
+	}
+	g_free (filename);
+
+	/* Drop icons no longer in use */
+	g_hash_table_iter_init (&iter, faviconIcons);
+	while (g_hash_table_iter_next (&iter, NULL, &value)) {
+		if (((faviconIconPtr)value)->index == G_MAXUINT32)
+			g_hash_table_iter_remove (&iter);
+	}
+
+	g_slist_free (icons);
+	g_byte_array_free (data, TRUE);
+
+	return FALSE;
+}
+
+static void
+favicon_store_schedule_save (void)
+{
+	if (!faviconSaveTimer)
+		faviconSaveTimer = g_timeout_add_seconds (FAVICON_STORE_SAVE_DELAY, favicon_store_save, NULL);
+}
+
+void
+favicon_store_flush (void)
+{
+	if (!faviconSaveTimer)
+		return;
+
+	g_source_remove (faviconSaveTimer);
+	favicon_store_save (NULL);
+}
+
+/* Scales the given icon to all stored sizes and stores it for the given id */
+static void
+favicon_store_update (const gchar *id, GdkPixbuf *pixbuf)
+{
+	GdkPixbuf	*pixbufs[FAVICON_SIZES];
+	guint		i;
+
+	for (i = 0; i < FAVICON_SIZES; i++) {
+		GdkPixbuf *scaled = gdk_pixbuf_scale_simple (pixbuf, faviconSizes[i], faviconSizes[i], GDK_INTERP_BILINEAR);
+
+		pixbufs[i] = gdk_pixbuf_add_alpha (scaled, FALSE, 0, 0, 0);
+		g_object_unref (scaled);
+	}
+
+	favicon_store_add_icon (id, pixbufs);
+	favicon_store_schedule_save ();
+}
+
+GdkPixbuf *
+favicon_load_from_cache (const gchar *id, guint size)
+{
+	struct stat	statinfo;
+	gchar		*filename;
+	GdkPixbuf	*pixbuf;
+	GError 		*error = NULL;
+	faviconIconPtr	icon;
+	guint		i;
+
+	if (!faviconIds)
+		favicon_store_load ();
+
+	icon = g_hash_table_lookup (faviconIds, id);
+	if (!icon) {
+		/* Not yet in the store, so decode the PNG once for all sizes */
+		filename = common_create_cache_filename ("favicons", id, "png");
+		if (0 == stat ((const char*)filename, &statinfo)) {
+			pixbuf = gdk_pixbuf_new_from_file (filename, &error);
+			if (pixbuf && !error) {
+				favicon_store_update (id, pixbuf);
+				g_object_unref (pixbuf);
+				icon = g_hash_table_lookup (faviconIds, id);
+			} else { /* Error */
+				fprintf (stderr, "Failed to load pixbuf file: %s: %s\n",
+				        filename, error->message);
+				g_error_free (error);
+			}
+		}
+		g_free (filename);
+	}
+
+	if (!icon)
+		return NULL;
+
+	for (i = 0; i < FAVICON_SIZES; i++) {
+		if (faviconSizes[i] == size)
+			return g_object_ref (icon->pixbufs[i]);
+	}
+
+	return gdk_pixbuf_scale_simple (icon->pixbufs[FAVICON_SIZES - 1], size, size, GDK_INTERP_BILINEAR);
+}
+
+typedef enum {
+	FAVICON_PENDING,
+	FAVICON_FOUND,
+	FAVICON_MISSING
+} faviconState;
+
+typedef struct faviconDownloadCtxt *faviconDownloadCtxtPtr;
+
+/** A candidate URL of a favicon download */
+typedef struct faviconCandidate {
+	faviconDownloadCtxtPtr	ctxt;
+	faviconState		state;
+	GdkPixbuf		*pixbuf;	/**< the icon if found */
+} *faviconCandidatePtr;
+
+struct faviconDownloadCtxt {
 	gchar		        *id;		/**< favicon cache id */
 	GSList			*urls;		/**< ordered list of URLs to try */
 	updateOptionsPtr	options;	/**< download options */
 	faviconUpdatedCb	callback;	/**< usually feed_favicon_updated() */
 	gpointer		user_data;	/**< usually the node pointer */
-} *faviconDownloadCtxtPtr;
+
+	struct faviconCandidate	*candidates;	/**< one candidate per URL in order of preference */
+	guint			count;		/**< number of candidates */
+	guint			pending;	/**< number of candidates without result */
+	gboolean		done;		/**< TRUE once the favicon was chosen */
+};
+
+/* All candidate URLs of a download are requested at once. As feeds
+   of the same host often share candidates (e.g. the /favicon.ico of
+   the web server) results are kept per host and shared, including
+   negative results. */
+
+#define FAVICON_RESULT_LIFETIME	((gint64)31 * 24 * 60 * 60 * G_USEC_PER_SEC)
+#define FAVICON_ERROR_LIFETIME	((gint64)60 * 60 * G_USEC_PER_SEC)	/* for transport errors */
+
+typedef struct faviconHost *faviconHostPtr;
+
+/** A request shared by all downloads using the same URL */
+typedef struct faviconFetch {
+	faviconHostPtr	host;
+	gchar		*url;
+	gboolean	html;		/**< TRUE if the favicon is to be discovered from a HTML page */
+	faviconState	state;
+	gint64		time;		/**< time of the result */
+	gboolean	transient;	/**< TRUE if the result is a transport error */
+	GdkPixbuf	*pixbuf;	/**< the icon (if found and not HTML) */
+	gchar		*iconUrl;	/**< the discovered icon URL (if found and HTML) */
+	GSList		*waiters;	/**< candidates waiting for the result */
+} *faviconFetchPtr;
+
+struct faviconHost {
+	GHashTable	*fetches;	/**< type and URL -> faviconFetchPtr */
+	gint64		unreachable;	/**< time the host last failed to respond (or 0) */
+};
+
+static GHashTable	*faviconHosts = NULL;	/**< origin -> faviconHostPtr */
 
 static faviconDownloadCtxtPtr
 favicon_download_ctxt_new () 
@@ -56,6 +441,7 @@ static void
 favicon_download_ctxt_free (faviconDownloadCtxtPtr ctxt)
 {
 	GSList  *iter; 
+	guint	i;
 
 	if (!ctxt) return;
 	g_free (ctxt->id);
@@ -63,36 +449,248 @@ favicon_download_ctxt_free (faviconDownloadCtxtPtr ctxt)
 	for (iter = ctxt->urls; iter; iter = g_slist_next (iter))
 		g_free (iter->data);
 
+	for (i = 0; i < ctxt->count; i++) {
+		if (ctxt->candidates[i].pixbuf)
+			g_object_unref (ctxt->candidates[i].pixbuf);
+	}
+
+	g_free (ctxt->candidates);
 	g_slist_free (ctxt->urls);
 	update_options_free (ctxt->options);
+	g_free (ctxt);
+}
+
+static void
+favicon_fetch_free (gpointer data)
+{
+	faviconFetchPtr	fetch = (faviconFetchPtr)data;
+
+	if (fetch->pixbuf)
+		g_object_unref (fetch->pixbuf);
+	g_free (fetch->iconUrl);
+	g_free (fetch->url);
+	g_free (fetch);
 }
 
-static void favicon_download_run(faviconDownloadCtxtPtr ctxt);
+static faviconHostPtr
+favicon_host_lookup (const gchar *url)
+{
+	faviconHostPtr	host;
+	const gchar	*tmp;
+	gchar		*origin;
+
+	if (!faviconHosts)
+		faviconHosts = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	/* scheme, host and port */
+	tmp = strstr (url, "://");
+	tmp = tmp?strchr (tmp + 3, '/'):NULL;
+	origin = tmp?g_strndup (url, tmp - url):g_strdup (url);
+
+	host = g_hash_table_lookup (faviconHosts, origin);
+	if (!host) {
+		host = g_new0 (struct faviconHost, 1);
+		host->fetches = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, favicon_fetch_free);
+		g_hash_table_insert (faviconHosts, origin, host);
+	} else {
+		g_free (origin);
+	}
 
-GdkPixbuf *
-favicon_load_from_cache (const gchar *id, guint size)
+	return host;
+}
+
+static void favicon_fetch (faviconCandidatePtr candidate, const gchar *url, gboolean html);
+
+static void
+favicon_download_finish (faviconDownloadCtxtPtr ctxt, GdkPixbuf *pixbuf)
 {
-	struct stat	statinfo;
-	gchar		*filename;
-	GdkPixbuf	*pixbuf, *result = NULL;
-	GError 		*error = NULL;
+	GError	*err = NULL;
+	gchar	*tmp;
 
-	filename = common_create_cache_filename ("favicons", id, "png");
-	
-	if (0 == stat ((const char*)filename, &statinfo)) {
-		pixbuf = gdk_pixbuf_new_from_file (filename, &error);
-		if (pixbuf && !error) {
-			result = gdk_pixbuf_scale_simple (pixbuf, size, size, GDK_INTERP_BILINEAR);
-			g_object_unref (pixbuf);
-		} else { /* Error */
-			fprintf (stderr, "Failed to load pixbuf file: %s: %s\n",
-			        filename, error->message);
-			g_error_free (error);
+	ctxt->done = TRUE;
+
+	if (pixbuf) {
+		tmp = common_create_cache_filename ("favicons", ctxt->id, "png");
+		debug2 (DEBUG_UPDATE, "saving favicon %s to file %s", ctxt->id, tmp);
+		if (!gdk_pixbuf_save (pixbuf, tmp, "png", &err, NULL)) {
+			g_warning ("Could not save favicon (id=%s) to file %s!", ctxt->id, tmp);
+			g_error_free (err);
+		} else {
+			if (!faviconIds)
+				favicon_store_load ();
+			favicon_store_update (ctxt->id, pixbuf);
 		}
+		g_free (tmp);
+	} else {
+		debug1 (DEBUG_UPDATE, "favicon %s could not be downloaded!", ctxt->id);
 	}
-	g_free (filename);
-	
-	return result;
+
+	/* Run favicon-updated callback, unless the node was
+	   removed while the download was running */
+	if (ctxt->callback && node_from_id (ctxt->id))
+		(ctxt->callback) (ctxt->user_data);
+}
+
+/* Picks the first candidate in order of preference as soon as
+   all candidates before it are known to have failed. */
+static void
+favicon_download_check (faviconDownloadCtxtPtr ctxt)
+{
+	guint	i;
+
+	if (!ctxt->done) {
+		for (i = 0; i < ctxt->count; i++) {
+			if (FAVICON_MISSING != ctxt->candidates[i].state)
+				break;
+		}
+
+		if (i == ctxt->count)
+			favicon_download_finish (ctxt, NULL);
+		else if (FAVICON_FOUND == ctxt->candidates[i].state)
+			favicon_download_finish (ctxt, ctxt->candidates[i].pixbuf);
+	}
+
+	if (0 == ctxt->pending)
+		favicon_download_ctxt_free (ctxt);
+}
+
+static void
+favicon_candidate_result (faviconCandidatePtr candidate, faviconFetchPtr fetch)
+{
+	faviconDownloadCtxtPtr	ctxt = candidate->ctxt;
+
+	if (FAVICON_FOUND == fetch->state && fetch->html) {
+		debug2 (DEBUG_UPDATE, "found link for favicon %s: %s", ctxt->id, fetch->iconUrl);
+		favicon_fetch (candidate, fetch->iconUrl, FALSE);
+		return;
+	}
+
+	candidate->state = fetch->state;
+	if (fetch->pixbuf)
+		candidate->pixbuf = g_object_ref (fetch->pixbuf);
+
+	ctxt->pending--;
+	favicon_download_check (ctxt);
+}
+
+static GdkPixbuf *
+favicon_decode (const struct updateResult * const result)
+{
+	GdkPixbufLoader	*loader;
+	GdkPixbuf	*pixbuf = NULL;
+	GError		*err = NULL;
+
+	/* the MIME type is wrong much too often, so we cannot check it... */
+	loader = gdk_pixbuf_loader_new ();
+	if (gdk_pixbuf_loader_write (loader, (guchar *)result->data, (gsize)result->size, &err)) {
+		if (gdk_pixbuf_loader_close (loader, &err)) {
+			pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
+			if (pixbuf)
+				g_object_ref (pixbuf);
+			else
+				debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_get_pixbuf() failed!");
+		} else {
+			debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_close() failed!");
+		}
+	} else {
+		debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_write() failed!");
+		gdk_pixbuf_loader_close (loader, NULL);
+	}
+
+	if (err) {
+		debug1 (DEBUG_UPDATE, "%s", err->message);
+		g_error_free (err);
+	}
+
+	g_object_unref (loader);
+
+	return pixbuf;
+}
+
+static void
+favicon_fetch_cb (const struct updateResult * const result, gpointer user_data, updateFlags flags)
+{
+	faviconFetchPtr	fetch = (faviconFetchPtr)user_data;
+	GSList		*waiters, *iter;
+
+	debug4 (DEBUG_UPDATE, "favicon download processing (%s, %d bytes, content type %s, HTML %d)", result->source, result->size, result->contentType, fetch->html);
+
+	fetch->state = FAVICON_MISSING;
+	fetch->time = g_get_real_time ();
+
+	if (result->data && result->size > 0 && result->contentType) {
+		if (fetch->html) {
+			fetch->iconUrl = html_discover_favicon (result->data, result->source);
+			if (fetch->iconUrl)
+				fetch->state = FAVICON_FOUND;
+		} else {
+			fetch->pixbuf = favicon_decode (result);
+			if (fetch->pixbuf)
+				fetch->state = FAVICON_FOUND;
+		}
+	} else if (result->httpstatus < 100 && NETWORK_ERROR_HOST_UNAVAILABLE != result->returncode) {
+		/* No HTTP response at all, so don't try the host again */
+		debug1 (DEBUG_UPDATE, "favicon host of %s is unreachable", fetch->url);
+		fetch->host->unreachable = fetch->time;
+		fetch->transient = TRUE;
+	}
+
+	waiters = g_slist_reverse (fetch->waiters);
+	fetch->waiters = NULL;
+	for (iter = waiters; iter; iter = g_slist_next (iter))
+		favicon_candidate_result ((faviconCandidatePtr)iter->data, fetch);
+	g_slist_free (waiters);
+}
+
+static void
+favicon_fetch (faviconCandidatePtr candidate, const gchar *url, gboolean html)
+{
+	updateRequestPtr	request;
+	faviconFetchPtr		fetch;
+	faviconHostPtr		host;
+	gchar			*key;
+	gint64			now = g_get_real_time ();
+
+	host = favicon_host_lookup (url);
+	key = g_strdup_printf ("%s %s", html?"html":"icon", url);
+
+	fetch = g_hash_table_lookup (host->fetches, key);
+	if (fetch && FAVICON_PENDING != fetch->state &&
+	    now - fetch->time > (fetch->transient?FAVICON_ERROR_LIFETIME:FAVICON_RESULT_LIFETIME)) {
+		g_hash_table_remove (host->fetches, key);
+		fetch = NULL;
+	}
+
+	if (!fetch) {
+		fetch = g_new0 (struct faviconFetch, 1);
+		fetch->host = host;
+		fetch->url = g_strdup (url);
+		fetch->html = html;
+		fetch->state = FAVICON_PENDING;
+		g_hash_table_insert (host->fetches, key, fetch);
+		key = NULL;
+
+		if (host->unreachable && now - host->unreachable < FAVICON_ERROR_LIFETIME) {
+			fetch->state = FAVICON_MISSING;
+			fetch->time = now;
+			fetch->transient = TRUE;
+		} else {
+			debug2 (DEBUG_UPDATE, "favicon %s trying URL: %s", candidate->ctxt->id, url);
+
+			request = update_request_new ();
+			request->source = g_strdup (url);
+			request->options = update_options_copy (candidate->ctxt->options);
+
+			/* Owned by the host, as the result is shared by all downloads */
+			update_execute_request (host, request, favicon_fetch_cb, fetch, 0);
+		}
+	}
+	g_free (key);
+
+	if (FAVICON_PENDING == fetch->state)
+		fetch->waiters = g_slist_prepend (fetch->waiters, candidate);
+	else
+		favicon_candidate_result (candidate, fetch);
 }
 
 gboolean
@@ -111,6 +709,9 @@ void favicon_remove_from_cache(const gchar *id) {
 	gchar		*filename;
 
 	debug_enter("favicon_remove");
+
+	if (faviconIds && g_hash_table_remove (faviconIds, id))
+		favicon_store_schedule_save ();
 	
 	/* try to load a saved favicon */
 	filename = common_create_cache_filename ("favicons", id, "png");
@@ -124,120 +725,39 @@ void favicon_remove_from_cache(const gchar *id) {
 }
 
 static void
-favicon_download_icon_cb (const struct updateResult * const result, gpointer user_data, updateFlags flags)
+favicon_download_run (faviconDownloadCtxtPtr ctxt)
 {
-	faviconDownloadCtxtPtr	ctxt = (faviconDownloadCtxtPtr)user_data;
-	gchar		*tmp;
-	GError		*err = NULL;
-	gboolean	success = FALSE;
-	
-	debug4 (DEBUG_UPDATE, "icon download processing (%s, %d bytes, content type %s) for favicon %s", result->source, result->size, result->contentType, ctxt->id);
-
-	if (result->data && 
-	    result->size > 0 && 
-	    result->contentType /*&&*/
-	   /* the MIME type is wrong much too often, so we cannot check it... */
-	   /*(!strncmp("image", result->contentType, 5))*/) {
-		GdkPixbufLoader *loader = gdk_pixbuf_loader_new ();
-		GdkPixbuf *pixbuf;
-		if (gdk_pixbuf_loader_write (loader, (guchar *)result->data, (gsize)result->size, &err)) {
-			if (gdk_pixbuf_loader_close (loader, &err)) {
-				pixbuf = gdk_pixbuf_loader_get_pixbuf (loader);
-				if (pixbuf) {
-					tmp = common_create_cache_filename ("favicons", ctxt->id, "png");
-					debug2 (DEBUG_UPDATE, "saving favicon %s to file %s", ctxt->id, tmp);
-					if (!gdk_pixbuf_save (pixbuf, tmp, "png", &err, NULL)) {
-						g_warning ("Could not save favicon (id=%s) to file %s!", ctxt->id, tmp);
-					} else {
-						success = TRUE;
-						/* Run favicon-updated callback */
-						if (ctxt->callback)
-							(ctxt->callback) (ctxt->user_data);
-					}
-					g_free (tmp);
-				} else {
-					debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_get_pixbuf() failed!");
-				}
-			} else {
-				debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_close() failed!");
-			}
-		} else {
-			debug0 (DEBUG_UPDATE, "gdk_pixbuf_loader_write() failed!");
-			gdk_pixbuf_loader_close (loader, NULL);
-		}
+	GSList	*iter;
+	guint	i;
 
-		if (err) {
-			debug1 (DEBUG_UPDATE, "%s", err->message);
-			g_error_free (err);
-		}
+	debug_enter("favicon_download_run");
 
-		g_object_unref (loader);
-	} else {
-		debug1 (DEBUG_UPDATE, "No data in download result for favicon %s!", ctxt->id);
+	ctxt->count = g_slist_length (ctxt->urls);
+	ctxt->candidates = g_new0 (struct faviconCandidate, ctxt->count);
+	for (i = 0; i < ctxt->count; i++) {
+		ctxt->candidates[i].ctxt = ctxt;
+		ctxt->candidates[i].state = FAVICON_PENDING;
 	}
-	
-	if (!success) {
-		favicon_download_run (ctxt);	/* try next... */
-	} else {
-		favicon_download_ctxt_free (ctxt);
-	}
-}
 
-static void
-favicon_download_html_cb (const struct updateResult * const result, gpointer user_data, updateFlags flags) {
-	faviconDownloadCtxtPtr	ctxt = (faviconDownloadCtxtPtr)user_data;
-	
-	if (result->size > 0 && result->data) {
-		gchar *iconUri = html_discover_favicon (result->data, result->source);
-		if (iconUri) {
-			updateRequestPtr request;
-			
-			debug2 (DEBUG_UPDATE, "found link for favicon %s: %s", ctxt->id, iconUri);
-			request = update_request_new ();
-			request->source = iconUri;
-			request->options = update_options_copy (ctxt->options);
-			update_execute_request (ctxt->user_data, request, favicon_download_icon_cb, ctxt, flags);
-			
-			return;
+	/* Results can be known already, so keep the
+	   context until all candidates are started */
+	ctxt->pending = ctxt->count + 1;
+	for (iter = ctxt->urls, i = 0; iter; iter = g_slist_next (iter), i++) {
+		const gchar *url = (const gchar *)iter->data;
+
+		/* No need for less preferred candidates once a favicon was found */
+		if (ctxt->done) {
+			ctxt->candidates[i].state = FAVICON_MISSING;
+			ctxt->pending--;
+			continue;
 		}
-	}
-	debug1 (DEBUG_UPDATE, "No link for favicon %s found!", ctxt->id);
-
-	favicon_download_run (ctxt);	/* no sucess, try next... */
-}
-
-static void
-favicon_download_run (faviconDownloadCtxtPtr ctxt)
-{
-	gchar			*url;
-	updateRequestPtr	request;
-	update_result_cb	callback;
 
-	debug_enter("favicon_download_run");
-	
-	if (ctxt->urls) {
-		url = (gchar *)ctxt->urls->data;
-		ctxt->urls = g_slist_remove (ctxt->urls, url);
-		debug2 (DEBUG_UPDATE, "favicon %s trying URL: %s", ctxt->id, url);
-
-		request = update_request_new ();
-		request->source = url;
-		request->options = update_options_copy (ctxt->options);
+		favicon_fetch (&ctxt->candidates[i], url, !strstr (url, "/favicon.ico"));
+	}
+	ctxt->pending--;
 
-		if (strstr (url, "/favicon.ico"))
-			callback = favicon_download_icon_cb;	
-		else
-			callback = favicon_download_html_cb;
+	favicon_download_check (ctxt);
 
-		update_execute_request (ctxt->user_data, request, callback, ctxt, FEED_REQ_PRIORITY_HIGH);
-	} else {
-		debug1 (DEBUG_UPDATE, "favicon %s could not be downloaded!", ctxt->id);
-		/* Run favicon-updated callback */
-		if (ctxt->callback)
-			(ctxt->callback) (ctxt->user_data);
-		favicon_download_ctxt_free (ctxt);
-	}
-	
 	debug_exit ("favicon_download_run");
 }
 
@@ -277,7 +797,8 @@ favicon_download (subscriptionPtr subscription,
 	 * This code tries to download from a series of URLs. If there are no
 	 * favicons, this will make five downloads, three of which will be 404
 	 * errors. Hopefully this will not cause any webservers pain because
-	 * this code should be run only once a month per feed.
+	 * this code should be run only once a month per feed and requests
+	 * of feeds from the same host are shared.
 	 *
 	 * 1. --> downloading favicon from the feed (e.g. <icon> tag in atom feeds)
 	 * 2. --> downloading HTML of the feed url and looking for a favicon reference
@@ -288,8 +809,8 @@ favicon_download (subscriptionPtr subscription,
 	 */
 
 	/* In the following These URLs will be prepared here and passed as a list to 
-	   the download function that will then process in order
-	   until success or the end of the list is reached... */
+	   the download function that will request them all and use the first
+	   one in order that succeeds... */
 	debug1(DEBUG_UPDATE, "preparing download URLs for favicon %s...", ctxt->id);
 
 	/* case 1. */
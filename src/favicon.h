@@ -45,6 +45,12 @@ GdkPixbuf * favicon_load_from_cache (const gchar *id, guint size);
  */
 void favicon_remove_from_cache(const gchar *id);
 
+/**
+ * Saves pending changes of the favicon cache at once.
+ * To be called on exit.
+ */
+void favicon_store_flush (void);
+
 /**
  * Checks whether a given favicon needs to be updated 
  *
@@ -209,14 +209,55 @@ feed_get_max_item_count (nodePtr node)
 
 /* implementation of subscription type interface */
 
+static gulong	feedUpdatesProcessed = 0;	/**< feed updates parsed and merged */
+static gulong	feedUpdatesUnchanged = 0;	/**< feed updates skipped because of unchanged content */
+
+void
+feed_get_update_counts (gulong *processed, gulong *unchanged)
+{
+	*processed = feedUpdatesProcessed;
+	*unchanged = feedUpdatesUnchanged;
+}
+
 static void
 feed_process_update_result (subscriptionPtr subscription, const struct updateResult * const result, updateFlags flags)
 {
 	feedParserCtxtPtr	ctxt;
 	nodePtr			node = subscription->node;
 	feedPtr			feed = (feedPtr)node->data;
+	guint64			contentHash = 0;
+	gboolean		delta;
 
 	debug_enter ("feed_process_update_result");
+
+	/* A "226 IM Used" response (RFC 3229 with A-IM: feed) contains
+	   only the entries changed since the ETag we sent. Merging them
+	   works like merging a complete feed, as items missing from the
+	   downloaded feed are never removed, only the cache limit drops
+	   old items. */
+	delta = (226 == result->httpstatus);
+	if (delta)
+		debug1 (DEBUG_UPDATE, "received delta update for \"%s\"", node_get_title (node));
+
+	/* Many servers ignore conditional requests, so detect unchanged
+	   content ourselves and handle it like a HTTP 304. The hash of a
+	   delta says nothing about the complete feed, so it is not kept. */
+	if (result->data && !delta) {
+		contentHash = update_state_get_content_hash (result->updateState);
+		if (!contentHash)
+			contentHash = update_state_hash_content (result->data, result->size);
+	}
+
+	if (contentHash && !(flags & FEED_REQ_RESET_TITLE) &&
+	    contentHash == update_state_get_content_hash (subscription->updateState)) {
+		debug1 (DEBUG_UPDATE, "content of \"%s\" has not changed, skipping parsing", node_get_title (node));
+		feedUpdatesUnchanged++;
+		node->available = TRUE;
+		node->newCount = 0;
+		liferea_shell_set_status_bar (_("\"%s\" has not changed since last update"), node_get_title (node));
+		debug_exit ("feed_process_update_result");
+		return;
+	}
 	
 	if (result->data) {
 		/* parse the new downloaded feed into feed and itemSet */
@@ -251,6 +292,9 @@ feed_process_update_result (subscriptionPtr subscription, const struct updateRes
 			node->newCount = itemset_merge_items (itemSet, ctxt->items, ctxt->feed->valid, ctxt->feed->markAsRead);
 			itemlist_merge_itemset (itemSet);
 			itemset_free (itemSet);
+
+			update_state_set_content_hash (subscription->updateState, contentHash);
+			feedUpdatesProcessed++;
 		
 			/* restore user defined properties if necessary */
 			if ((flags & FEED_REQ_RESET_TITLE) && ctxt->title)
@@ -275,8 +319,13 @@ feed_process_update_result (subscriptionPtr subscription, const struct updateRes
 static gboolean
 feed_prepare_update_request (subscriptionPtr subscription, struct updateRequest *request)
 {
-	/* Nothing to do. Feeds require no subscription extra handling. */
-	
+	/* Allow the download to be aborted early when it is obviously
+	   no feed. HTML is still accepted for feed auto discovery. */
+	request->expectFeed = TRUE;
+
+	/* Keep downloaded feeds until they are merged */
+	request->spoolId = g_strdup (subscription->node->id);
+
 	return TRUE;
 }
 
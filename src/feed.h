@@ -97,6 +97,16 @@ guint feed_get_max_item_count(nodePtr node);
  */
 subscriptionTypePtr feed_get_subscription_type (void);
 
+/**
+ * Returns the number of feed updates that were parsed and merged
+ * and the number of updates skipped because the content was
+ * unchanged since the last update.
+ *
+ * @param processed	returns the number of processed updates
+ * @param unchanged	returns the number of unchanged updates
+ */
+void feed_get_update_counts (gulong *processed, gulong *unchanged);
+
 #define IS_FEED(node) (node->type == feed_get_node_type ())
 
 /**
@@ -23,7 +23,9 @@
 #include "common.h"
 #include "debug.h"
 #include "html.h"
+#include "item.h"
 #include "metadata.h"
+#include "metrics.h"
 #include "xml.h"
 #include "parsers/cdf_channel.h"
 #include "parsers/rss_channel.h"
@@ -87,6 +89,8 @@ feed_create_parser_ctxt (void)
 
 	ctxt = g_new0 (struct feedParserCtxt, 1);
 	ctxt->tmpdata = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	ctxt->itemTmpdata = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	ctxt->nsHandlers = g_hash_table_new (g_direct_hash, g_direct_equal);
 	return ctxt;
 }
 
@@ -96,11 +100,50 @@ feed_free_parser_ctxt (feedParserCtxtPtr ctxt)
 	if (ctxt) {
 		/* Don't free the itemset! */
 		g_hash_table_destroy (ctxt->tmpdata);
+		g_hash_table_destroy (ctxt->itemTmpdata);
+		g_hash_table_destroy (ctxt->nsHandlers);
 		g_free (ctxt->title);
 		g_free (ctxt);
 	}
 }
 
+itemPtr
+feed_parser_ctxt_new_item (feedParserCtxtPtr ctxt)
+{
+	ctxt->item = item_new ();
+	ctxt->item->tmpdata = ctxt->itemTmpdata;
+
+	return ctxt->item;
+}
+
+void
+feed_parser_ctxt_finish_item (feedParserCtxtPtr ctxt)
+{
+	/* Keep the hash for the next item, only drop its contents */
+	g_hash_table_remove_all (ctxt->itemTmpdata);
+	ctxt->item->tmpdata = NULL;
+}
+
+NsHandler *
+feed_parser_ctxt_get_ns_handler (feedParserCtxtPtr ctxt, xmlNsPtr ns, GHashTable *prefixes, GHashTable *uris)
+{
+	NsHandler	*nsh = NULL;
+	gpointer	cached;
+
+	if (g_hash_table_lookup_extended (ctxt->nsHandlers, ns, NULL, &cached))
+		return (NsHandler *)cached;
+
+	if (ns->href)
+		nsh = (NsHandler *)g_hash_table_lookup (uris, (gpointer)ns->href);
+	if (!nsh && ns->prefix)
+		nsh = (NsHandler *)g_hash_table_lookup (prefixes, (gpointer)ns->prefix);
+
+	/* Also cache misses, unsupported namespaces are common */
+	g_hash_table_insert (ctxt->nsHandlers, ns, nsh);
+
+	return nsh;
+}
+
 /**
  * This function tries to find a feed link for a given HTTP URI. It
  * tries to download it. If it finds a valid feed source it parses
@@ -138,6 +181,14 @@ feed_parser_auto_discover (feedParserCtxtPtr ctxt)
 	}
 }
 
+static metricsHistogram parseLatency;
+
+const metricsHistogram *
+feed_parser_get_latency (void)
+{
+	return &parseLatency;
+}
+
 /**
  * General feed source parsing function. Parses the passed feed source
  * and tries to determine the source type. 
@@ -152,6 +203,7 @@ feed_parse (feedParserCtxtPtr ctxt)
 {
 	xmlNodePtr	cur;
 	gboolean	success = FALSE;
+	gint64		start = g_get_monotonic_time ();
 
 	debug_enter("feed_parse");
 
@@ -199,6 +251,9 @@ feed_parse (feedParserCtxtPtr ctxt)
 				   finished :-) */
 				g_hash_table_destroy(ctxt->tmpdata);
 				ctxt->tmpdata = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, g_free);
+
+				/* namespace declarations of an earlier document might share addresses */
+				g_hash_table_remove_all (ctxt->nsHandlers);
 				
 				/* we always drop old metadata */
 				metadata_list_free(ctxt->subscription->metadata);
@@ -238,6 +293,8 @@ feed_parse (feedParserCtxtPtr ctxt)
 		xmlFreeDoc(ctxt->doc);
 		ctxt->doc = NULL;
 	}
+
+	metrics_histogram_add_since (&parseLatency, start);
 		
 	debug_exit("feed_parse");
 	
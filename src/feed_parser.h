@@ -24,6 +24,7 @@
 #include <libxml/parser.h>
 
 #include "feed.h"
+#include "metrics.h"
 
 /** Holds all information used on feed parsing time */
 typedef struct feedParserCtxt {
@@ -33,6 +34,8 @@ typedef struct feedParserCtxt {
 	struct item	*item;		/**< the item currently parsed (or NULL) */
 
 	GHashTable	*tmpdata;	/**< tmp data hash used during stateful parsing */
+	GHashTable	*itemTmpdata;	/**< item tmp data hash, reused for every item */
+	GHashTable	*nsHandlers;	/**< namespace handler cache for the current document */
 
 	gchar		*title;		/**< resulting feed/channel title */
 
@@ -84,6 +87,39 @@ feedParserCtxtPtr feed_create_parser_ctxt (void);
  */
 void feed_free_parser_ctxt (feedParserCtxtPtr ctxt);
 
+/**
+ * Creates a new item as the current item of the parsing context
+ * and attaches the reusable temporary data hash to it.
+ *
+ * @param ctxt		the feed parsing context
+ *
+ * @returns the new item
+ */
+struct item * feed_parser_ctxt_new_item (feedParserCtxtPtr ctxt);
+
+/**
+ * Detaches and clears the temporary data hash of the current item.
+ * To be called when parsing of the current item is done.
+ *
+ * @param ctxt		the feed parsing context
+ */
+void feed_parser_ctxt_finish_item (feedParserCtxtPtr ctxt);
+
+/**
+ * Returns the namespace handler for the given namespace. The
+ * namespace URI is looked up first, then the prefix. Results are
+ * cached per namespace declaration, so for all elements of a
+ * document only one pointer hash lookup is needed.
+ *
+ * @param ctxt		the feed parsing context
+ * @param ns		the namespace of the element
+ * @param prefixes	prefix -> namespace handler hash of the parser
+ * @param uris		URI -> namespace handler hash of the parser
+ *
+ * @returns namespace handler or NULL
+ */
+struct NsHandler * feed_parser_ctxt_get_ns_handler (feedParserCtxtPtr ctxt, xmlNsPtr ns, GHashTable *prefixes, GHashTable *uris);
+
 /**
  * Lookup a feed type string from the feed type id.
  *
@@ -113,4 +149,11 @@ const gchar *feed_type_fhp_to_str (feedHandlerPtr fhp);
  */
 gboolean feed_parse (feedParserCtxtPtr ctxt);
 
+/**
+ * Returns the latency histogram of feed_parse().
+ *
+ * @returns the histogram (owned by the feed parser)
+ */
+const metricsHistogram * feed_parser_get_latency (void);
+
 #endif
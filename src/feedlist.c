@@ -19,6 +19,7 @@
  * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
  */
 
+#include <glib/gstdio.h>
 #include <libxml/uri.h>
 
 #include "comments.h"
@@ -26,6 +27,7 @@
 #include "conf.h"
 #include "db.h"
 #include "debug.h"
+#include "export.h"
 #include "feed.h"
 #include "feedlist.h"
 #include "folder.h"
@@ -41,6 +43,7 @@
 #include "fl_sources/node_source.h"
 
 static void feedlist_save	(void);
+static void feedlist_snapshot_save (void);
 
 #define FEEDLIST_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE ((object), FEEDLIST_TYPE, FeedListPrivate))
 
@@ -56,6 +59,13 @@ struct FeedListPrivate {
 	guint		autoUpdateTimer; /**< timer id for auto update */
 
 	gboolean	loading;	/**< prevents the feed list being saved before it is completely loaded */
+
+	GHashTable	*snapshot;	/**< node id -> nodeCounters of the last session (only during startup) */
+	GSList		*counterChecks;	/**< ids of nodes with restored counters to be recalculated */
+	guint		counterCheckTimer; /**< idle id for counter recalculation */
+
+	guint		bulkImport;	/**< nesting depth of bulk imports */
+	GSList		*bulkImported;	/**< ids of nodes imported in bulk mode (newest first) */
 };
 
 enum {
@@ -69,6 +79,22 @@ enum {
 
 static guint feedlist_signals[LAST_SIGNAL] = { 0 };
 
+/* Counter snapshot
+
+   Calculating the unread and item counters of all nodes needs two DB
+   queries per subscription, which made up a large part of the startup
+   time for big feed lists. So the counters are saved on exit and
+   restored on the next startup. The real counters are recalculated in
+   the background once the feed list is shown. */
+
+#define FEEDLIST_SNAPSHOT_HEADER	"liferea-feedlist-counters 1"
+#define FEEDLIST_COUNTER_CHECK_BATCH	20	/* nodes recalculated per idle callback */
+
+typedef struct nodeCounters {
+	guint	unreadCount;
+	guint	itemCount;
+} nodeCounters;
+
 static GObjectClass *parent_class = NULL;
 FeedList *feedlist = NULL;
 
@@ -96,9 +122,18 @@ feedlist_finalize (GObject *object)
 		g_source_remove (feedlist->priv->saveTimer);
 		feedlist->priv->saveTimer = 0;
 	}
+	if (feedlist->priv->counterCheckTimer) {
+		g_source_remove (feedlist->priv->counterCheckTimer);
+		feedlist->priv->counterCheckTimer = 0;
+	}
 
 	/* Enforce synchronous save upon exit */
 	feedlist_save ();		
+	export_OPML_flush ();
+	feedlist_snapshot_save ();
+
+	g_slist_free_full (feedlist->priv->counterChecks, g_free);
+	feedlist->priv->counterChecks = NULL;
 
 	/* Save last selection for next start */
 	if (feedlist->priv->selectedNode)
@@ -173,20 +208,166 @@ on_network_status_changed (gpointer instance, gboolean online, gpointer data)
 	if (online) feedlist_auto_update (NULL);
 }
 
+static gchar *
+feedlist_snapshot_filename (void)
+{
+	return common_create_cache_filename (NULL, "feedlist", "counters");
+}
+
+static void
+feedlist_snapshot_save_node (nodePtr node, gpointer user_data)
+{
+	GString	*buffer = (GString *)user_data;
+
+	g_string_append_printf (buffer, "%s %u %u\n", node->id, node->unreadCount, node->itemCount);
+
+	if (node->children)
+		node_foreach_child_data (node, feedlist_snapshot_save_node, buffer);
+}
+
+static void
+feedlist_snapshot_save (void)
+{
+	GString	*buffer;
+	gchar	*filename;
+	GError	*error = NULL;
+
+	/* Counters not yet recalculated might be stale, don't save them again */
+	if (feedlist->priv->loading || feedlist->priv->counterChecks)
+		return;
+
+	buffer = g_string_new (FEEDLIST_SNAPSHOT_HEADER "\n");
+	node_foreach_child_data (ROOTNODE, feedlist_snapshot_save_node, buffer);
+
+	filename = feedlist_snapshot_filename ();
+	if (!g_file_set_contents (filename, buffer->str, buffer->len, &error)) {
+		g_warning ("Could not save feed list counters to %s: %s", filename, error->message);
+		g_error_free (error);
+	}
+
+	g_free (filename);
+	g_string_free (buffer, TRUE);
+}
+
+static GHashTable *
+feedlist_snapshot_load (void)
+{
+	GHashTable	*snapshot;
+	gchar		*filename, *content, **lines;
+	guint		i;
+
+	filename = feedlist_snapshot_filename ();
+	if (!g_file_get_contents (filename, &content, NULL, NULL)) {
+		debug1 (DEBUG_CACHE, "No feed list counter snapshot %s", filename);
+		g_free (filename);
+		return NULL;
+	}
+
+	/* The snapshot is only valid for one startup. If we crash
+	   before the next clean exit the counters are recalculated. */
+	g_unlink (filename);
+	g_free (filename);
+
+	lines = g_strsplit (content, "\n", -1);
+	g_free (content);
+
+	if (!lines[0] || !g_str_equal (lines[0], FEEDLIST_SNAPSHOT_HEADER)) {
+		g_strfreev (lines);
+		return NULL;
+	}
+
+	snapshot = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, g_free);
+	for (i = 1; lines[i]; i++) {
+		gchar		**fields = g_strsplit (lines[i], " ", 3);
+		nodeCounters	*counters;
+
+		if (3 == g_strv_length (fields)) {
+			counters = g_new0 (nodeCounters, 1);
+			counters->unreadCount = (guint)g_ascii_strtoull (fields[1], NULL, 10);
+			counters->itemCount = (guint)g_ascii_strtoull (fields[2], NULL, 10);
+			g_hash_table_insert (snapshot, g_strdup (fields[0]), counters);
+		}
+		g_strfreev (fields);
+	}
+	g_strfreev (lines);
+
+	return snapshot;
+}
+
+static gboolean
+feedlist_check_counters (gpointer user_data)
+{
+	guint	i;
+
+	for (i = 0; i < FEEDLIST_COUNTER_CHECK_BATCH && feedlist->priv->counterChecks; i++) {
+		gchar	*id = (gchar *)feedlist->priv->counterChecks->data;
+		nodePtr	node = node_is_used_id (id);
+
+		feedlist->priv->counterChecks = g_slist_delete_link (feedlist->priv->counterChecks, feedlist->priv->counterChecks);
+
+		/* updates the feed list and parents only if the counters changed */
+		if (node)
+			node_update_counters (node);
+		g_free (id);
+	}
+
+	if (feedlist->priv->counterChecks)
+		return TRUE;
+
+	debug0 (DEBUG_CACHE, "Feed list counters recalculated");
+	feedlist->priv->counterCheckTimer = 0;
+	return FALSE;
+}
+
 /* This method is used to initialize the node states in the feed list */
 static void
 feedlist_init_node (nodePtr node) 
 {
+	nodeCounters	*counters = NULL;
+
 	if (node->expanded)
 		feed_list_node_set_expansion (node, TRUE);
 	
-	if (node->subscription)
-		db_subscription_load (node->subscription);
-		
-	node_update_counters (node);
-	feed_list_node_update (node->id);	/* Necessary to initially set folder unread counters */
-	
+	/* Subscriptions of the default source load their metadata on first
+	   update or rendering. Other node sources access it directly. */
+	if (node->subscription && !(NODE_SOURCE_TYPE (node)->capabilities & NODE_SOURCE_CAPABILITY_IS_ROOT))
+		subscription_load_metadata (node->subscription);
+
+	/* Children first, so folders can sum up their counters */
 	node_foreach_child (node, feedlist_init_node);
+
+	if (feedlist->priv->snapshot && !node->children)
+		counters = g_hash_table_lookup (feedlist->priv->snapshot, node->id);
+
+	if (counters) {
+		node->unreadCount = counters->unreadCount;
+		node->itemCount = counters->itemCount;
+		feedlist->priv->counterChecks = g_slist_prepend (feedlist->priv->counterChecks, g_strdup (node->id));
+	} else {
+		NODE_TYPE (node)->update_counters (node);
+	}
+
+	feed_list_node_update (node->id);	/* Necessary to initially set folder unread counters */
+}
+
+static void
+feedlist_process_spool (void)
+{
+	GSList	*ids, *iter;
+
+	ids = update_spool_get_ids ();
+	for (iter = ids; iter; iter = g_slist_next (iter)) {
+		nodePtr node = node_from_id ((gchar *)iter->data);
+
+		/* The update request gets the spooled result */
+		if (node && node->subscription) {
+			debug1 (DEBUG_UPDATE, "processing spooled result of \"%s\"", node_get_title (node));
+			subscription_update (node->subscription, 0);
+		} else {
+			update_spool_remove ((gchar *)iter->data);
+		}
+	}
+	g_slist_free_full (ids, g_free);
 }
 
 static void
@@ -205,11 +386,23 @@ feedlist_init (FeedList *fl)
 	
 	/* 2. Set up a root node and import the feed list source structure. */
 	debug0 (DEBUG_CACHE, "Setting up root node");
+	debug_start_measurement (DEBUG_CACHE);
 	ROOTNODE = node_source_setup_root ();
+	debug_end_measurement (DEBUG_CACHE, "feed list import");
 
 	/* 3. Ensure folder expansion and unread count*/
 	debug0 (DEBUG_CACHE, "Initializing node state");
+	debug_start_measurement (DEBUG_CACHE);
+	feedlist->priv->snapshot = feedlist_snapshot_load ();
 	feedlist_foreach (feedlist_init_node);
+	NODE_TYPE (ROOTNODE)->update_counters (ROOTNODE);
+	if (feedlist->priv->snapshot) {
+		g_hash_table_destroy (feedlist->priv->snapshot);
+		feedlist->priv->snapshot = NULL;
+	}
+	if (feedlist->priv->counterChecks)
+		feedlist->priv->counterCheckTimer = g_idle_add_full (G_PRIORITY_LOW, feedlist_check_counters, NULL, NULL);
+	debug_end_measurement (DEBUG_CACHE, "feed list node state init");
 
 	/* 4. Check if feeds do need updating. */
 	debug0 (DEBUG_UPDATE, "Performing initial feed update");
@@ -227,14 +420,20 @@ feedlist_init (FeedList *fl)
 		feedlist_reset_update_counters (NULL);
 	}
 
-	/* 5. Purge old nodes from the database */
-	db_node_cleanup (feedlist_get_root ());
+	/* 5. Process results downloaded but not processed before the last shutdown */
+	feedlist_process_spool ();
 
-	/* 6. Start automatic updating */
+	/* 6. Purge old nodes from the database and schedule the remaining DB cleanup */
+	debug_start_measurement (DEBUG_CACHE);
+	db_node_cleanup ();
+	debug_end_measurement (DEBUG_CACHE, "node cleanup");
+	db_maintenance_schedule ();
+
+	/* 7. Start automatic updating */
 	feedlist->priv->autoUpdateTimer = g_timeout_add_seconds (10, feedlist_auto_update, NULL);
 	g_signal_connect (network_monitor_get (), "online-status-changed", G_CALLBACK (on_network_status_changed), NULL);
 
-	/* 7. Finally save the new feed list state */
+	/* 8. Finally save the new feed list state */
 	feedlist->priv->loading = FALSE;
 	feedlist_schedule_save ();
 	
@@ -419,11 +618,52 @@ feedlist_add_subscription (const gchar *source, const gchar *filter, updateOptio
 void
 feedlist_node_imported (nodePtr node)
 {
+	if (feedlist->priv->bulkImport > 0) {
+		feedlist->priv->bulkImported = g_slist_prepend (feedlist->priv->bulkImported, g_strdup (node->id));
+		return;
+	}
+
 	feed_list_node_add (node);	
 
 	feedlist_schedule_save ();
 }
 
+void
+feedlist_begin_bulk_import (void)
+{
+	feedlist->priv->bulkImport++;
+}
+
+void
+feedlist_end_bulk_import (void)
+{
+	GSList	*iter, *nodes = NULL;
+
+	g_return_if_fail (feedlist->priv->bulkImport > 0);
+
+	if (--feedlist->priv->bulkImport > 0)
+		return;
+
+	/* Parents are imported before their children, so adding the
+	   nodes in import order always finds the parent rows. */
+	feedlist->priv->bulkImported = g_slist_reverse (feedlist->priv->bulkImported);
+	for (iter = feedlist->priv->bulkImported; iter; iter = g_slist_next (iter)) {
+		nodePtr node = node_from_id ((gchar *)iter->data);
+		if (node)
+			nodes = g_slist_prepend (nodes, node);
+	}
+	nodes = g_slist_reverse (nodes);
+
+	debug1 (DEBUG_GUI, "adding %u nodes of bulk import", g_slist_length (nodes));
+	feed_list_view_add_nodes (nodes);
+
+	g_slist_free (nodes);
+	g_slist_free_full (feedlist->priv->bulkImported, g_free);
+	feedlist->priv->bulkImported = NULL;
+
+	feedlist_schedule_save ();
+}
+
 void
 feedlist_node_added (nodePtr node)
 {
@@ -177,6 +177,19 @@ void feedlist_node_added (nodePtr node);
  */
 void feedlist_node_imported (nodePtr node);
 
+/**
+ * Starts a bulk import. Until the matching feedlist_end_bulk_import()
+ * nodes passed to feedlist_node_imported() are only collected and
+ * not yet added to the feed list view. Bulk imports can be nested.
+ */
+void feedlist_begin_bulk_import (void);
+
+/**
+ * Ends a bulk import. When the outermost bulk import ends all
+ * collected nodes are added to the feed list view at once.
+ */
+void feedlist_end_bulk_import (void);
+
 /**
  * Removes the given node from the feed list.
  *
@@ -117,7 +117,7 @@ default_source_export (nodePtr node)
 	g_assert (node->source->root == feedlist_get_root ());
 
 	filename = default_source_source_get_feedlist (node);
-	export_OPML_feedlist (filename, node->source->root, TRUE);
+	export_OPML_feedlist_async (filename, node->source->root, TRUE);
 	g_free (filename);
 
 	debug_exit ("default_source_source_export");
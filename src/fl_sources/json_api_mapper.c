@@ -27,23 +27,127 @@
 #include "metadata.h"
 #include "xml.h"
 
-JsonNode *
-json_api_get_node (JsonNode *parent, const gchar *mapping)
+/* A mapping path compiled into its location steps and final field name */
+typedef struct jsonApiPath {
+	gchar		**steps;	/**< NULL-terminated list of object members to descend into */
+	const gchar	*field;		/**< name of the field in the last object */
+} jsonApiPath;
+
+typedef struct jsonApiCompiledMapping {
+	jsonApiPath	id;
+	jsonApiPath	title;
+	jsonApiPath	link;
+	jsonApiPath	description;
+	jsonApiPath	updated;
+	jsonApiPath	author;
+	jsonApiPath	read;
+	jsonApiPath	flag;
+} jsonApiCompiledMapping;
+
+static void
+json_api_path_compile (jsonApiPath *path, const gchar *mapping)
+{
+	gchar	**steps;
+	guint	len;
+
+	path->steps = NULL;
+	path->field = NULL;
+
+	if (!mapping)
+		return;
+
+	/* Split "a/b/c" into steps "a", "b" and field "c" */
+	steps = g_strsplit (mapping, "/", 0);
+	len = g_strv_length (steps);
+	if (0 == len) {
+		g_strfreev (steps);
+		return;
+	}
+
+	path->field = steps[len - 1];
+	steps[len - 1] = NULL;
+	path->steps = steps;
+}
+
+static void
+json_api_path_free (jsonApiPath *path)
+{
+	if (!path->steps)
+		return;
+
+	g_free ((gchar *)path->field);
+	g_strfreev (path->steps);
+}
+
+static JsonNode *
+json_api_path_get_node (JsonNode *parent, const jsonApiPath *path)
 {
 	JsonNode	*node = parent;
 	gchar		**step;
-	gchar		**steps = g_strsplit (g_strdup (mapping), "/", 0);
-
-	step = steps;
-	if (!*step)
-		return node;
 
-	while (*(step + 1) && node) {
+	for (step = path->steps; *step && node; step++)
 		node = json_get_node (node, *step);
-		step++;
-	}
 
-	g_strfreev (steps);
+	return node;
+}
+
+static const gchar *
+json_api_path_get_string (JsonNode *parent, const jsonApiPath *path)
+{
+	JsonNode *node;
+
+	if (!parent || !path->field)
+		return NULL;
+
+	node = json_api_path_get_node (parent, path);
+	if (!node)
+		return NULL;
+
+	return json_get_string (node, path->field);
+}
+
+static gint64
+json_api_path_get_int (JsonNode *parent, const jsonApiPath *path)
+{
+	JsonNode *node;
+
+	if (!parent || !path->field)
+		return 0;
+
+	node = json_api_path_get_node (parent, path);
+	if (!node)
+		return 0;
+
+	return json_get_int (node, path->field);
+}
+
+static gboolean
+json_api_path_get_bool (JsonNode *parent, const jsonApiPath *path)
+{
+	JsonNode *node;
+
+	if (!parent || !path->field)
+		return FALSE;
+
+	node = json_api_path_get_node (parent, path);
+	if (!node)
+		return FALSE;
+
+	return json_get_bool (node, path->field);
+}
+
+JsonNode *
+json_api_get_node (JsonNode *parent, const gchar *mapping)
+{
+	JsonNode	*node;
+	jsonApiPath	path;
+
+	json_api_path_compile (&path, mapping);
+	if (!path.steps)
+		return parent;
+
+	node = json_api_path_get_node (parent, &path);
+	json_api_path_free (&path);
 
 	return node;
 }
@@ -51,130 +155,137 @@ json_api_get_node (JsonNode *parent, const gchar *mapping)
 const gchar *
 json_api_get_string (JsonNode *parent, const gchar *mapping)
 {
-	JsonNode	*node;
-	const gchar	*field;
+	const gchar	*result;
+	jsonApiPath	path;
 
 	if (!parent || !mapping)
 		return NULL;
 
-	node = json_api_get_node (parent, mapping);
-	if (!node)
-		return NULL;
+	json_api_path_compile (&path, mapping);
+	result = json_api_path_get_string (parent, &path);
+	json_api_path_free (&path);
 
-	field = strrchr (mapping, '/');
-	if (!field)
-		field = mapping;
-	else
-		field++;
-
-	return json_get_string (node, field);
+	return result;
 }
 
 gint
 json_api_get_int (JsonNode *parent, const gchar *mapping)
 {
-	JsonNode	*node;
-	const gchar	*field;
+	gint		result;
+	jsonApiPath	path;
 
 	if (!parent || !mapping)
 		return 0;
 
-	node = json_api_get_node (parent, mapping);
-	if (!node)
-		return 0;
-
-	field = strrchr (mapping, '/');
-	if (!field)
-		field = mapping;
-	else
-		field++;
+	json_api_path_compile (&path, mapping);
+	result = json_api_path_get_int (parent, &path);
+	json_api_path_free (&path);
 
-	return json_get_int (node, field);
+	return result;
 }
 
 gboolean
 json_api_get_bool (JsonNode *parent, const gchar *mapping)
 {
-	JsonNode	*node;
-	const gchar	*field;
+	gboolean	result;
+	jsonApiPath	path;
 
 	if (!parent || !mapping)
 		return FALSE;
 
-	node = json_api_get_node (parent, mapping);
-	if (!node)
-		return FALSE;
+	json_api_path_compile (&path, mapping);
+	result = json_api_path_get_bool (parent, &path);
+	json_api_path_free (&path);
+
+	return result;
+}
+
+typedef struct jsonApiItemsCtxt {
+	jsonApiCompiledMapping	paths;
+	jsonApiMapping		*mapping;
+	jsonApiItemCallbackFunc	callback;
+	GList			*items;		/**< items in reverse order */
+} *jsonApiItemsCtxtPtr;
 
-	field = strrchr (mapping, '/');
-	if (!field)
-		field = mapping;
-	else
-		field++;
+static void
+json_api_get_item (JsonNode *node, gpointer user_data)
+{
+	jsonApiItemsCtxtPtr	ctxt = (jsonApiItemsCtxtPtr)user_data;
+	itemPtr			item = item_new ();
+	const gchar		*content, *tmp;
+	gchar			*xhtml;
+
+	/* Parse default feeds */
+	item_set_id	(item, json_api_path_get_string (node, &ctxt->paths.id));
+	item_set_title	(item, json_api_path_get_string (node, &ctxt->paths.title));
+	item_set_source	(item, json_api_path_get_string (node, &ctxt->paths.link));
+
+	item->time       = json_api_path_get_int (node, &ctxt->paths.updated);
+	item->readStatus = json_api_path_get_bool (node, &ctxt->paths.read);
+	item->flagStatus = json_api_path_get_bool (node, &ctxt->paths.flag);
+
+	if (ctxt->mapping->negateRead)
+		item->readStatus = !item->readStatus;
+
+	/* Handling encoded content */
+	content = json_api_path_get_string (node, &ctxt->paths.description);
+	if (ctxt->mapping->xhtml) {
+		xhtml = xhtml_extract_from_string (content, NULL);
+		item_set_description (item, xhtml);
+		xmlFree (xhtml);
+	} else {
+		item_set_description (item, content);
+	}
+
+	/* Optional meta data */
+	tmp = json_api_path_get_string (node, &ctxt->paths.author);
+	if (tmp)
+		item->metadata = metadata_list_append (item->metadata, "author", tmp);
+
+	ctxt->items = g_list_prepend (ctxt->items, (gpointer)item);
 
-	return json_get_bool (node, field);
+	/* Allow optional item callback to process stuff */
+	if (ctxt->callback)
+		(*ctxt->callback)(node, item);
 }
 
 GList *
 json_api_get_items (const gchar *json, const gchar *root, jsonApiMapping *mapping, jsonApiItemCallbackFunc callback)
 {
-	GList		*items = NULL;
-	JsonParser	*parser = json_parser_new ();
-
-	if (json_parser_load_from_data (parser, json, -1, NULL)) {
-		JsonArray	*array = json_node_get_array (json_get_node (json_parser_get_root (parser), root));
-		GList		*elements = json_array_get_elements (array);
-		GList		*iter = elements;
-
+	struct jsonApiItemsCtxt	ctxt;
+
+	ctxt.mapping = mapping;
+	ctxt.callback = callback;
+	ctxt.items = NULL;
+
+	/* Split the location steps only once per document */
+	json_api_path_compile (&ctxt.paths.id,		mapping->id);
+	json_api_path_compile (&ctxt.paths.title,	mapping->title);
+	json_api_path_compile (&ctxt.paths.link,	mapping->link);
+	json_api_path_compile (&ctxt.paths.description,	mapping->description);
+	json_api_path_compile (&ctxt.paths.updated,	mapping->updated);
+	json_api_path_compile (&ctxt.paths.author,	mapping->author);
+	json_api_path_compile (&ctxt.paths.read,	mapping->read);
+	json_api_path_compile (&ctxt.paths.flag,	mapping->flag);
+
+	if (json_foreach_array_element (json, -1, root, json_api_get_item, &ctxt)) {
 		debug1 (DEBUG_PARSING, "JSON API: found items root node \"%s\"", root);
-                
-		while (iter) {
-			JsonNode *node = (JsonNode *)iter->data;
-			itemPtr item = item_new ();
-
-			/* Parse default feeds */
-			item_set_id	(item, json_api_get_string (node, mapping->id));
-			item_set_title	(item, json_api_get_string (node, mapping->title));
-			item_set_source	(item, json_api_get_string (node, mapping->link));
-
-			item->time       = json_api_get_int (node, mapping->updated);
-			item->readStatus = json_api_get_bool (node, mapping->read);
-			item->flagStatus = json_api_get_bool (node, mapping->flag);
-
-			if (mapping->negateRead)
-				item->readStatus = !item->readStatus;
-
-			/* Handling encoded content */
-			const gchar *content; 
-			gchar *xhtml;
-
-			content = json_api_get_string (node, mapping->description);
-			if (mapping->xhtml) {
-				xhtml = xhtml_extract_from_string (content, NULL);
-				item_set_description (item, xhtml);
-				xmlFree (xhtml);
-			} else {
-				item_set_description (item, content);
-			}
-
-			/* Optional meta data */
-			const gchar *tmp = json_api_get_string (node, mapping->author);
-			if (tmp)
-				item->metadata = metadata_list_append (item->metadata, "author", tmp);
-	
-			items = g_list_append (items, (gpointer)item);
-
-			/* Allow optional item callback to process stuff */
-			if (callback)
-				(*callback)(node, item);
-				
-			iter = g_list_next (iter);
-		}
-
-		g_list_free (elements);
-		g_object_unref (parser);
 	} else {
 		debug1 (DEBUG_PARSING, "Could not parse JSON \"%s\"", json);
+
+		/* Do not return a truncated item list */
+		g_list_free_full (ctxt.items, (GDestroyNotify)item_unload);
+		ctxt.items = NULL;
 	}
 
-	return items;
+	json_api_path_free (&ctxt.paths.id);
+	json_api_path_free (&ctxt.paths.title);
+	json_api_path_free (&ctxt.paths.link);
+	json_api_path_free (&ctxt.paths.description);
+	json_api_path_free (&ctxt.paths.updated);
+	json_api_path_free (&ctxt.paths.author);
+	json_api_path_free (&ctxt.paths.read);
+	json_api_path_free (&ctxt.paths.flag);
+
+	return g_list_reverse (ctxt.items);
 }
@@ -49,6 +49,7 @@ typedef void (*jsonApiItemCallbackFunc)(JsonNode *node, itemPtr item);
  *			for everything that cannot be easily mapped
  *
  * @returns a list of items (all to be freed with item_free()) or NULL
+ *          if the document could not be parsed completely
  */
 GList * json_api_get_items (const gchar *json, const gchar *root, jsonApiMapping *mapping, jsonApiItemCallbackFunc callback);
 
@@ -273,7 +273,7 @@ opml_source_export (nodePtr node)
 	g_assert (node == node->source->root);
 
 	filename = opml_source_get_feedlist (node);	   
-	export_OPML_feedlist (filename, node, TRUE);
+	export_OPML_feedlist_async (filename, node, TRUE);
 	g_free (filename);
 	
 	debug1 (DEBUG_CACHE, "adding OPML source: title=%s", node_get_title(node));
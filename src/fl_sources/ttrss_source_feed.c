@@ -35,105 +35,100 @@
 
 #include "fl_sources/ttrss_source.h"
 
+/*
+   We expect to get something like this
+
+   [{"id":118,
+     "unread":true,
+     "marked":false,
+     "updated":1287927675,
+     "is_updated":false,
+     "title":"IBM Says New ...",
+     "link":"http:\/\/rss.slashdot.org\/~r\/Slashdot\/slashdot\/~3\/ALuhNKO3NV4\/story01.htm",
+     "feed_id":"5",
+     "content":"coondoggie writes ..."
+    },
+    {"id":117,
+     "unread":true,
+     "marked":false,
+     "updated":1287923814,
+   [...]
+ */
+static void
+ttrss_feed_parse_headline (JsonNode *node, gpointer user_data)
+{
+	GList		**items = (GList **)user_data;
+	itemPtr		item = item_new ();
+	JsonNode	*attachments;
+	gchar		*id;
+	const gchar	*content; 
+	gchar		*xhtml;
+
+	id = g_strdup_printf ("%" G_GINT64_FORMAT, json_get_int (node, "id"));
+	item_set_id (item, id);
+	g_free (id);
+	item_set_title (item, json_get_string (node, "title"));
+	item_set_source (item, json_get_string (node, "link"));
+
+	content = json_get_string (node, "content");
+	xhtml = xhtml_extract_from_string (content, NULL);
+	item_set_description (item, xhtml);
+	xmlFree (xhtml);
+
+	item->time = json_get_int (node, "updated");
+
+	if (json_get_bool (node, "unread")) {
+		item->readStatus = FALSE;
+	} else {
+		item->readStatus = TRUE;
+	}
+	if (json_get_bool (node, "marked"))
+		item->flagStatus = TRUE;
+
+	/* Extract enclosures */
+	attachments = json_get_node (node, "attachments");
+	if (attachments && JSON_NODE_TYPE (attachments) == JSON_NODE_ARRAY) {
+		JsonArray	*array = json_node_get_array (attachments);
+		guint		i, len = json_array_get_length (array);
+
+		for (i = 0; i < len; i++) {
+			JsonNode *enc_node = json_array_get_element (array, i);
+
+			/* attachment nodes should look like this:
+				{"id":"1562",
+				 "content_url":"http:\/\/...",
+				 "content_type":"audio\/mpeg",
+				 "post_id":"44572",
+				 "title":"...",
+				 "duration":"29446311"}]
+			 */
+			if (json_get_string (enc_node, "content_url") &&
+			    json_get_string (enc_node, "content_type")) {
+				gchar *encStr = enclosure_values_to_string (
+					json_get_string (enc_node, "content_url"),
+					json_get_string (enc_node, "content_type"), 
+					0 /* length unknown to TinyTiny RSS*/,
+					FALSE /* not yet downloaded */);
+				item->metadata = metadata_list_append (item->metadata, "enclosure", encStr);
+				item->hasEnclosure = TRUE;
+				g_free (encStr);
+			}
+		}
+	}
+
+	*items = g_list_prepend (*items, (gpointer)item);
+}
+
 static void
 ttrss_feed_subscription_process_update_result (subscriptionPtr subscription, const struct updateResult* const result, updateFlags flags)
 {
 	if (result->data && result->httpstatus == 200) {
-		JsonParser	*parser = json_parser_new ();
-
-		if (json_parser_load_from_data (parser, result->data, -1, NULL)) {
-			JsonArray	*array = json_node_get_array (json_get_node (json_parser_get_root (parser), "content"));
-			JsonNode	*attachments;
-			GList		*elements = json_array_get_elements (array);
-			GList		*iter = elements;
-			GList		*items = NULL;
-
-			/*
-			   We expect to get something like this
-			   
-			   [{"id":118,
-			     "unread":true,
-			     "marked":false,
-			     "updated":1287927675,
-			     "is_updated":false,
-			     "title":"IBM Says New ...",
-			     "link":"http:\/\/rss.slashdot.org\/~r\/Slashdot\/slashdot\/~3\/ALuhNKO3NV4\/story01.htm",
-			     "feed_id":"5",
-			     "content":"coondoggie writes ..."
-			    },
-			    {"id":117,
-			     "unread":true,
-			     "marked":false,
-			     "updated":1287923814,
-                           [...]
-                         */
-                         
-			while (iter) {
-				JsonNode *node = (JsonNode *)iter->data;
-				itemPtr item = item_new ();
-				gchar *id;
-				const gchar *content; 
-				gchar *xhtml;
-
-				id = g_strdup_printf ("%" G_GINT64_FORMAT, json_get_int (node, "id"));
-				item_set_id (item, id);
-				g_free (id);
-				item_set_title (item, json_get_string (node, "title"));
-				item_set_source (item, json_get_string (node, "link"));
-
-				content = json_get_string (node, "content");
-				xhtml = xhtml_extract_from_string (content, NULL);
-				item_set_description (item, xhtml);
-				xmlFree (xhtml);
-
-				item->time = json_get_int (node, "updated");
-				
-				if (json_get_bool (node, "unread")) {
-					item->readStatus = FALSE;
-				} else {
-					item->readStatus = TRUE;
-				}
-				if (json_get_bool (node, "marked"))
-					item->flagStatus = TRUE;
-
-				/* Extract enclosures */
-				attachments = json_get_node (node, "attachments");
-				if (attachments && JSON_NODE_TYPE (attachments) == JSON_NODE_ARRAY) {
-					GList *aiter, *alist;
-					alist = aiter = json_array_get_elements (json_node_get_array (attachments));
-					while (aiter) {
-						JsonNode *enc_node = (JsonNode *)aiter->data;
-
-						/* attachment nodes should look like this:
-							{"id":"1562",
-                                                         "content_url":"http:\/\/...",
-						         "content_type":"audio\/mpeg",
-						         "post_id":"44572",
-						         "title":"...",
-						         "duration":"29446311"}]
-						 */
-						if (json_get_string (enc_node, "content_url") &&
-						    json_get_string (enc_node, "content_type")) {
-							gchar *encStr = enclosure_values_to_string (
-								json_get_string (enc_node, "content_url"),
-								json_get_string (enc_node, "content_type"), 
-								0 /* length unknown to TinyTiny RSS*/,
-								FALSE /* not yet downloaded */);
-							item->metadata = metadata_list_append (item->metadata, "enclosure", encStr);
-							item->hasEnclosure = TRUE;
-							g_free (encStr);
-						}
-						aiter = g_list_next (aiter);
-					}
-					g_list_free (alist);
-				}
-					
-				items = g_list_append (items, (gpointer)item);
-				
-				iter = g_list_next (iter);
-			}
+		GList	*items = NULL;
 
-			g_list_free (elements);
+		/* Headlines are parsed one by one from the response to avoid
+		   building a tree for the complete (possibly huge) document */
+		if (json_foreach_array_element (result->data, result->size, "content", ttrss_feed_parse_headline, &items)) {
+			items = g_list_reverse (items);
 
 			/* merge against feed cache */
 			if (items) {
@@ -145,12 +140,11 @@ ttrss_feed_subscription_process_update_result (subscriptionPtr subscription, con
 
 			subscription->node->available = TRUE;
 		} else {
+			g_list_free_full (items, (GDestroyNotify)item_unload);
 			subscription->node->available = FALSE;
 
 			g_string_append (((feedPtr)subscription->node->data)->parseErrors, _("Could not parse JSON returned by TinyTinyRSS API!"));
 		}
-
-		g_object_unref (parser);
 	} else {
 		subscription->node->available = FALSE;
 	}
@@ -0,0 +1,128 @@
+/**
+ * @file headless.c  updating all subscriptions without user interface
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "headless.h"
+
+#include <stdio.h>
+
+#include "db.h"
+#include "favicon.h"
+#include "feedlist.h"
+#include "itemlist.h"
+#include "net.h"
+#include "node.h"
+#include "subscription.h"
+#include "update.h"
+#include "xml.h"
+
+/* Without a user to disturb, run as many requests as the
+   connection pool allows */
+#define HEADLESS_MAX_ACTIVE_JOBS	32
+
+#define HEADLESS_CHECK_INTERVAL		250	/* ms */
+
+static guint	feedsUpdated = 0;
+static guint	feedsFailed = 0;
+static guint	newItems = 0;
+
+static void
+headless_subscription_updated (subscriptionPtr subscription, const struct updateResult * const result, gint64 downloadTime, gint64 processingTime)
+{
+	nodePtr		node = subscription->node;
+	const gchar	*error;
+	guint		newCount = 0;
+
+	error = subscription->httpError?subscription->httpError:subscription->updateError;
+	if (!error && !node->available)
+		error = "not available";
+
+	if (error) {
+		feedsFailed++;
+	} else {
+		feedsUpdated++;
+		/* The new item count is only set when the result was merged */
+		if (304 != result->httpstatus)
+			newCount = node->newCount;
+	}
+	newItems += newCount;
+
+	printf ("%9.1f %9.1f %5u  %s%s%s\n",
+	        downloadTime / 1000.0, processingTime / 1000.0, newCount,
+	        node_get_title (node), error?": ":"", error?error:"");
+	fflush (stdout);
+}
+
+static gboolean
+headless_check_finished (gpointer user_data)
+{
+	if (!update_jobs_finished ())
+		return TRUE;
+
+	g_main_loop_quit ((GMainLoop *)user_data);
+	return FALSE;
+}
+
+gint
+liferea_headless_update (void)
+{
+	GMainLoop	*loop;
+	FeedList	*feedlist;
+	ItemList	*itemlist;
+	guint64		bytes;
+	gulong		responses, notModified, imUsed;
+	gint64		start;
+
+	db_init ();
+	xml_init ();
+
+	update_set_max_active_jobs (HEADLESS_MAX_ACTIVE_JOBS);
+	subscription_set_updated_func (headless_subscription_updated);
+
+	printf ("%9s %9s %5s  %s\n", "fetch ms", "merge ms", "new", "subscription");
+	start = g_get_monotonic_time ();
+
+	/* There is no item view, but the item list has to exist
+	   to handle item removals during the merge */
+	itemlist = itemlist_create ();
+	feedlist = feedlist_create ();
+	node_update_subscription (feedlist_get_root (), GUINT_TO_POINTER (0));
+
+	loop = g_main_loop_new (NULL, FALSE);
+	g_timeout_add (HEADLESS_CHECK_INTERVAL, headless_check_finished, loop);
+	g_main_loop_run (loop);
+	g_main_loop_unref (loop);
+
+	network_get_statistics (&bytes, &responses, &notModified, &imUsed);
+	printf ("%u subscriptions updated, %u failed, %u new items, %" G_GUINT64_FORMAT " bytes received, "
+	        "%lu of %lu responses not modified, %.1fs\n",
+	        feedsUpdated, feedsFailed, newItems, bytes, notModified, responses,
+	        (g_get_monotonic_time () - start) / (gdouble)G_USEC_PER_SEC);
+
+	subscription_set_updated_func (NULL);
+
+	/* order is important ! */
+	update_deinit ();
+	favicon_store_flush ();
+	g_object_unref (feedlist);
+	g_object_unref (itemlist);
+	db_deinit ();
+
+	return (feedsFailed > 0)?1:0;
+}
@@ -0,0 +1,39 @@
+/**
+ * @file headless.h  updating all subscriptions without user interface
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _HEADLESS_H
+#define _HEADLESS_H
+
+#include <glib.h>
+
+/**
+ * Loads the feed list, updates all subscriptions and merges the
+ * results into the DB without creating any widgets. Prints the
+ * timing of every update and a summary to stdout. Returns when
+ * all updates are done.
+ *
+ * The configuration and the update subsystem must be initialized,
+ * the DB must not be.
+ *
+ * @returns exit status
+ */
+gint liferea_headless_update (void);
+
+#endif
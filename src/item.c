@@ -29,6 +29,7 @@
 #include "date.h"
 #include "db.h"
 #include "debug.h"
+#include "item_header.h"
 #include "metadata.h"
 #include "xml.h"
 
@@ -49,11 +50,26 @@ item_load (gulong id)
 	return db_item_load (id);
 }
 
+itemPtr
+item_load_light (gulong id)
+{
+	return db_item_load_light (id);
+}
+
+static void
+item_load_details (itemPtr item)
+{
+	if (item->light)
+		db_item_load_details (item);
+}
+
 itemPtr
 item_copy (itemPtr item)
 {
 	itemPtr copy = item_new ();
 
+	item_load_details (item);
+
 	item_set_title (copy, item->title);
 	item_set_source (copy, item->source);
 	item_set_description (copy, item->description);
@@ -94,15 +110,24 @@ item_set_title (itemPtr item, const gchar * title)
 void
 item_set_description (itemPtr item, const gchar *description)
 {
+	gchar	*sanitized;
+
 	if (!description)
 		return;
 
+	item_load_details (item);
+
+	/* Sanitize once here so rendering can use the stored description as is */
+	sanitized = xhtml_sanitize (description);
+
 	if (item->description)
-		if (!(strlen (description) > strlen (item->description)))
+		if (!(strlen (sanitized) > strlen (item->description))) {
+			g_free (sanitized);
 			return;
+		}
 
 	g_free (item->description);
-	item->description = g_strdup (description);
+	item->description = sanitized;
 }
 
 void
@@ -124,7 +149,8 @@ item_set_id (itemPtr item, const gchar * id)
 
 const gchar *	item_get_id(itemPtr item) { return item->sourceId; }
 const gchar *	item_get_title(itemPtr item) {return item->title; }
-const gchar *	item_get_description(itemPtr item) { return item->description; }
+const gchar *	item_get_description(itemPtr item) { item_load_details (item); return item->description; }
+GSList *	item_get_metadata(itemPtr item) { item_load_details (item); return item->metadata; }
 const gchar *	item_get_source(itemPtr item) { return item->source; }
 
 gchar *
@@ -205,20 +231,15 @@ item_to_xml (itemPtr item, gpointer xmlNode)
 	xmlNodePtr	duplicatesNode;		
 	xmlNodePtr	itemNode;
 	gchar		*tmp;
-	gchar		*tmp2;
 	
 	itemNode = xmlNewChild (parentNode, NULL, "item", NULL);
 	g_return_if_fail (itemNode);
 
 	xmlNewTextChild (itemNode, NULL, "title", item_get_title (item)?item_get_title (item):"");
 
-	if (item_get_description (item)) {
-		tmp = xhtml_strip_dhtml (item_get_description (item));
-		tmp2 = xhtml_strip_unsupported_tags (tmp);
-		xmlNewTextChild (itemNode, NULL, "description", tmp2);
-		g_free (tmp);
-		g_free (tmp2);
-	}
+	/* no sanitizing needed, already done by item_set_description() */
+	if (item_get_description (item))
+		xmlNewTextChild (itemNode, NULL, "description", item_get_description (item));
 	
 	if (item_get_source (item))
 		xmlNewTextChild (itemNode, NULL, "source", item_get_source (item));
@@ -254,13 +275,12 @@ item_to_xml (itemPtr item, gpointer xmlNode)
 		duplicates = iter = db_item_get_duplicates(item->sourceId);
 		while (iter) {
 			gulong id = GPOINTER_TO_UINT (iter->data);
-			itemPtr duplicate = item_load (id);
+			itemHeaderPtr duplicate = item_header_get (id);
 			if (duplicate) {
 				nodePtr duplicateNode = node_from_id (duplicate->nodeId);
 				if (duplicateNode && (item->id != duplicate->id))
 					xmlNewTextChild (duplicatesNode, NULL, "duplicateNode", 
 					                 node_get_title (duplicateNode));
-				item_unload (duplicate);
 			}
 			iter = g_slist_next (iter);
 		}
@@ -273,7 +293,7 @@ item_to_xml (itemPtr item, gpointer xmlNode)
 	xmlNewTextChild (itemNode, NULL, "sourceNr", tmp);
 	g_free (tmp);
 
-	metadata_add_xml_nodes (item->metadata, itemNode);
+	metadata_add_xml_nodes (item_get_metadata (item), itemNode);
 
 	nodePtr feedNode = node_from_id (item->parentNodeId);
 	if (feedNode) {
@@ -71,6 +71,8 @@ typedef struct item {
 	gchar		*parentNodeId;		/**< Real parent node id. Always a feed list node id. */
 	gulong 		sourceNr;		/**< Either equal to nr or the number of the item this one is a copy of */
 
+	gboolean	light;			/**< TRUE if description and metadata are not yet loaded (see item_load_light()) */
+
 	/* remote states used during sync of remote accounts */
 	gboolean	remoteReadStatus;	/**< TRUE if the remote copy of the item has been read */
 	gboolean	remoteFlagStatus;	/**< TRUE if the remote copy of the item has been flagged */
@@ -94,6 +96,19 @@ itemPtr 	item_new(void);
  */
 itemPtr		item_load(gulong id);
 
+/**
+ * Like item_load() but without loading the description and the
+ * metadata of the item. Those are loaded on first access using
+ * item_get_description() or item_get_metadata(). To be used where
+ * only the item state and headline are of interest. Light items
+ * must not be accessed using item->description or item->metadata!
+ *
+ * @param id	item id to load
+ *
+ * @returns item structure
+ */
+itemPtr		item_load_light(gulong id);
+
 /**
  * Method to create a copy of an item. The copy will be
  * linked to the original item to allow state update
@@ -123,8 +138,10 @@ void	item_unload(itemPtr item);
 const gchar *	item_get_id(itemPtr item);
 /** Returns the title of item. */
 const gchar *	item_get_title(itemPtr item);
-/** Returns the description of item. */
+/** Returns the description of item (loads it for light items). */
 const gchar *	item_get_description(itemPtr item);
+/** Returns the metadata list of item (loads it for light items). */
+GSList *	item_get_metadata(itemPtr item);
 /** Returns the source of item. */
 const gchar *	item_get_source(itemPtr item);
 
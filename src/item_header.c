@@ -0,0 +1,346 @@
+/**
+ * @file item_header.c  compact in-memory item header cache
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "item_header.h"
+
+#include <string.h>
+
+#include "db.h"
+#include "debug.h"
+
+/* Maximum number of cached headers (roughly 100 bytes each) */
+#define ITEM_HEADER_CACHE_SIZE	16384
+
+/* Reference counted string. Node ids and GUIDs are shared by many
+   headers, so each distinct string is stored only once. Unlike
+   g_intern_string() the strings are freed when no longer used. */
+typedef struct internedString {
+	guint	refCount;
+	gchar	str[1];
+} internedString;
+
+static struct itemHeaderCache {
+	GHashTable	*headers;	/**< item id -> GList link in lru */
+	GQueue		*lru;		/**< itemHeaderPtr list, most recently used first */
+	GHashTable	*strings;	/**< string -> internedString */
+	guint		comments;	/**< number of cached comment headers */
+
+	gulong		hits;		/**< statistics for debugging and monitoring */
+	gulong		misses;
+} *cache = NULL;
+
+static void
+item_header_cache_init (void)
+{
+	if (cache)
+		return;
+
+	cache = g_new0 (struct itemHeaderCache, 1);
+	cache->headers = g_hash_table_new (g_direct_hash, g_direct_equal);
+	cache->lru = g_queue_new ();
+	cache->strings = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+}
+
+static const gchar *
+item_header_intern (const gchar *str)
+{
+	internedString	*is;
+	gsize		len;
+
+	if (!str)
+		return NULL;
+
+	is = g_hash_table_lookup (cache->strings, str);
+	if (!is) {
+		len = strlen (str);
+		is = g_malloc (G_STRUCT_OFFSET (internedString, str) + len + 1);
+		is->refCount = 0;
+		memcpy (is->str, str, len + 1);
+		g_hash_table_insert (cache->strings, is->str, is);
+	}
+	is->refCount++;
+
+	return is->str;
+}
+
+static void
+item_header_release (const gchar *str)
+{
+	internedString	*is;
+
+	if (!str)
+		return;
+
+	is = g_hash_table_lookup (cache->strings, str);
+	g_assert (is);
+	if (0 == --is->refCount)
+		g_hash_table_remove (cache->strings, str);
+}
+
+static void
+item_header_set_string (const gchar **field, const gchar *value)
+{
+	const gchar *old = *field;
+
+	if (old && value && g_str_equal (old, value))
+		return;
+
+	/* intern first, so a shared string is not dropped in between */
+	*field = item_header_intern (value);
+	item_header_release (old);
+}
+
+static void
+item_header_set (itemHeaderPtr header, itemHeaderPtr values)
+{
+	if (header->isComment)
+		cache->comments--;
+
+	header->id = values->id;
+	header->parentItemId = values->parentItemId;
+	header->time = values->time;
+	header->readStatus = values->readStatus;
+	header->updateStatus = values->updateStatus;
+	header->flagStatus = values->flagStatus;
+	header->validGuid = values->validGuid;
+	header->isComment = values->isComment;
+
+	item_header_set_string (&header->title, values->title);
+	item_header_set_string (&header->sourceId, values->sourceId);
+	item_header_set_string (&header->nodeId, values->nodeId);
+	item_header_set_string (&header->parentNodeId, values->parentNodeId);
+
+	if (header->isComment)
+		cache->comments++;
+}
+
+static void
+item_header_drop (GList *link)
+{
+	itemHeaderPtr header = (itemHeaderPtr)link->data;
+
+	g_hash_table_remove (cache->headers, GUINT_TO_POINTER (header->id));
+	g_queue_delete_link (cache->lru, link);
+
+	if (header->isComment)
+		cache->comments--;
+
+	item_header_release (header->title);
+	item_header_release (header->sourceId);
+	item_header_release (header->nodeId);
+	item_header_release (header->parentNodeId);
+	g_free (header);
+}
+
+static void
+item_header_touch (GList *link)
+{
+	if (link != cache->lru->head) {
+		g_queue_unlink (cache->lru, link);
+		g_queue_push_head_link (cache->lru, link);
+	}
+}
+
+static void
+item_header_cache_add (itemHeaderPtr values)
+{
+	itemHeaderPtr	header;
+	GList		*link;
+
+	link = g_hash_table_lookup (cache->headers, GUINT_TO_POINTER (values->id));
+	if (link) {
+		item_header_set ((itemHeaderPtr)link->data, values);
+		item_header_touch (link);
+		return;
+	}
+
+	while (cache->lru->length >= ITEM_HEADER_CACHE_SIZE)
+		item_header_drop (cache->lru->tail);
+
+	header = g_new0 (struct itemHeader, 1);
+	item_header_set (header, values);
+	g_queue_push_head (cache->lru, header);
+	g_hash_table_insert (cache->headers, GUINT_TO_POINTER (header->id), cache->lru->head);
+}
+
+static void
+item_header_loaded_cb (itemHeaderPtr values, gpointer user_data)
+{
+	item_header_cache_add (values);
+}
+
+void
+item_header_get_cache_counts (gulong *hits, gulong *misses, guint *size)
+{
+	item_header_cache_init ();
+
+	*hits = cache->hits;
+	*misses = cache->misses;
+	*size = cache->lru->length;
+}
+
+itemHeaderPtr
+item_header_get (gulong id)
+{
+	GList	*link;
+
+	item_header_cache_init ();
+
+	link = g_hash_table_lookup (cache->headers, GUINT_TO_POINTER (id));
+	if (link) {
+		cache->hits++;
+		item_header_touch (link);
+		return (itemHeaderPtr)link->data;
+	}
+
+	cache->misses++;
+	db_item_headers_load (&id, 1, item_header_loaded_cb, NULL);
+
+	link = g_hash_table_lookup (cache->headers, GUINT_TO_POINTER (id));
+	if (!link)
+		return NULL;
+
+	return (itemHeaderPtr)link->data;
+}
+
+void
+item_header_prefetch (const gulong *ids, guint count)
+{
+	gulong	*missing;
+	guint	i, n = 0;
+
+	item_header_cache_init ();
+
+	/* Prefetching more than fits would only evict the
+	   first headers before they are used */
+	count = MIN (count, ITEM_HEADER_CACHE_SIZE / 2);
+
+	missing = g_new (gulong, count);
+	for (i = 0; i < count; i++) {
+		if (!g_hash_table_lookup (cache->headers, GUINT_TO_POINTER (ids[i])))
+			missing[n++] = ids[i];
+	}
+
+	if (n > 0)
+		db_item_headers_load (missing, n, item_header_loaded_cb, NULL);
+
+	g_free (missing);
+}
+
+void
+item_header_prefetch_list (GList *ids)
+{
+	gulong	*array;
+	guint	n = 0;
+
+	array = g_new (gulong, g_list_length (ids));
+	for (; ids; ids = g_list_next (ids))
+		array[n++] = GPOINTER_TO_UINT (ids->data);
+
+	item_header_prefetch (array, n);
+	g_free (array);
+}
+
+void
+item_header_update (itemPtr item)
+{
+	struct itemHeader	values;
+
+	if (!item->id)
+		return;
+
+	item_header_cache_init ();
+
+	/* The strings are only borrowed, item_header_cache_add() interns them */
+	values.id		= item->id;
+	values.parentItemId	= item->parentItemId;
+	values.title		= item->title;
+	values.sourceId		= item->sourceId;
+	values.nodeId		= item->nodeId;
+	values.parentNodeId	= item->parentNodeId;
+	values.time		= item->time;
+	values.readStatus	= item->readStatus?1:0;
+	values.updateStatus	= item->updateStatus?1:0;
+	values.flagStatus	= item->flagStatus?1:0;
+	values.validGuid	= item->validGuid?1:0;
+	values.isComment	= item->isComment?1:0;
+
+	item_header_cache_add (&values);
+}
+
+void
+item_header_remove (gulong id)
+{
+	GList	*link, *next;
+
+	if (!cache)
+		return;
+
+	link = g_hash_table_lookup (cache->headers, GUINT_TO_POINTER (id));
+	if (link)
+		item_header_drop (link);
+
+	/* The DB also removes the comments of the item. Comments
+	   are rare, so only scan when there are any cached. */
+	for (link = cache->lru->head; link && cache->comments > 0; link = next) {
+		itemHeaderPtr header = (itemHeaderPtr)link->data;
+
+		next = link->next;
+		if (header->isComment && header->parentItemId == id)
+			item_header_drop (link);
+	}
+}
+
+void
+item_header_remove_node (const gchar *nodeId)
+{
+	GList	*link, *next;
+
+	if (!cache)
+		return;
+
+	for (link = cache->lru->head; link; link = next) {
+		itemHeaderPtr header = (itemHeaderPtr)link->data;
+
+		next = link->next;
+		if ((header->nodeId && g_str_equal (header->nodeId, nodeId)) ||
+		    (header->isComment && header->parentNodeId && g_str_equal (header->parentNodeId, nodeId)))
+			item_header_drop (link);
+	}
+}
+
+void
+item_header_cache_free (void)
+{
+	if (!cache)
+		return;
+
+	debug4 (DEBUG_CACHE, "item header cache: %u headers, %u strings, %lu hits, %lu misses",
+	        cache->lru->length, g_hash_table_size (cache->strings), cache->hits, cache->misses);
+
+	while (cache->lru->head)
+		item_header_drop (cache->lru->head);
+
+	g_queue_free (cache->lru);
+	g_hash_table_destroy (cache->headers);
+	g_hash_table_destroy (cache->strings);
+	g_free (cache);
+	cache = NULL;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file item_header.h  compact in-memory item header cache
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _ITEM_HEADER_H
+#define _ITEM_HEADER_H
+
+#include <glib.h>
+
+#include "item.h"
+
+/* An item header is the small part of an item that most code paths
+   (item list, search folder rules, duplicate handling) need to decide
+   what to do with an item. Headers are kept in a process wide LRU cache
+   so those paths do not need to load descriptions and metadata.
+
+   The cache is kept coherent by the DB layer which updates or drops
+   headers on every item write. */
+
+typedef struct itemHeader {
+	gulong		id;			/**< item id */
+	gulong		parentItemId;		/**< parent item id (comments only) */
+	const gchar	*title;			/**< interned title (or NULL) */
+	const gchar	*sourceId;		/**< interned GUID (or NULL) */
+	const gchar	*nodeId;		/**< interned node id */
+	const gchar	*parentNodeId;		/**< interned parent node id */
+	gint64		time;			/**< item date */
+	guint		readStatus:1;
+	guint		updateStatus:1;
+	guint		flagStatus:1;
+	guint		validGuid:1;
+	guint		isComment:1;
+} *itemHeaderPtr;
+
+/**
+ * Returns the header of the given item. Loads it from the DB
+ * if it is not yet cached.
+ *
+ * The returned header belongs to the cache and is only valid until
+ * the next call of any item_header_* or DB item method.
+ *
+ * @param id	the item id
+ *
+ * @returns header or NULL if the item does not exist
+ */
+itemHeaderPtr item_header_get (gulong id);
+
+/**
+ * Loads the headers of all given items not yet cached using as
+ * few DB queries as possible. To be used before iterating over
+ * a larger number of items with item_header_get().
+ *
+ * @param ids	array of item ids
+ * @param count	number of ids
+ */
+void item_header_prefetch (const gulong *ids, guint count);
+
+/**
+ * Convenience variant of item_header_prefetch() for GList id lists
+ * as used by item sets.
+ *
+ * @param ids	list of item ids (GUINT_TO_POINTER)
+ */
+void item_header_prefetch_list (GList *ids);
+
+/**
+ * Updates the cached header of the given item (if cached).
+ * To be called by the DB layer on each item write.
+ *
+ * @param item	the written item
+ */
+void item_header_update (itemPtr item);
+
+/**
+ * Drops the header of the given item and its comments.
+ * To be called by the DB layer on item removal.
+ *
+ * @param id	the item id
+ */
+void item_header_remove (gulong id);
+
+/**
+ * Drops the headers of all items of the given node.
+ * To be called by the DB layer on item set removal.
+ *
+ * @param nodeId	the node id
+ */
+void item_header_remove_node (const gchar *nodeId);
+
+/**
+ * Drops all cached headers and frees the cache.
+ */
+void item_header_cache_free (void);
+
+/**
+ * Returns the cache statistics.
+ *
+ * @param hits		returns the number of cache hits
+ * @param misses	returns the number of cache misses
+ * @param size		returns the number of cached headers
+ */
+void item_header_get_cache_counts (gulong *hits, gulong *misses, guint *size);
+
+#endif
@@ -22,6 +22,7 @@
 #include "debug.h"
 #include "feedlist.h"
 #include "item.h"
+#include "item_header.h"
 #include "item_state.h"
 #include "itemset.h"
 #include "itemlist.h"
@@ -107,17 +108,25 @@ item_read_state_changed (itemPtr item, gboolean newState)
 
 		duplicates = iter = db_item_get_duplicates (item->sourceId);
 		while (iter) {
-			itemPtr duplicate = item_load (GPOINTER_TO_UINT (iter->data));
+			gulong		id = GPOINTER_TO_UINT (iter->data);
+			itemHeaderPtr	header = item_header_get (id);
 
 			/* The check on node_from_id() is an evil workaround
 			   to handle "lost" items in the DB that have no 
 			   associated node in the feed list. This should be 
 			   fixed by having the feed list in the DB too, so
-			   we can clean up correctly after crashes. */
-			if (duplicate && duplicate->id != item->id && node_from_id (duplicate->nodeId)) {
-				item_set_read_state (duplicate, newState);
+			   we can clean up correctly after crashes.
+
+			   Duplicates already in the right state are skipped
+			   using the item header without loading them. */
+			if (header && id != item->id && node_from_id (header->nodeId) &&
+			    (header->readStatus != (newState?1:0) || header->updateStatus)) {
+				itemPtr duplicate = item_load_light (id);
+				if (duplicate) {
+					item_set_read_state (duplicate, newState);
+					item_unload (duplicate);
+				}
 			}
-			if (duplicate) item_unload (duplicate);
 			iter = g_slist_next (iter);
 		}
 		g_slist_free (duplicates);
@@ -140,10 +149,13 @@ itemset_mark_read (nodePtr node)
 	itemSetPtr	itemSet;
 
 	itemSet = node_get_itemset (node);
+	item_header_prefetch_list (itemSet->ids);
 	GList *iter = itemSet->ids;
 	while (iter) {
 		gulong id = GPOINTER_TO_UINT (iter->data);
-		itemPtr item = item_load (id);
+		itemHeaderPtr header = item_header_get (id);
+		/* only load the items that need to be changed */
+		itemPtr item = (header && !header->readStatus)?item_load_light (id):NULL;
 		if (item) {
 			if (!item->readStatus) {
 				nodePtr node = node_from_id (item->nodeId);
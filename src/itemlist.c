@@ -29,6 +29,7 @@
 #include "feed.h"
 #include "feedlist.h"
 #include "folder.h"
+#include "item_header.h"
 #include "item_history.h"
 #include "item_state.h"
 #include "itemlist.h"
@@ -186,7 +187,7 @@ itemlist_check_for_deferred_action (void)
 		/* check for removals caused by itemlist filter rule */
 		if (itemlist->priv->deferredFilter) {
 			itemlist->priv->deferredFilter = FALSE;
-			item = item_load (id);
+			item = item_load_light (id);
 			itemview_remove_item (item);
 			feed_list_node_update (item->nodeId);
 		}
@@ -194,28 +195,57 @@ itemlist_check_for_deferred_action (void)
 		/* check for removals caused by vfolder rules */
 		if (itemlist->priv->deferredRemove) {
 			itemlist->priv->deferredRemove = FALSE;
-			item = item_load (id);
+			item = item_load_light (id);
 			itemlist_remove_item (item);
 		}
 	}
 }
 
+/* returns the rules to filter the current item list with (or NULL) */
+static itemSetPtr
+itemlist_filter_get_rules (void)
+{
+	/* use search folder rule list in case of a search folder */
+	if (itemlist->priv->currentNode && IS_VFOLDER (itemlist->priv->currentNode))
+		return ((vfolderPtr)itemlist->priv->currentNode->data)->itemset;
+
+	/* apply the item list filter if available */
+	return itemlist->priv->filter;
+}
+
 // FIXME: is this an item set method?
 static gboolean
 itemlist_filter_check_item (itemPtr item)
 {
-	/* use search folder rule list in case of a search folder */
-	if (itemlist->priv->currentNode && IS_VFOLDER (itemlist->priv->currentNode)) {
-		vfolderPtr vfolder = (vfolderPtr)itemlist->priv->currentNode->data;
-		return itemset_check_item (vfolder->itemset, item);
-	}
+	itemSetPtr rules = itemlist_filter_get_rules ();
 
-	/* apply the item list filter if available */
-	if (itemlist->priv->filter)
-		return itemset_check_item (itemlist->priv->filter, item);
-	
-	/* otherwise keep the item */
-	return TRUE;
+	/* keep the item if there are no rules */
+	if (!rules)
+		return TRUE;
+
+	return itemset_check_item (rules, item);
+}
+
+/* Pre-check of duplicate elimination and filtering using the item
+   header, returns FALSE if the item doesn't need to be loaded */
+static gboolean
+itemlist_check_item_header (gulong id)
+{
+	itemHeaderPtr	header = item_header_get (id);
+	itemSetPtr	rules = itemlist_filter_get_rules ();
+	gboolean	decided;
+
+	if (!header)
+		return FALSE;
+
+	if (header->validGuid && header->sourceId && itemlist->priv->guids &&
+	    g_hash_table_lookup (itemlist->priv->guids, header->sourceId))
+		return FALSE;
+
+	if (!rules)
+		return TRUE;
+
+	return itemset_check_item_header (rules, header, &decided);
 }
 
 static void
@@ -264,8 +294,25 @@ itemlist_merge_itemset (itemSetPtr itemSet)
 	debug_enter ("itemlist_merge_itemset");
 	
 	if (itemlist_itemset_is_valid (itemSet)) {
+		GList *iter;
+
 		debug_start_measurement (DEBUG_GUI);
-		itemset_foreach (itemSet, itemlist_merge_item);
+
+		item_header_prefetch_list (itemSet->ids);
+		for (iter = itemSet->ids; iter; iter = g_list_next (iter)) {
+			gulong	id = GPOINTER_TO_UINT (iter->data);
+			itemPtr	item;
+
+			if (!itemlist_check_item_header (id))
+				continue;
+
+			item = item_load_light (id);
+			if (item) {
+				itemlist_merge_item (item);
+				item_unload (item);
+			}
+		}
+
 		itemview_update ();
 		debug_end_measurement (DEBUG_GUI, "itemlist merge");
 	}
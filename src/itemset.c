@@ -29,6 +29,7 @@
 #include "itemlist.h"
 #include "itemset.h"
 #include "metadata.h"
+#include "metrics.h"
 #include "node.h"
 #include "rule.h"
 #include "vfolder.h"
@@ -249,12 +250,13 @@ itemset_merge_item (itemSetPtr itemSet, GList *items, itemPtr item, gint maxChec
 
 		/* step 4: Check item for new enclosures to download */
 		if (node && (((feedPtr)node->data)->encAutoDownload)) {
-			GSList *iter = metadata_list_get_values (item->metadata, "enclosure");
-			while (iter) {
-				enclosurePtr enc = enclosure_from_string (iter->data);
-				debug1 (DEBUG_UPDATE, "download enclosure (%s)", (gchar *)iter->data);
+			GPtrArray	*enclosures = metadata_list_get_values (item->metadata, "enclosure");
+			guint		i;
+
+			for (i = 0; enclosures && i < enclosures->len; i++) {
+				enclosurePtr enc = enclosure_from_string (g_ptr_array_index (enclosures, i));
+				debug1 (DEBUG_UPDATE, "download enclosure (%s)", (gchar *)g_ptr_array_index (enclosures, i));
 				enclosure_download (NULL, enc->url, FALSE /* non interactive */);
-				iter = g_slist_next (iter);
 				enclosure_free (enc);
 			}
 		}
@@ -296,11 +298,20 @@ itemset_sort_by_date (gconstpointer a, gconstpointer b)
 	return 0;
 }
 
+static metricsHistogram mergeLatency;
+
+const metricsHistogram *
+itemset_get_merge_latency (void)
+{
+	return &mergeLatency;
+}
+
 guint
 itemset_merge_items (itemSetPtr itemSet, GList *list, gboolean allowUpdates, gboolean markAsRead)
 {
 	GList	*iter, *droppedItems = NULL, *items = NULL;
 	guint	i, max, length, toBeDropped, newCount = 0, flagCount = 0;
+	gint64	start = g_get_monotonic_time ();
 
 	debug_start_measurement (DEBUG_UPDATE);
 	
@@ -432,6 +443,8 @@ itemset_merge_items (itemSetPtr itemSet, GList *list, gboolean allowUpdates, gbo
 		debug0 (DEBUG_CACHE, "Fatal: Item merging bug! Resulting item list is too long! Cache limit does not work. This is a severe program bug!");
 	
 	g_list_free (items);
+
+	metrics_histogram_add_since (&mergeLatency, start);
 	
 	debug_end_measurement (DEBUG_UPDATE, "merge itemset");
 	
@@ -460,6 +473,42 @@ itemset_check_item (itemSetPtr itemSet, itemPtr item)
 	return result;
 }
 
+gboolean
+itemset_check_item_header (itemSetPtr itemSet, itemHeaderPtr header, gboolean *decided)
+{
+	gboolean	result = TRUE;
+	GSList		*iter = itemSet->rules;
+
+	/* Same logic as itemset_check_item(), but rules without
+	   header check function leave the result undecided */
+	*decided = TRUE;
+	while (iter) {
+		rulePtr			rule = (rulePtr) iter->data;
+		ruleHeaderCheckFunc	func = rule->ruleInfo->headerCheckFunc;
+		gboolean		ruleResult = FALSE;
+
+		if (func) {
+			ruleResult = (*func) (rule, header);
+			result &= (rule->additive)?ruleResult:!ruleResult;
+			if (itemSet->anyMatch && ruleResult) {
+				*decided = TRUE;
+				return TRUE;
+			}
+			if (!itemSet->anyMatch && !result) {
+				*decided = TRUE;
+				return FALSE;
+			}
+		} else {
+			*decided = FALSE;
+		}
+
+		iter = g_slist_next (iter);
+	}
+
+	/* undecided items might match */
+	return result || !*decided;
+}
+
 void
 itemset_add_rule (itemSetPtr itemSet,
                   const gchar *ruleId,
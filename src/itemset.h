@@ -23,6 +23,7 @@
 #define _ITEMSET_H
 
 #include "item.h"
+#include "metrics.h"
 #include "rule.h"
 
 /**
@@ -64,6 +65,13 @@ void itemset_foreach (itemSetPtr itemSet, itemActionFunc callback);
  */
 guint itemset_merge_items(itemSetPtr itemSet, GList *items, gboolean allowUpdates, gboolean markAsRead);
 
+/**
+ * Returns the latency histogram of itemset_merge_items().
+ *
+ * @returns the histogram (owned by the item set code)
+ */
+const metricsHistogram * itemset_get_merge_latency (void);
+
 /**
  * Checks if the given item matches the rules of the given item set.
  *
@@ -74,6 +82,20 @@ guint itemset_merge_items(itemSetPtr itemSet, GList *items, gboolean allowUpdate
  */
 gboolean itemset_check_item (itemSetPtr itemSet, itemPtr item);
 
+/**
+ * Checks the rules of the given item set that can be decided on
+ * the item header alone. Allows skipping items that can't match
+ * without loading them.
+ *
+ * @param itemSet	the itemSet
+ * @param header	the item header
+ * @param decided	returns TRUE if the result is final and the
+ *			full item does not need to be checked
+ *
+ * @returns FALSE if the item does not match, TRUE if it might match
+ */
+gboolean itemset_check_item_header (itemSetPtr itemSet, itemHeaderPtr header, gboolean *decided);
+
 /**
  * Method that creates and adds a rule to an item set. To be used
  * on loading time, when creating searches or when editing
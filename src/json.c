@@ -20,6 +20,8 @@
 
 #include "json.h"
 
+#include <string.h>
+
 JsonNode *
 json_get_node (JsonNode *node, const gchar *keyName)
 {
@@ -87,3 +89,169 @@ json_get_bool (JsonNode *node, const gchar *keyName)
 	
 	return json_node_get_boolean (key);
 }
+
+/* Minimal JSON scanner helpers used to split a document into array
+   elements without building a DOM for the whole document. Only the
+   structure is checked here, actual element parsing is left to json-glib. */
+
+static const gchar *
+json_scan_skip_ws (const gchar *p, const gchar *end)
+{
+	while (p < end && (*p == ' ' || *p == '\t' || *p == '\n' || *p == '\r'))
+		p++;
+	return p;
+}
+
+/* expects p to point to an opening quote, returns pointer after closing quote */
+static const gchar *
+json_scan_skip_string (const gchar *p, const gchar *end)
+{
+	p++;
+	while (p < end) {
+		if (*p == '\\') {
+			p += 2;
+			continue;
+		}
+		if (*p == '"')
+			return p + 1;
+		p++;
+	}
+	return NULL;
+}
+
+/* returns pointer after the value starting at p (or NULL on syntax error) */
+static const gchar *
+json_scan_skip_value (const gchar *p, const gchar *end)
+{
+	gint	depth = 0;
+
+	p = json_scan_skip_ws (p, end);
+	if (p >= end)
+		return NULL;
+
+	if (*p == '"')
+		return json_scan_skip_string (p, end);
+
+	if (*p != '{' && *p != '[') {
+		/* number, true, false, null */
+		while (p < end && *p != ',' && *p != '}' && *p != ']' &&
+		       *p != ' ' && *p != '\t' && *p != '\n' && *p != '\r')
+			p++;
+		return p;
+	}
+
+	while (p < end) {
+		switch (*p) {
+			case '"':
+				p = json_scan_skip_string (p, end);
+				if (!p)
+					return NULL;
+				continue;
+			case '{':
+			case '[':
+				depth++;
+				break;
+			case '}':
+			case ']':
+				depth--;
+				if (0 == depth)
+					return p + 1;
+				break;
+		}
+		p++;
+	}
+
+	return NULL;
+}
+
+gboolean
+json_foreach_array_element (const gchar *json, gssize length, const gchar *root, jsonArrayElementFunc func, gpointer user_data)
+{
+	JsonParser	*parser;
+	const gchar	*p, *end;
+	gsize		rootLen = strlen (root);
+	gboolean	result = FALSE;
+
+	if (!json)
+		return FALSE;
+
+	if (length < 0)
+		length = strlen (json);
+
+	p = json;
+	end = json + length;
+
+	/* Find the root member in the top level object */
+	p = json_scan_skip_ws (p, end);
+	if (p >= end || *p != '{')
+		return FALSE;
+	p++;
+
+	while (p < end) {
+		const gchar *key, *keyEnd;
+
+		p = json_scan_skip_ws (p, end);
+		if (p >= end || *p == '}')
+			return FALSE;
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+		if (*p != '"')
+			return FALSE;
+
+		key = p + 1;
+		p = json_scan_skip_string (p, end);
+		if (!p)
+			return FALSE;
+		keyEnd = p - 1;
+
+		p = json_scan_skip_ws (p, end);
+		if (p >= end || *p != ':')
+			return FALSE;
+		p = json_scan_skip_ws (p + 1, end);
+
+		if ((gsize)(keyEnd - key) == rootLen && 0 == strncmp (key, root, rootLen))
+			break;
+
+		p = json_scan_skip_value (p, end);
+		if (!p)
+			return FALSE;
+	}
+
+	if (p >= end || *p != '[')
+		return FALSE;
+	p++;
+
+	/* Parse the array elements one by one, so only a single element
+	   tree is alive at any time. */
+	parser = json_parser_new ();
+	while (p < end) {
+		const gchar *elementEnd;
+
+		p = json_scan_skip_ws (p, end);
+		if (p >= end)
+			break;
+		if (*p == ',') {
+			p++;
+			continue;
+		}
+		if (*p == ']') {
+			result = TRUE;
+			break;
+		}
+
+		elementEnd = json_scan_skip_value (p, end);
+		if (!elementEnd)
+			break;
+
+		if (!json_parser_load_from_data (parser, p, elementEnd - p, NULL))
+			break;
+
+		(*func) (json_parser_get_root (parser), user_data);
+		p = elementEnd;
+	}
+	g_object_unref (parser);
+
+	return result;
+}
@@ -64,4 +64,22 @@ gint64 json_get_int (JsonNode *node, const gchar *key);
  */
 gboolean json_get_bool (JsonNode *node, const gchar *key);
 
+typedef void (*jsonArrayElementFunc)(JsonNode *node, gpointer user_data);
+
+/**
+ * Incrementally walk the elements of an array member of the top level
+ * object of a JSON document. Instead of building a DOM for the whole
+ * document only one element at a time is parsed and passed to the
+ * callback. The element node is only valid during the callback.
+ *
+ * @param json		the JSON document
+ * @param length	length of the document or -1 if NUL-terminated
+ * @param root		name of the top level array member (e.g. "items")
+ * @param func		callback to invoke for each array element
+ * @param user_data	user data passed to func
+ *
+ * @returns TRUE if the whole array could be processed
+ */
+gboolean json_foreach_array_element (const gchar *json, gssize length, const gchar *root, jsonArrayElementFunc func, gpointer user_data);
+
 #endif
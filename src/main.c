@@ -42,11 +42,14 @@
 #include "dbus.h"
 #include "debug.h"
 #include "feedlist.h"
+#include "headless.h"
 #include "social.h"
 #include "update.h"
 #include "xml.h"
 #include "ui/liferea_shell.h"
 
+#define LIFEREA_APPLICATION_ID	"net.sourceforge.liferea"
+
 static enum {
 	STATE_STARTING,
 	STATE_STARTED,
@@ -137,6 +140,45 @@ debug_entries_parse_callback (const gchar *option_name,
 	return TRUE;
 }
 
+static void
+on_headless_activate (GApplication *gapp, gpointer user_data)
+{
+	g_warning ("Liferea is updating without user interface, please try again later.");
+}
+
+static void
+on_headless_open (GApplication *gapp, GFile **files, gint n_files, gchar *hint, gpointer user_data)
+{
+	on_headless_activate (gapp, user_data);
+}
+
+/* Runs the headless update as the primary instance, so it never
+   works on the same profile as a running Liferea and vice versa */
+static gint
+update_headless (void)
+{
+	GApplication	*app;
+	GError		*error = NULL;
+	gint		status = 1;
+
+	app = g_application_new (LIFEREA_APPLICATION_ID, G_APPLICATION_HANDLES_OPEN);
+	g_signal_connect (app, "activate", G_CALLBACK (on_headless_activate), NULL);
+	g_signal_connect (app, "open", G_CALLBACK (on_headless_open), NULL);
+
+	if (!g_application_register (app, NULL, &error)) {
+		g_printerr ("Could not register the application: %s\n", error->message);
+		g_error_free (error);
+	} else if (g_application_get_is_remote (app)) {
+		g_printerr ("Liferea is already running, not updating!\n");
+	} else {
+		status = liferea_headless_update ();
+	}
+
+	g_object_unref (app);
+
+	return status;
+}
+
 static gboolean G_GNUC_NORETURN
 show_version (const gchar *option_name,
 	      const gchar *value,
@@ -157,12 +199,15 @@ main (int argc, char *argv[])
 	gulong		debug_flags = 0;
 	LifereaDBus	*dbus = NULL;
 	gchar		*feedUri = NULL;
+	gchar		*traceFile = NULL;
+	gboolean	updateHeadless = FALSE;
 	gint 		status;
 
 	GOptionEntry entries[] = {
 		{ "mainwindow-state", 'w', 0, G_OPTION_ARG_STRING, &initialStateOption, N_("Start Liferea with its main window in STATE. STATE may be `shown' or `hidden'"), N_("STATE") },
 		{ "version", 'v', G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, show_version, N_("Show version information and exit"), NULL },
 		{ "add-feed", 'a', 0, G_OPTION_ARG_STRING, &feedUri, N_("Add a new subscription"), N_("uri") },
+		{ "update-headless", 0, 0, G_OPTION_ARG_NONE, &updateHeadless, N_("Update all subscriptions without user interface, print statistics and exit"), NULL },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -180,6 +225,7 @@ main (int argc, char *argv[])
 		{ "debug-update", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, debug_entries_parse_callback, N_("Print debugging messages of the feed update processing"), NULL },
 		{ "debug-vfolder", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, debug_entries_parse_callback, N_("Print debugging messages of the search folder matching"), NULL },
 		{ "debug-verbose", 0, G_OPTION_FLAG_NO_ARG, G_OPTION_ARG_CALLBACK, debug_entries_parse_callback, N_("Print verbose debugging messages"), NULL },
+		{ "debug-trace-file", 0, 0, G_OPTION_ARG_FILENAME, &traceFile, N_("Record all performance measurements and write them on exit to FILE in Chrome trace event format"), N_("FILE") },
 		{ NULL, 0, 0, 0, NULL, NULL, NULL }
 	};
 
@@ -213,6 +259,8 @@ main (int argc, char *argv[])
 	}
 
 	set_debug_level (debug_flags);
+	if (traceFile)
+		debug_trace_enable (traceFile);
 
 	/* Configuration necessary for network options, so it
 	   has to be initialized before update_init() */
@@ -222,11 +270,19 @@ main (int argc, char *argv[])
 	   network-manager to be setup before gtk_init() */
 	update_init ();
 
+	if (updateHeadless) {
+		status = update_headless ();
+		conf_deinit ();
+		debug_trace_finish ();
+		g_free (traceFile);
+		return status;
+	}
+
 	gtk_init (&argc, &argv);
 
 	/* Single instance checks, also note that we pass or only RPC (add-feed)
 	   as activate signal payload as it is simply an URI string. */
-	app = gtk_application_new ("net.sourceforge.liferea", G_APPLICATION_HANDLES_OPEN);
+	app = gtk_application_new (LIFEREA_APPLICATION_ID, G_APPLICATION_HANDLES_OPEN);
 	g_signal_connect (app, "activate", G_CALLBACK (on_app_activate), feedUri);
 	g_signal_connect (app, "open", G_CALLBACK (on_feed_add), NULL);
 
@@ -270,6 +326,9 @@ main (int argc, char *argv[])
 	g_object_unref (G_OBJECT (dbus));
 	g_object_unref (app);
 
+	debug_trace_finish ();
+	g_free (traceFile);
+
 	return status;
 }
 
@@ -31,13 +31,22 @@
 /* Metadata in Liferea are ordered lists of key/value list pairs. Both 
    feed list nodes and items can have a list of metadata assigned. Metadata
    date values are always text values but maybe of different type depending
-   on their usage type. */
+   on their usage type.
 
-static GHashTable *metadataTypes = NULL;	/**< hash table with all registered meta data types */
+   Keys are interned as quarks, so they are not copied per list and are
+   compared by value. The values of a key are kept in an array. Once a key
+   has more than a few values a hash set is added for duplicate checks,
+   so appending many categories or enclosures does not get quadratic. */
+
+static GHashTable *metadataTypes = NULL;	/**< hash table with all registered meta data types (quark -> type) */
+
+/* number of values of a key from which on duplicates are checked using a hash set */
+#define METADATA_INDEX_THRESHOLD	8
 
 struct pair {
-	gchar		*strid;		/** metadata type id */
-	GSList		*data;		/** list of metadata values */
+	GQuark		key;		/** metadata type id */
+	GPtrArray	*values;	/** array of metadata values */
+	GHashTable	*index;		/** set of values for duplicate checks (or NULL) */
 };
 
 /* register metadata types to check validity on adding */
@@ -46,7 +55,7 @@ metadata_init (void)
 {
 	g_assert (NULL == metadataTypes);
 	
-	metadataTypes = g_hash_table_new (g_str_hash, g_str_equal);
+	metadataTypes = g_hash_table_new (g_direct_hash, g_direct_equal);
 	
 	/* generic types */
 	metadata_type_register ("author",		METADATA_TYPE_HTML);
@@ -119,16 +128,37 @@ metadata_type_register (const gchar *name, gint type)
 	if (!metadataTypes)
 		metadata_init ();	
 	
-	g_hash_table_insert (metadataTypes, (gpointer)name, GINT_TO_POINTER (type));
+	g_hash_table_insert (metadataTypes, GUINT_TO_POINTER (g_quark_from_static_string (name)), GINT_TO_POINTER (type));
+}
+
+gboolean
+metadata_is_html (const gchar *strid)
+{
+	gint	type;
+
+	if (!metadataTypes)
+		metadata_init ();
+
+	type = GPOINTER_TO_INT (g_hash_table_lookup (metadataTypes, GUINT_TO_POINTER (g_quark_try_string (strid))));
+
+	/* unknown types are handled as HTML, see metadata_list_append() */
+	return (METADATA_TYPE_TEXT != type) && (METADATA_TYPE_URL != type);
 }
 
 gboolean
 metadata_is_type_registered (const gchar *strid)
 {
+	GQuark	key;
+
 	if (!metadataTypes)
 		metadata_init ();
 
-	if (g_hash_table_lookup (metadataTypes, strid))
+	/* a key that was never interned can't be registered */
+	key = g_quark_try_string (strid);
+	if (!key)
+		return FALSE;
+
+	if (g_hash_table_lookup (metadataTypes, GUINT_TO_POINTER (key)))
 		return TRUE;
 	else
 		return FALSE;
@@ -142,28 +172,106 @@ metadata_get_type (const gchar *name)
 	if (!metadataTypes)
 		metadata_init ();
 
-	type = GPOINTER_TO_INT (g_hash_table_lookup (metadataTypes, (gpointer)name));
+	type = GPOINTER_TO_INT (g_hash_table_lookup (metadataTypes, GUINT_TO_POINTER (g_quark_try_string (name))));
 	if (0 == type)
 		g_warning ("Unknown metadata type: %s, please report this Liferea bug!", name);
 	
 	return type;
 }
 
-static gint
-metadata_value_cmp (gconstpointer a, gconstpointer b)
+static struct pair *
+metadata_pair_new (GQuark key)
 {
-	if (g_str_equal ((gchar *)a, (gchar *)b))
-		return 0;
+	struct pair *p;
+
+	p = g_new0 (struct pair, 1);
+	p->key = key;
+	p->values = g_ptr_array_new_with_free_func (g_free);
 
-	return 1;
+	return p;
+}
+
+static void
+metadata_pair_free (struct pair *p)
+{
+	if (p->index)
+		g_hash_table_destroy (p->index);
+	g_ptr_array_free (p->values, TRUE);
+	g_free (p);
+}
+
+static gboolean
+metadata_pair_contains (struct pair *p, const gchar *value)
+{
+	guint	i;
+
+	if (p->index)
+		return (NULL != g_hash_table_lookup (p->index, value));
+
+	for (i = 0; i < p->values->len; i++) {
+		if (g_str_equal (g_ptr_array_index (p->values, i), value))
+			return TRUE;
+	}
+
+	return FALSE;
+}
+
+/* adds a value, takes ownership of value */
+static void
+metadata_pair_add (struct pair *p, gchar *value)
+{
+	guint	i;
+
+	g_ptr_array_add (p->values, value);
+
+	if (p->index) {
+		g_hash_table_insert (p->index, value, value);
+	} else if (p->values->len >= METADATA_INDEX_THRESHOLD) {
+		p->index = g_hash_table_new (g_str_hash, g_str_equal);
+		for (i = 0; i < p->values->len; i++)
+			g_hash_table_insert (p->index, g_ptr_array_index (p->values, i), g_ptr_array_index (p->values, i));
+	}
+}
+
+static struct pair *
+metadata_list_find (GSList *metadata, GQuark key)
+{
+	/* The number of distinct keys per list is small, so a
+	   scan comparing quarks is cheaper than any hashing */
+	for (; metadata; metadata = metadata->next) {
+		if (((struct pair *)metadata->data)->key == key)
+			return (struct pair *)metadata->data;
+	}
+
+	return NULL;
+}
+
+/* adds an already checked value, takes ownership of data */
+static GSList *
+metadata_list_insert (GSList *metadata, const gchar *strid, gchar *data)
+{
+	GQuark		key = g_quark_from_string (strid);
+	struct pair 	*p;
+
+	p = metadata_list_find (metadata, key);
+	if (!p) {
+		p = metadata_pair_new (key);
+		metadata = g_slist_append (metadata, p);
+	}
+
+	/* Avoid duplicate values */
+	if (metadata_pair_contains (p, data))
+		g_free (data);
+	else
+		metadata_pair_add (p, data);
+
+	return metadata;
 }
 
 GSList *
 metadata_list_append (GSList *metadata, const gchar *strid, const gchar *data)
 {
-	GSList		*iter = metadata;
 	gchar		*tmp, *checked_data = NULL;
-	struct pair 	*p;
 	
 	if (!data)
 		return metadata;
@@ -201,122 +309,109 @@ metadata_list_append (GSList *metadata, const gchar *strid, const gchar *data)
 			g_free (tmp);
 			break;
 	}
-	
-	while (iter) {
-		p = (struct pair*)iter->data; 
-		if (g_str_equal (p->strid, strid)) {
-			/* Avoid duplicate values */
-			if (NULL == g_slist_find_custom (p->data, checked_data, metadata_value_cmp))
-				p->data = g_slist_append (p->data, checked_data);
-                        else
-                                g_free (checked_data);
-			return metadata;
-		}
-		iter = iter->next;
-	}
-	p = g_new (struct pair, 1);
-	p->strid = g_strdup (strid);
-	p->data = g_slist_append (NULL, checked_data);
-	metadata = g_slist_append (metadata, p);
-	return metadata;
+
+	return metadata_list_insert (metadata, strid, checked_data);
+}
+
+GSList *
+metadata_list_append_checked (GSList *metadata, const gchar *strid, const gchar *data)
+{
+	if (!data)
+		return metadata;
+
+	return metadata_list_insert (metadata, strid, g_strdup (data));
 }
 
 void
 metadata_list_set (GSList **metadata, const gchar *strid, const gchar *data)
 {
-	GSList	*iter = *metadata;
-	struct pair *p;
+	GQuark		key = g_quark_from_string (strid);
+	gchar		*value = g_strdup (data);	/* copy first, data might be the old value */
+	struct pair	*p;
 	
-	while (iter) {
-		p = (struct pair*)iter->data; 
-		if (g_str_equal (p->strid, strid)) {
-                        g_slist_free_full (p->data, g_free);
-                        p->data = g_slist_append (NULL, g_strdup (data));
-			return;
+	p = metadata_list_find (*metadata, key);
+	if (p) {
+		if (p->index) {
+			g_hash_table_destroy (p->index);
+			p->index = NULL;
 		}
-		iter = iter->next;
+		g_ptr_array_set_size (p->values, 0);
+	} else {
+		p = metadata_pair_new (key);
+		*metadata = g_slist_append (*metadata, p);
 	}
-	p = g_new (struct pair, 1);
-	p->strid = g_strdup (strid);
-	p->data = g_slist_append (NULL, g_strdup (data));
-	*metadata = g_slist_append (*metadata, p);
+
+	metadata_pair_add (p, value);
 }
 
 void
 metadata_list_foreach (GSList *metadata, metadataForeachFunc func, gpointer user_data)
 {
 	GSList	*list = metadata;
-	guint	index = 0;
+	guint	i, index = 0;
 	
 	while (list) {
-		struct pair *p = (struct pair*)list->data; 
-		GSList *values = (GSList *)p->data;
-		while (values) {
+		struct pair	*p = (struct pair*)list->data; 
+		const gchar	*strid = g_quark_to_string (p->key);
+
+		for (i = 0; i < p->values->len; i++) {
 			index++;
-			(*func)(p->strid, values->data, index, user_data);
-			values = g_slist_next (values);
+			(*func)(strid, g_ptr_array_index (p->values, i), index, user_data);
 		}
 		list = list->next;
 	}
 }
 
-GSList *
+GPtrArray *
 metadata_list_get_values (GSList *metadata, const gchar *strid)
 {
-	GSList *list = metadata;
+	GQuark		key = g_quark_try_string (strid);
+	struct pair	*p;
 	
-	while (list) {
-		struct pair *p = (struct pair*)list->data; 
-		if (g_str_equal (p->strid, strid))
-			return p->data;
-		list = list->next;
-	}
-	return NULL;
+	if (!key)
+		return NULL;
+
+	p = metadata_list_find (metadata, key);
+	if (!p || !p->values->len)
+		return NULL;
+
+	return p->values;
 }
 
 const gchar *
 metadata_list_get (GSList *metadata, const gchar *strid)
 {
-	GSList	*values;
+	GPtrArray	*values;
 	
 	values = metadata_list_get_values (metadata, strid);
-	return values?values->data:NULL;
-
+	return values?g_ptr_array_index (values, 0):NULL;
 }
 
 GSList *
 metadata_list_copy (GSList *list)
 {
 	GSList		*copy = NULL;
-	GSList		*iter2, *iter = list;
-	struct pair	*p;
+	GSList		*iter = list;
+	struct pair	*p, *p2;
+	guint		i;
 	
+	/* values were checked when they were added, so just copy them */
 	while (iter) {
 		p = (struct pair*)iter->data;
-		iter2 = p->data;
-		while (iter2) {
-			copy = metadata_list_append (copy, p->strid, iter2->data);
-			iter2 = iter2->next;
-		}
+		p2 = metadata_pair_new (p->key);
+		for (i = 0; i < p->values->len; i++)
+			metadata_pair_add (p2, g_strdup (g_ptr_array_index (p->values, i)));
+		copy = g_slist_prepend (copy, p2);
 		iter = iter->next;
 	}
 	
-	return copy;
+	return g_slist_reverse (copy);
 }
 
 void
 metadata_list_free (GSList *metadata)
 {
-	GSList *iter = metadata;
-	
-	while (iter) {
-		struct pair *p = (struct pair*)iter->data;
-                g_slist_free_full (p->data, g_free);
-		g_free (p->strid);
-		g_free (p);
-		iter = iter->next;
-	}
-	g_slist_free (metadata);
+	g_slist_free_full (metadata, (GDestroyNotify)metadata_pair_free);
 }
 
 void
@@ -325,16 +420,16 @@ metadata_add_xml_nodes (GSList *metadata, xmlNodePtr parentNode)
 	GSList *list = metadata;
 	xmlNodePtr attribute;
 	xmlNodePtr metadataNode = xmlNewChild (parentNode, NULL, "attributes", NULL);
+	guint i;
 	
 	while (list) {
 		struct pair *p = (struct pair*)list->data; 
-		GSList *list2 = p->data;
-		while (list2) {
-			attribute = xmlNewTextChild (metadataNode, NULL, "attribute", list2->data);
-			xmlNewProp (attribute, "name", p->strid);
-			list2 = list2->next;
+		const gchar *strid = g_quark_to_string (p->key);
+
+		for (i = 0; i < p->values->len; i++) {
+			attribute = xmlNewTextChild (metadataNode, NULL, "attribute", g_ptr_array_index (p->values, i));
+			xmlNewProp (attribute, "name", strid);
 		}
 		list = list->next;
 	}
 }
-
@@ -62,6 +62,16 @@ enum {
  */
 void metadata_type_register (const gchar *name, gint);
 
+/**
+ * Checks whether values of a metadata type are HTML and
+ * therefore sanitized when added. This includes unknown types.
+ *
+ * @param strid		the metadata type identifier
+ *
+ * @returns TRUE if values of the metadata type are HTML
+ */
+gboolean metadata_is_html (const gchar *strid);
+
 /**
  * Checks whether a metadata type is registered
  *
@@ -83,6 +93,19 @@ gboolean metadata_is_type_registered (const gchar *strid);
  */
 GSList * metadata_list_append(GSList *metadata, const gchar *strid, const gchar *data);
 
+/**
+ * Like metadata_list_append() but without the format checks and
+ * HTML sanitizing. Only to be used for values that were already
+ * checked when they were first added (e.g. when loading from DB).
+ *
+ * @param metadata	the metadata list
+ * @param strid		the metadata type identifier
+ * @param data		data to add
+ *
+ * @returns the changed meta data list
+ */
+GSList * metadata_list_append_checked (GSList *metadata, const gchar *strid, const gchar *data);
+
 /** 
  * Sets (and overwrites if necessary) the value of a specific metadata type.
  * Don't mix this function with metadata_list_append() !
@@ -124,14 +147,14 @@ typedef void	(*metadataForeachFunc)	(const gchar *key, const gchar *value, guint
 void metadata_list_foreach(GSList *metadata, metadataForeachFunc func, gpointer user_data);
 
 /**
- * Returns a list of all values of a given type from a specified metadata list.
+ * Returns all values of a given type from a specified metadata list.
  *
  * @param metadata	the metadata list
  * @param strid		the metadata type identifier
  *
- * @returns a list of values (or NULL)
+ * @returns an array of value strings owned by the metadata list (or NULL)
  */
-GSList * metadata_list_get_values(GSList *metadata, const gchar *strid);
+GPtrArray * metadata_list_get_values(GSList *metadata, const gchar *strid);
 
 /** 
  * Creates a copy of a given metadata list.
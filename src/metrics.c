@@ -0,0 +1,64 @@
+/**
+ * @file metrics.c  runtime statistics helpers
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "metrics.h"
+
+void
+metrics_histogram_add (metricsHistogram *histogram, gint64 duration)
+{
+	guint	bucket = 0;
+	gint64	tmp;
+
+	if (duration < 0)
+		duration = 0;
+
+	for (tmp = duration; tmp > 1 && bucket < METRICS_HISTOGRAM_BUCKETS - 1; tmp >>= 1)
+		bucket++;
+
+	histogram->count++;
+	histogram->total += duration;
+	histogram->max = MAX (histogram->max, duration);
+	histogram->buckets[bucket]++;
+}
+
+void
+metrics_histogram_add_since (metricsHistogram *histogram, gint64 start)
+{
+	metrics_histogram_add (histogram, g_get_monotonic_time () - start);
+}
+
+gint64
+metrics_histogram_percentile (const metricsHistogram *histogram, guint percent)
+{
+	gulong	seen = 0, needed;
+	guint	i;
+
+	if (!histogram->count)
+		return 0;
+
+	needed = (histogram->count * MIN (percent, 100) + 99) / 100;
+	for (i = 0; i < METRICS_HISTOGRAM_BUCKETS; i++) {
+		seen += histogram->buckets[i];
+		if (seen >= MAX (needed, 1))
+			return MIN ((gint64)1 << (i + 1), histogram->max);
+	}
+
+	return histogram->max;
+}
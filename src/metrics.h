@@ -0,0 +1,68 @@
+/**
+ * @file metrics.h  runtime statistics helpers
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _METRICS_H
+#define _METRICS_H
+
+#include <glib.h>
+
+/* Latency histograms are cheap enough to be always collected. They
+   use logarithmic buckets, bucket n counts durations of up to
+   2^(n+1) microseconds, so percentiles are accurate to a factor of
+   two which is sufficient for spotting a backed up pipeline.
+
+   Histograms are not locked, each must be updated by one thread only. */
+
+#define METRICS_HISTOGRAM_BUCKETS	32
+
+typedef struct metricsHistogram {
+	gulong		count;		/**< number of recorded durations */
+	gint64		total;		/**< sum of all durations in us */
+	gint64		max;		/**< longest duration in us */
+	gulong		buckets[METRICS_HISTOGRAM_BUCKETS];
+} metricsHistogram;
+
+/**
+ * Adds a duration to the given histogram.
+ *
+ * @param histogram	the histogram
+ * @param duration	the duration in us
+ */
+void metrics_histogram_add (metricsHistogram *histogram, gint64 duration);
+
+/**
+ * Adds the time passed since the given start time to the histogram.
+ *
+ * @param histogram	the histogram
+ * @param start		start time as returned by g_get_monotonic_time()
+ */
+void metrics_histogram_add_since (metricsHistogram *histogram, gint64 start);
+
+/**
+ * Returns an upper bound of the given percentile.
+ *
+ * @param histogram	the histogram
+ * @param percent	the percentile (0-100)
+ *
+ * @returns duration in us (0 if the histogram is empty)
+ */
+gint64 metrics_histogram_percentile (const metricsHistogram *histogram, guint percent);
+
+#endif
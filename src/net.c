@@ -31,9 +31,42 @@
 #include "common.h"
 #include "conf.h"
 #include "debug.h"
+#include "metrics.h"
 
 #define HOMEPAGE	"http://lzone.de/liferea/"
 
+/* Connection pool limits. Many feeds are served by a few hosts (e.g.
+   CDNs), so allow more than libsoup's default of 2 connections per
+   host. The update queue runs only a few downloads at once anyway. */
+#define NETWORK_MAX_CONNS		32
+#define NETWORK_MAX_CONNS_PER_HOST	4
+
+/* Keep idle connections open over several runs of the auto update
+   check (every 10s), so that downloads from the same host started
+   by different runs reuse them. TLS sessions are cached by the TLS backend, so new
+   connections to known hosts usually resume the TLS session. */
+#define NETWORK_IDLE_TIMEOUT		90	/* seconds */
+
+/* Connecting (including name resolution and the TLS handshake)
+   fails much earlier than reading a response, so that dead hosts
+   do not block update slots for long. */
+#define NETWORK_CONNECT_TIMEOUT		15	/* seconds */
+#define NETWORK_READ_TIMEOUT		120	/* seconds */
+
+/* Default download size limit, can be overridden per subscription */
+#define NETWORK_DEFAULT_MAX_SIZE	(32 * 1024)	/* kB */
+
+/* Number of leading bytes checked to look like a feed */
+#define NETWORK_SNIFF_LENGTH		512
+
+/* The response body is collected by us instead of libsoup, so that
+   the download can be checked and aborted while it is running. */
+typedef struct networkDownload {
+	GByteArray	*body;		/**< decoded response body */
+	gsize		maxSize;	/**< size limit in bytes */
+	gboolean	sniff;		/**< TRUE until the body start was checked */
+} *networkDownloadPtr;
+
 static SoupSession *session = NULL;
 
 static gchar	*proxyname = NULL;
@@ -41,12 +74,81 @@ static gchar	*proxyusername = NULL;
 static gchar	*proxypassword = NULL;
 static int	proxyport = 0;
 
+/* download statistics */
+static GHashTable	*hostsInFlight = NULL;	/**< interned host name -> number of running requests */
+static guint64		bytesReceived = 0;
+static gulong		responseCount = 0;
+static gulong		notModifiedCount = 0;
+static gulong		imUsedCount = 0;	/**< delta feed responses */
+static metricsHistogram	downloadLatency;
+static gulong		requestCount = 0;
+static gulong		connectionCount = 0;	/**< connections opened */
+static gulong		tlsHandshakeCount = 0;
+static gulong		abortedCount = 0;	/**< downloads aborted by the size limit or content check */
+static gulong		connectTimeoutCount = 0;
+
+static void
+network_host_in_flight_add (const gchar *host, gint diff)
+{
+	gint	count;
+
+	if (!host)
+		return;
+
+	if (!hostsInFlight)
+		hostsInFlight = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	count = GPOINTER_TO_INT (g_hash_table_lookup (hostsInFlight, host)) + diff;
+	if (count > 0)
+		g_hash_table_insert (hostsInFlight, (gpointer)host, GINT_TO_POINTER (count));
+	else
+		g_hash_table_remove (hostsInFlight, host);
+}
+
+static gboolean
+network_connect_timeout_cb (gpointer user_data)
+{
+	SoupMessage	*msg = (SoupMessage *)user_data;
+
+	debug1 (DEBUG_NET, "connecting to %s timed out", soup_uri_get_host (soup_message_get_uri (msg)));
+	g_object_set_data (G_OBJECT (msg), "liferea-connect-timeout", NULL);
+	connectTimeoutCount++;
+	soup_session_cancel_message (session, msg, SOUP_STATUS_CANT_CONNECT);
+
+	return FALSE;
+}
+
+static void
+network_connect_timeout_start (SoupMessage *msg)
+{
+	guint	id;
+
+	if (g_object_get_data (G_OBJECT (msg), "liferea-connect-timeout"))
+		return;
+
+	id = g_timeout_add_seconds (NETWORK_CONNECT_TIMEOUT, network_connect_timeout_cb, msg);
+	g_object_set_data (G_OBJECT (msg), "liferea-connect-timeout", GUINT_TO_POINTER (id));
+}
+
+static void
+network_connect_timeout_stop (SoupMessage *msg)
+{
+	guint	id = GPOINTER_TO_UINT (g_object_get_data (G_OBJECT (msg), "liferea-connect-timeout"));
+
+	if (!id)
+		return;
+
+	g_source_remove (id);
+	g_object_set_data (G_OBJECT (msg), "liferea-connect-timeout", NULL);
+}
+
 static void
 network_process_callback (SoupSession *session, SoupMessage *msg, gpointer user_data)
 {
-	updateJobPtr	job = (updateJobPtr)user_data;
-	SoupDate	*last_modified;
-	const gchar	*tmp = NULL;
+	updateJobPtr		job = (updateJobPtr)user_data;
+	networkDownloadPtr	download;
+	SoupDate		*last_modified;
+	const gchar		*tmp = NULL;
 
 	job->result->source = soup_uri_to_string (soup_message_get_uri(msg), FALSE);
 	if (SOUP_STATUS_IS_TRANSPORT_ERROR (msg->status_code)) {
@@ -60,8 +162,26 @@ network_process_callback (SoupSession *session, SoupMessage *msg, gpointer user_
 	debug1 (DEBUG_NET, "download status code: %d", msg->status_code);
 	debug1 (DEBUG_NET, "source after download: >>>%s<<<", job->result->source);
 
-	job->result->data = g_memdup (msg->response_body->data, msg->response_body->length+1);
-	job->result->size = (size_t)msg->response_body->length;
+	network_connect_timeout_stop (msg);
+	network_host_in_flight_add (g_object_get_data (G_OBJECT (msg), "liferea-host"), -1);
+	metrics_histogram_add_since (&downloadLatency, job->startTime);
+	download = g_object_get_data (G_OBJECT (msg), "liferea-download");
+	bytesReceived += download->body->len;
+	if (!SOUP_STATUS_IS_TRANSPORT_ERROR (msg->status_code))
+		responseCount++;
+	if (SOUP_STATUS_NOT_MODIFIED == msg->status_code)
+		notModifiedCount++;
+	if (SOUP_STATUS_IM_USED == msg->status_code)
+		imUsedCount++;
+
+	/* Pass the body without copying it. Aborted downloads
+	   provide no data, as with any other transport error. */
+	if (!SOUP_STATUS_IS_TRANSPORT_ERROR (msg->status_code)) {
+		job->result->size = download->body->len;
+		g_byte_array_append (download->body, (const guint8 *)"", 1);
+		job->result->data = (gchar *)g_byte_array_free (download->body, FALSE);
+		download->body = NULL;
+	}
 	debug1 (DEBUG_NET, "%d bytes downloaded", job->result->size);
 
 	job->result->contentType = g_strdup (soup_message_headers_get_content_type (msg->response_headers, NULL));
@@ -87,6 +207,135 @@ network_process_callback (SoupSession *session, SoupMessage *msg, gpointer user_
 	update_process_finished_job (job);
 }
 
+static void
+network_download_free (gpointer data)
+{
+	networkDownloadPtr download = (networkDownloadPtr)data;
+
+	if (download->body)
+		g_byte_array_free (download->body, TRUE);
+	g_free (download);
+}
+
+static void
+network_download_abort (SoupMessage *msg, guint status)
+{
+	debug2 (DEBUG_NET, "aborting download of %s (%s)", soup_uri_get_host (soup_message_get_uri (msg)), network_strerror (status, 0));
+	abortedCount++;
+	soup_session_cancel_message (session, msg, status);
+}
+
+/* Checks the start of the body to be plain XML or HTML (for
+   auto discovery). Stops checking once the first markup byte was
+   seen. Returns FALSE if the body cannot be a feed. */
+static gboolean
+network_download_sniff (networkDownloadPtr download)
+{
+	const guint8	*data = download->body->data;
+	gsize		length = MIN (download->body->len, NETWORK_SNIFF_LENGTH);
+	gsize		i = 0;
+
+	/* Wait for enough data to recognize byte order marks */
+	if (length < 3)
+		return TRUE;
+
+	/* UTF-16 is left to the parser */
+	if ((data[0] == 0xfe && data[1] == 0xff) || (data[0] == 0xff && data[1] == 0xfe)) {
+		download->sniff = FALSE;
+		return TRUE;
+	}
+
+	/* UTF-8 BOM */
+	if (data[0] == 0xef && data[1] == 0xbb && data[2] == 0xbf)
+		i = 3;
+
+	while (i < length && g_ascii_isspace (data[i]))
+		i++;
+
+	if (i < length || length == NETWORK_SNIFF_LENGTH)
+		download->sniff = FALSE;
+
+	return (i == length) || (data[i] == '<');
+}
+
+static void
+network_got_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	networkDownloadPtr	download = (networkDownloadPtr)user_data;
+	const gchar		*contentType;
+
+	if (!SOUP_STATUS_IS_SUCCESSFUL (msg->status_code))
+		return;
+
+	if (soup_message_headers_get_content_length (msg->response_headers) > download->maxSize) {
+		network_download_abort (msg, NETWORK_ERROR_TOO_LARGE);
+		return;
+	}
+
+	contentType = soup_message_headers_get_content_type (msg->response_headers, NULL);
+	if (download->sniff && contentType &&
+	    (g_str_has_prefix (contentType, "image/") ||
+	     g_str_has_prefix (contentType, "audio/") ||
+	     g_str_has_prefix (contentType, "video/")))
+		network_download_abort (msg, NETWORK_ERROR_NOT_A_FEED);
+}
+
+static void
+network_got_chunk_cb (SoupMessage *msg, SoupBuffer *chunk, gpointer user_data)
+{
+	networkDownloadPtr	download = (networkDownloadPtr)user_data;
+
+	if (download->body->len + chunk->length > download->maxSize) {
+		network_download_abort (msg, NETWORK_ERROR_TOO_LARGE);
+		return;
+	}
+
+	g_byte_array_append (download->body, (const guint8 *)chunk->data, chunk->length);
+
+	/* Error pages are not checked, they are never parsed */
+	if (download->sniff && SOUP_STATUS_IS_SUCCESSFUL (msg->status_code) &&
+	    !network_download_sniff (download))
+		network_download_abort (msg, NETWORK_ERROR_NOT_A_FEED);
+}
+
+/* Drops the body of e.g. a redirection response */
+static void
+network_restarted_cb (SoupMessage *msg, gpointer user_data)
+{
+	networkDownloadPtr	download = (networkDownloadPtr)user_data;
+
+	g_byte_array_set_size (download->body, 0);
+}
+
+static void
+network_event_cb (SoupMessage *msg, GSocketClientEvent event, GIOStream *connection, gpointer user_data)
+{
+	switch (event) {
+		case G_SOCKET_CLIENT_RESOLVING:
+			network_connect_timeout_start (msg);
+			break;
+		case G_SOCKET_CLIENT_CONNECTING:
+			connectionCount++;
+			break;
+		case G_SOCKET_CLIENT_TLS_HANDSHAKED:
+			tlsHandshakeCount++;
+			break;
+		case G_SOCKET_CLIENT_COMPLETE:
+			network_connect_timeout_stop (msg);
+			break;
+		default:
+			break;
+	}
+}
+
+/* Sending the request proves the connection to be established,
+   also when no connection events were seen */
+static void
+network_wrote_headers_cb (SoupMessage *msg, gpointer user_data)
+{
+	network_connect_timeout_stop (msg);
+}
+
 static SoupURI *
 network_get_proxy_uri (void)
 {
@@ -115,9 +364,11 @@ network_get_proxy_uri (void)
 void
 network_process_request (const updateJobPtr const job)
 {
-	SoupMessage	*msg;
-	SoupDate	*date;
-	gboolean	do_not_track = FALSE;
+	SoupMessage		*msg;
+	SoupDate		*date;
+	networkDownloadPtr	download;
+	const gchar		*host;
+	gboolean		do_not_track = FALSE;
 
 	g_assert (NULL != job->request);
 	debug1 (DEBUG_NET, "downloading %s", job->request->source);
@@ -160,6 +411,12 @@ network_process_request (const updateJobPtr const job)
 		soup_message_headers_append(msg->request_headers,
 					    "If-None-Match",
 					    update_state_get_etag (job->request->updateState));
+
+		/* Ask for a delta feed (RFC 3229) with the entries
+		   changed since the given ETag only. Servers not
+		   supporting it simply send the complete feed. */
+		if (!job->request->postdata)
+			soup_message_headers_append (msg->request_headers, "A-IM", "feed");
 	}
 
 	/* Support HTTP content negotiation */
@@ -205,9 +462,129 @@ network_process_request (const updateJobPtr const job)
 	if (do_not_track)
 		soup_message_headers_append (msg->request_headers, "DNT", "1");
 
+	/* Collect the body ourselves to enforce the size limit */
+	download = g_new0 (struct networkDownload, 1);
+	download->body = g_byte_array_new ();
+	download->maxSize = (gsize)((job->request->options && job->request->options->maxSize)?job->request->options->maxSize:NETWORK_DEFAULT_MAX_SIZE) * 1024;
+	download->sniff = job->request->expectFeed && !job->request->filtercmd;
+	g_object_set_data_full (G_OBJECT (msg), "liferea-download", download, network_download_free);
+	soup_message_body_set_accumulate (msg->response_body, FALSE);
+	g_signal_connect (msg, "got-headers", G_CALLBACK (network_got_headers_cb), download);
+	g_signal_connect (msg, "got-chunk", G_CALLBACK (network_got_chunk_cb), download);
+	g_signal_connect (msg, "restarted", G_CALLBACK (network_restarted_cb), download);
+
+	/* Only emitted for messages opening a new connection */
+	g_signal_connect (msg, "network-event", G_CALLBACK (network_event_cb), NULL);
+	g_signal_connect (msg, "wrote-headers", G_CALLBACK (network_wrote_headers_cb), NULL);
+	requestCount++;
+
+	/* The message URI can change on redirects, so remember the host
+	   for the statistics. Interned strings need no freeing. */
+	host = g_intern_string (soup_uri_get_host (soup_message_get_uri (msg)));
+	g_object_set_data (G_OBJECT (msg), "liferea-host", (gpointer)host);
+	network_host_in_flight_add (host, 1);
+
 	soup_session_queue_message (session, msg, network_process_callback, job);
 }
 
+void
+network_get_statistics (guint64 *bytes, gulong *responses, gulong *notModified, gulong *imUsed)
+{
+	*bytes = bytesReceived;
+	*responses = responseCount;
+	*notModified = notModifiedCount;
+	*imUsed = imUsedCount;
+}
+
+gulong
+network_get_aborted_count (void)
+{
+	return abortedCount;
+}
+
+gulong
+network_get_connect_timeout_count (void)
+{
+	return connectTimeoutCount;
+}
+
+const gchar *
+network_get_host (const gchar *url)
+{
+	SoupURI		*uri;
+	const gchar	*host = NULL;
+
+	uri = soup_uri_new (url);
+	if (!uri)
+		return NULL;
+
+	if (SOUP_URI_VALID_FOR_HTTP (uri))
+		host = g_intern_string (soup_uri_get_host (uri));
+	soup_uri_free (uri);
+
+	return host;
+}
+
+gboolean
+network_is_host_failure (gint netstatus, gint httpstatus)
+{
+	switch (netstatus) {
+		case 0:
+			break;
+		/* Not caused by the host */
+		case SOUP_STATUS_CANCELLED:
+		case SOUP_STATUS_CANT_RESOLVE_PROXY:
+		case SOUP_STATUS_CANT_CONNECT_PROXY:
+		case NETWORK_ERROR_TOO_LARGE:
+		case NETWORK_ERROR_NOT_A_FEED:
+		case NETWORK_ERROR_HOST_UNAVAILABLE:
+			return FALSE;
+		default:
+			return TRUE;
+	}
+
+	return (SOUP_STATUS_BAD_GATEWAY == httpstatus) ||
+	       (SOUP_STATUS_SERVICE_UNAVAILABLE == httpstatus) ||
+	       (SOUP_STATUS_GATEWAY_TIMEOUT == httpstatus);
+}
+
+gboolean
+network_is_host_response (gint netstatus, gint httpstatus)
+{
+	switch (netstatus) {
+		case 0:
+			return httpstatus >= 100;	/* no transport error */
+		case NETWORK_ERROR_TOO_LARGE:
+		case NETWORK_ERROR_NOT_A_FEED:
+			return TRUE;
+		default:
+			return FALSE;
+	}
+}
+
+void
+network_get_connection_statistics (gulong *requests, gulong *connections, gulong *tlsHandshakes)
+{
+	*requests = requestCount;
+	*connections = connectionCount;
+	*tlsHandshakes = tlsHandshakeCount;
+}
+
+GHashTable *
+network_get_hosts_in_flight (void)
+{
+	if (!hostsInFlight)
+		hostsInFlight = g_hash_table_new (g_direct_hash, g_direct_equal);
+
+	return hostsInFlight;
+}
+
+const metricsHistogram *
+network_get_download_latency (void)
+{
+	return &downloadLatency;
+}
+
 static void
 network_authenticate (
 	SoupSession *session,
@@ -249,8 +626,10 @@ network_init (void)
 	/* Initialize libsoup */
 	proxy = network_get_proxy_uri ();
 	session = soup_session_async_new_with_options (SOUP_SESSION_USER_AGENT, useragent,
-						       SOUP_SESSION_TIMEOUT, 120,
-						       SOUP_SESSION_IDLE_TIMEOUT, 30,
+						       SOUP_SESSION_TIMEOUT, NETWORK_READ_TIMEOUT,
+						       SOUP_SESSION_IDLE_TIMEOUT, NETWORK_IDLE_TIMEOUT,
+						       SOUP_SESSION_MAX_CONNS, NETWORK_MAX_CONNS,
+						       SOUP_SESSION_MAX_CONNS_PER_HOST, NETWORK_MAX_CONNS_PER_HOST,
 						       SOUP_SESSION_ADD_FEATURE, cookies,
 	                                               SOUP_SESSION_ADD_FEATURE_BY_TYPE, SOUP_TYPE_CONTENT_DECODER,
 						       NULL);
@@ -355,6 +734,9 @@ network_strerror (gint netstatus, gint httpstatus)
 		case SOUP_STATUS_CANT_CONNECT:		tmp = _("Unable to connect to remote host"); break;
 		case SOUP_STATUS_CANT_CONNECT_PROXY:	tmp = _("Unable to connect to proxy"); break;
 		case SOUP_STATUS_SSL_FAILED:		tmp = _("A network error occurred, or the other end closed the connection unexpectedly"); break;
+		case NETWORK_ERROR_TOO_LARGE:		tmp = _("The download was aborted as it exceeded the size limit"); break;
+		case NETWORK_ERROR_NOT_A_FEED:		tmp = _("The download was aborted as it is not a feed"); break;
+		case NETWORK_ERROR_HOST_UNAVAILABLE:	tmp = _("The host failed repeatedly, updates are postponed for a while"); break;
 
 		/* http 3xx redirection */
 		case SOUP_STATUS_MOVED_PERMANENTLY:	tmp = _("The resource moved permanently to a new location"); break;
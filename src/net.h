@@ -23,10 +23,16 @@
 #define _NET_H
 
 #include <glib.h>
+#include "metrics.h"
 #include "update.h"
 
 /* Simple glue layer to abstract network code */
 
+/* Transport error codes of aborted downloads, beyond the libsoup ones */
+#define NETWORK_ERROR_TOO_LARGE		90	/**< the download exceeded the size limit */
+#define NETWORK_ERROR_NOT_A_FEED	91	/**< the download is obviously no feed */
+#define NETWORK_ERROR_HOST_UNAVAILABLE	92	/**< the request was not sent as the host failed repeatedly */
+
 /** 
  * Initialize HTTP client networking support.
  */
@@ -94,4 +100,88 @@ void network_process_request (const updateJobPtr const job);
  */
 const char * network_strerror (gint netstatus, gint httpstatus);
 
+/**
+ * Returns download statistics since startup.
+ *
+ * @param bytes		returns the number of bytes received
+ * @param responses	returns the number of HTTP responses
+ * @param notModified	returns the number of "304 Not Modified" responses
+ * @param imUsed	returns the number of "226 IM Used" (delta feed) responses
+ */
+void network_get_statistics (guint64 *bytes, gulong *responses, gulong *notModified, gulong *imUsed);
+
+/**
+ * Returns the number of downloads aborted since startup
+ * because of the size limit or because they were no feed.
+ *
+ * @returns number of aborted downloads
+ */
+gulong network_get_aborted_count (void);
+
+/**
+ * Returns the number of connection attempts since startup
+ * that were aborted by the connect timeout.
+ *
+ * @returns number of connect timeouts
+ */
+gulong network_get_connect_timeout_count (void);
+
+/**
+ * Returns the host name of the given HTTP(S) URL.
+ *
+ * @param url		the URL
+ *
+ * @returns interned host name or NULL for other URLs
+ */
+const gchar * network_get_host (const gchar *url);
+
+/**
+ * Checks whether the given request result indicates a
+ * problem of the host, e.g. it could not be connected or
+ * reported to be overloaded.
+ *
+ * @param netstatus	network error status
+ * @param httpstatus	HTTP status code
+ *
+ * @returns TRUE if the host failed
+ */
+gboolean network_is_host_failure (gint netstatus, gint httpstatus);
+
+/**
+ * Checks whether the host did respond to the request, i.e.
+ * it sent a HTTP response or the download was aborted because
+ * of its content. Cancelled requests and proxy errors tell
+ * nothing about the host.
+ *
+ * @param netstatus	network error status
+ * @param httpstatus	HTTP status code
+ *
+ * @returns TRUE if the host responded
+ */
+gboolean network_is_host_response (gint netstatus, gint httpstatus);
+
+/**
+ * Returns connection statistics since startup. Requests not
+ * opening a new connection reused an idle connection.
+ *
+ * @param requests	returns the number of requests sent
+ * @param connections	returns the number of connections opened
+ * @param tlsHandshakes	returns the number of TLS handshakes
+ */
+void network_get_connection_statistics (gulong *requests, gulong *connections, gulong *tlsHandshakes);
+
+/**
+ * Returns the number of running requests per host.
+ *
+ * @returns hash of interned host names to counts (GINT_TO_POINTER)
+ */
+GHashTable * network_get_hosts_in_flight (void);
+
+/**
+ * Returns the download latency histogram.
+ *
+ * @returns the histogram (owned by the network code)
+ */
+const metricsHistogram * network_get_download_latency (void);
+
 #endif
@@ -57,6 +57,11 @@ struct atom10ParserState {
 };
 typedef void 	(*atom10ElementParserFunc)	(xmlNodePtr cur, feedParserCtxtPtr ctxt, struct atom10ParserState *state);
 
+/* interned element name -> element parser function */
+static GHashTable	*entryElementHash = NULL;
+static GHashTable	*feedElementHash = NULL;
+static const xmlChar	*entryName = NULL;
+
 static gchar *
 atom10_mark_up_text_content (gchar* content)
 {
@@ -487,26 +492,10 @@ atom10_parse_entry (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 	NsHandler		*nsh;
 	parseItemTagFunc	pf;
 	atom10ElementParserFunc func;
-	static GHashTable	*entryElementHash = NULL;
 	
-	if (!entryElementHash) {
-		entryElementHash = g_hash_table_new (g_str_hash, g_str_equal);
-		
-		g_hash_table_insert (entryElementHash, "author", &atom10_parse_entry_author);
-		g_hash_table_insert (entryElementHash, "category", &atom10_parse_entry_category);
-		g_hash_table_insert (entryElementHash, "content", &atom10_parse_entry_content);
-		g_hash_table_insert (entryElementHash, "contributor", &atom10_parse_entry_contributor);
-		g_hash_table_insert (entryElementHash, "id", &atom10_parse_entry_id);
-		g_hash_table_insert (entryElementHash, "link", &atom10_parse_entry_link);
-		g_hash_table_insert (entryElementHash, "published", &atom10_parse_entry_published);
-		g_hash_table_insert (entryElementHash, "rights", &atom10_parse_entry_rights);
-		/* FIXME: Parse "source" */
-		g_hash_table_insert (entryElementHash, "summary", &atom10_parse_entry_summary);
-		g_hash_table_insert (entryElementHash, "title", &atom10_parse_entry_title);
-		g_hash_table_insert (entryElementHash, "updated", &atom10_parse_entry_updated);
-	}	
+	g_assert (NULL != entryElementHash);
 
-	ctxt->item = item_new ();
+	feed_parser_ctxt_new_item (ctxt);
 	
 	cur = cur->xmlChildrenNode;
 	while (cur) {
@@ -516,8 +505,8 @@ atom10_parse_entry (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 			continue;
 		}
 		
-		if ((cur->ns->href   && (nsh = (NsHandler *)g_hash_table_lookup (ns_atom10_ns_uri_table, (gpointer)cur->ns->href))) ||
-		    (cur->ns->prefix && (nsh = (NsHandler *)g_hash_table_lookup (atom10_nstable, (gpointer)cur->ns->prefix)))) {
+		nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, atom10_nstable, ns_atom10_ns_uri_table);
+		if (nsh) {
 			
 			pf = nsh->parseItemTag;
 			if (pf)
@@ -553,6 +542,8 @@ atom10_parse_entry (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 	
 	/* after parsing we fill the infos into the itemPtr structure */
 	ctxt->item->readStatus = FALSE;
+
+	feed_parser_ctxt_finish_item (ctxt);
 	
 	if (0 == ctxt->item->time)
 		ctxt->item->time = ctxt->feed->time;
@@ -756,24 +747,8 @@ atom10_parse_feed (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 	NsHandler		*nsh;
 	parseChannelTagFunc	pf;
 	atom10ElementParserFunc func;
-	static GHashTable	*feedElementHash = NULL;
-	
-	if(!feedElementHash) {
-		feedElementHash = g_hash_table_new (g_str_hash, g_str_equal);
-		
-		g_hash_table_insert (feedElementHash, "author", &atom10_parse_feed_author);
-		g_hash_table_insert (feedElementHash, "category", &atom10_parse_feed_category);
-		g_hash_table_insert (feedElementHash, "contributor", &atom10_parse_feed_contributor);
-		g_hash_table_insert (feedElementHash, "generator", &atom10_parse_feed_generator);
-		g_hash_table_insert (feedElementHash, "icon", &atom10_parse_feed_icon);
-		g_hash_table_insert (feedElementHash, "id", &atom10_parse_feed_id);
-		g_hash_table_insert (feedElementHash, "link", &atom10_parse_feed_link);
-		g_hash_table_insert (feedElementHash, "logo", &atom10_parse_feed_logo);
-		g_hash_table_insert (feedElementHash, "rights", &atom10_parse_feed_rights);
-		g_hash_table_insert (feedElementHash, "subtitle", &atom10_parse_feed_subtitle);
-		g_hash_table_insert (feedElementHash, "title", &atom10_parse_feed_title);
-		g_hash_table_insert (feedElementHash, "updated", &atom10_parse_feed_updated);
-	}	
+
+	g_assert (NULL != feedElementHash);
 
 	while (TRUE) {
 		if (xmlStrcmp (cur->name, BAD_CAST"feed")) {
@@ -792,13 +767,7 @@ atom10_parse_feed (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 			/* check if supported namespace should handle the current tag 
 			   by trying to determine a namespace handler */
 			   
-			nsh = NULL;
-			
-			if (cur->ns->href)
-				nsh = (NsHandler *)g_hash_table_lookup (ns_atom10_ns_uri_table, (gpointer)cur->ns->href);
-			
-			if (cur->ns->prefix && !nsh)
-				nsh = (NsHandler *)g_hash_table_lookup (atom10_nstable, (gpointer)cur->ns->prefix);
+			nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, atom10_nstable, ns_atom10_ns_uri_table);
 				
 			if(nsh) {
 				pf = nsh->parseChannelTag;
@@ -826,7 +795,7 @@ atom10_parse_feed (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 			func = g_hash_table_lookup (feedElementHash, cur->name);
 			if (func) {
 				(*func) (cur, ctxt, NULL);
-			} else if (xmlStrEqual (cur->name, BAD_CAST"entry")) {
+			} else if (cur->name == entryName) {
 				ctxt->item = atom10_parse_entry (ctxt, cur);
 				if (ctxt->item)
 					ctxt->items = g_list_insert_sorted (ctxt->items, ctxt->item, atom10_item_sort_by_date);
@@ -849,6 +818,12 @@ atom10_format_check (xmlDocPtr doc, xmlNodePtr cur)
 	return xmlStrEqual (cur->name, BAD_CAST"feed") && xmlStrEqual (cur->ns->href, ATOM10_NS);
 }
 
+static void
+atom10_add_element (GHashTable *elements, const gchar *name, gpointer func)
+{
+	g_hash_table_insert (elements, (gpointer)xml_intern_name (name), func);
+}
+
 static void
 atom10_add_ns_handler (NsHandler *handler)
 {
@@ -864,6 +839,38 @@ atom10_init_feed_handler (void)
 	feedHandlerPtr	fhp;
 	
 	fhp = g_new0 (struct feedHandler, 1);
+
+	if (!entryElementHash) {
+		entryElementHash = g_hash_table_new (g_direct_hash, g_direct_equal);
+		atom10_add_element (entryElementHash, "author", &atom10_parse_entry_author);
+		atom10_add_element (entryElementHash, "category", &atom10_parse_entry_category);
+		atom10_add_element (entryElementHash, "content", &atom10_parse_entry_content);
+		atom10_add_element (entryElementHash, "contributor", &atom10_parse_entry_contributor);
+		atom10_add_element (entryElementHash, "id", &atom10_parse_entry_id);
+		atom10_add_element (entryElementHash, "link", &atom10_parse_entry_link);
+		atom10_add_element (entryElementHash, "published", &atom10_parse_entry_published);
+		atom10_add_element (entryElementHash, "rights", &atom10_parse_entry_rights);
+		/* FIXME: Parse "source" */
+		atom10_add_element (entryElementHash, "summary", &atom10_parse_entry_summary);
+		atom10_add_element (entryElementHash, "title", &atom10_parse_entry_title);
+		atom10_add_element (entryElementHash, "updated", &atom10_parse_entry_updated);
+
+		feedElementHash = g_hash_table_new (g_direct_hash, g_direct_equal);
+		atom10_add_element (feedElementHash, "author", &atom10_parse_feed_author);
+		atom10_add_element (feedElementHash, "category", &atom10_parse_feed_category);
+		atom10_add_element (feedElementHash, "contributor", &atom10_parse_feed_contributor);
+		atom10_add_element (feedElementHash, "generator", &atom10_parse_feed_generator);
+		atom10_add_element (feedElementHash, "icon", &atom10_parse_feed_icon);
+		atom10_add_element (feedElementHash, "id", &atom10_parse_feed_id);
+		atom10_add_element (feedElementHash, "link", &atom10_parse_feed_link);
+		atom10_add_element (feedElementHash, "logo", &atom10_parse_feed_logo);
+		atom10_add_element (feedElementHash, "rights", &atom10_parse_feed_rights);
+		atom10_add_element (feedElementHash, "subtitle", &atom10_parse_feed_subtitle);
+		atom10_add_element (feedElementHash, "title", &atom10_parse_feed_title);
+		atom10_add_element (feedElementHash, "updated", &atom10_parse_feed_updated);
+
+		entryName = xml_intern_name ("entry");
+	}
 	
 	if (!atom10_nstable) {
 		atom10_nstable = g_hash_table_new (g_str_hash, g_str_equal);
@@ -46,11 +46,11 @@ parse_item_tag (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 	
 	if (!xmlStrcmp (BAD_CAST "source", cur->name)) {
 		sourceTag = TRUE;
-		g_hash_table_insert (ctxt->item->tmpdata, g_strdup ("ag:source"), (gchar *)xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1));
+		g_hash_table_insert (ctxt->item->tmpdata, "ag:source", (gchar *)xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1));
 		
 	} else if (!xmlStrcmp (BAD_CAST "sourceURL", cur->name)) {  
 		sourceTag = TRUE;
-		g_hash_table_insert (ctxt->item->tmpdata, g_strdup ("ag:sourceURL"), (gchar *)xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1));	
+		g_hash_table_insert (ctxt->item->tmpdata, "ag:sourceURL", (gchar *)xmlNodeListGetString(cur->doc, cur->xmlChildrenNode, 1));	
 	}
 	
 	if (sourceTag) {
@@ -41,7 +41,7 @@ itemPtr parseEntry(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 	
 	g_assert(NULL != cur);
 		
-	ctxt->item = item_new();
+	feed_parser_ctxt_new_item (ctxt);
 	
 	cur = cur->xmlChildrenNode;
 	while(cur) {
@@ -54,8 +54,8 @@ itemPtr parseEntry(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 		
 		/* check namespace of this tag */
 		if(cur->ns) {
-			if((cur->ns->href && (nsh = (NsHandler *)g_hash_table_lookup(ns_pie_ns_uri_table, (gpointer)cur->ns->href))) ||
-			   (cur->ns->prefix && (nsh = (NsHandler *)g_hash_table_lookup(pie_nstable, (gpointer)cur->ns->prefix)))) {
+			nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, pie_nstable, ns_pie_ns_uri_table);
+			if(nsh) {
 				
 				if(NULL != (pf = nsh->parseItemTag))
 					(*pf)(ctxt, cur);
@@ -136,5 +136,7 @@ itemPtr parseEntry(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 	/* after parsing we fill the infos into the itemPtr structure */
 	ctxt->item->readStatus = FALSE;
 
+	feed_parser_ctxt_finish_item (ctxt);
+
 	return ctxt->item;
 }
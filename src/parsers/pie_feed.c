@@ -172,8 +172,8 @@ static void pie_parse(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 			
 			/* check namespace of this tag */
 			if(cur->ns) {
-				if((cur->ns->href && (nsh = (NsHandler *)g_hash_table_lookup(ns_pie_ns_uri_table, (gpointer)cur->ns->href))) ||
-				   (cur->ns->prefix && (nsh = (NsHandler *)g_hash_table_lookup(pie_nstable, (gpointer)cur->ns->prefix)))) {
+				nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, pie_nstable, ns_pie_ns_uri_table);
+				if(nsh) {
 					pf = nsh->parseChannelTag;
 					if(pf)
 						(*pf)(ctxt, cur);
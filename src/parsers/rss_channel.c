@@ -58,6 +58,19 @@ GHashTable *RssToMetadataMapping = NULL;
 GHashTable	*rss_nstable = NULL;	/* duplicate storage: for quick finding... */
 GHashTable	*ns_rss_ns_uri_table = NULL;
 
+/* channel tags with special handling */
+enum {
+	RSS_CHANNEL_TAG_UNKNOWN = 0,
+	RSS_CHANNEL_TAG_PUBDATE,
+	RSS_CHANNEL_TAG_TTL,
+	RSS_CHANNEL_TAG_TITLE,
+	RSS_CHANNEL_TAG_LINK,
+	RSS_CHANNEL_TAG_DESCRIPTION
+};
+
+/* interned tag name -> tag id */
+static GHashTable *rssChannelTags = NULL;
+
 /* This function parses the metadata for the channel. This does not
    parse the items. The items are parsed elsewhere. */
 static void parseChannel(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
@@ -76,8 +89,8 @@ static void parseChannel(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 		
 		/* check namespace of this tag */
 		if(cur->ns) {
-			if((cur->ns->href && (nsh = (NsHandler *)g_hash_table_lookup(ns_rss_ns_uri_table, (gpointer)cur->ns->href))) ||
-			   (cur->ns->prefix && (nsh = (NsHandler *)g_hash_table_lookup(rss_nstable, (gpointer)cur->ns->prefix)))) {
+			nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, rss_nstable, ns_rss_ns_uri_table);
+			if(nsh) {
 				if(NULL != (pf = nsh->parseChannelTag))
 					(*pf)(ctxt, cur);
 				cur = cur->next;
@@ -93,40 +106,45 @@ static void parseChannel(feedParserCtxtPtr ctxt, xmlNodePtr cur) {
 				ctxt->subscription->metadata = metadata_list_append(ctxt->subscription->metadata, tmp2, tmp3);
 				g_free(tmp3);
 			}
-		}	
+			cur = cur->next;
+			continue;
+		}
+
 		/* check for specific tags */
-		else if(!xmlStrcmp(cur->name, BAD_CAST"pubDate")) {
+		switch(GPOINTER_TO_INT(g_hash_table_lookup(rssChannelTags, cur->name))) {
+		case RSS_CHANNEL_TAG_PUBDATE:
  			if(NULL != (tmp = (gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, 1))) {
 				ctxt->subscription->metadata = metadata_list_append(ctxt->subscription->metadata, "pubDate", tmp);
 				ctxt->feed->time = date_parse_RFC822 (tmp);
 				g_free(tmp);
 			}
-		} 
-		else if(!xmlStrcmp(cur->name, BAD_CAST"ttl")) {
+			break;
+		case RSS_CHANNEL_TAG_TTL:
  			if(NULL != (tmp = (gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE))) {
 				subscription_set_default_update_interval(ctxt->subscription, atoi(tmp));
 				g_free(tmp);
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"title")) {
+			break;
+		case RSS_CHANNEL_TAG_TITLE:
  			if(NULL != (tmp = unhtmlize((gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE)))) {
 				if(ctxt->title)
 					g_free(ctxt->title);
 				ctxt->title = tmp;
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"link")) {
+			break;
+		case RSS_CHANNEL_TAG_LINK:
  			if(NULL != (tmp = unhtmlize((gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE)))) {
 				subscription_set_homepage (ctxt->subscription, tmp);
 				g_free(tmp);
 			}
-		}
-		else if (!xmlStrcmp (cur->name, BAD_CAST"description")) {
+			break;
+		case RSS_CHANNEL_TAG_DESCRIPTION:
  			tmp = xhtml_extract (cur, 0, NULL);
 			if (tmp) {
 				metadata_list_set (&ctxt->subscription->metadata, "description", tmp);
 				g_free (tmp);
 			}
+			break;
 		}
 		
 		cur = cur->next;
@@ -331,6 +349,18 @@ rss_add_ns_handler (NsHandler *handler)
 	handler->registerNs (handler, rss_nstable, ns_rss_ns_uri_table);
 }
 
+static void
+rss_add_metadata_mapping (const gchar *name, const gchar *key)
+{
+	g_hash_table_insert (RssToMetadataMapping, (gpointer)xml_intern_name (name), (gpointer)key);
+}
+
+static void
+rss_add_channel_tag (const gchar *name, gint tag)
+{
+	g_hash_table_insert (rssChannelTags, (gpointer)xml_intern_name (name), GINT_TO_POINTER (tag));
+}
+
 feedHandlerPtr
 rss_init_feed_handler (void)
 {
@@ -342,18 +372,31 @@ rss_init_feed_handler (void)
 	   infos are shared with rss_item.c */
 	
 	if (!RssToMetadataMapping) {
-		RssToMetadataMapping = g_hash_table_new (g_str_hash, g_str_equal);
-		g_hash_table_insert (RssToMetadataMapping, "copyright", "copyright");
-		g_hash_table_insert (RssToMetadataMapping, "category", "category");
-		g_hash_table_insert (RssToMetadataMapping, "webMaster", "webmaster");
-		g_hash_table_insert (RssToMetadataMapping, "language", "language");
-		g_hash_table_insert (RssToMetadataMapping, "managingEditor", "managingEditor");
-		g_hash_table_insert (RssToMetadataMapping, "lastBuildDate", "contentUpdateDate");
-		g_hash_table_insert (RssToMetadataMapping, "generator", "feedgenerator");
-		g_hash_table_insert (RssToMetadataMapping, "publisher", "webmaster");
-		g_hash_table_insert (RssToMetadataMapping, "author", "author");
-		g_hash_table_insert (RssToMetadataMapping, "comments", "commentsUri");
+		/* Keyed by interned names, so that lookups with
+		   the node names can use pointer comparison */
+		RssToMetadataMapping = g_hash_table_new (g_direct_hash, g_direct_equal);
+		rss_add_metadata_mapping ("copyright", "copyright");
+		rss_add_metadata_mapping ("category", "category");
+		rss_add_metadata_mapping ("webMaster", "webmaster");
+		rss_add_metadata_mapping ("language", "language");
+		rss_add_metadata_mapping ("managingEditor", "managingEditor");
+		rss_add_metadata_mapping ("lastBuildDate", "contentUpdateDate");
+		rss_add_metadata_mapping ("generator", "feedgenerator");
+		rss_add_metadata_mapping ("publisher", "webmaster");
+		rss_add_metadata_mapping ("author", "author");
+		rss_add_metadata_mapping ("comments", "commentsUri");
 	}
+
+	if (!rssChannelTags) {
+		rssChannelTags = g_hash_table_new (g_direct_hash, g_direct_equal);
+		rss_add_channel_tag ("pubDate", RSS_CHANNEL_TAG_PUBDATE);
+		rss_add_channel_tag ("ttl", RSS_CHANNEL_TAG_TTL);
+		rss_add_channel_tag ("title", RSS_CHANNEL_TAG_TITLE);
+		rss_add_channel_tag ("link", RSS_CHANNEL_TAG_LINK);
+		rss_add_channel_tag ("description", RSS_CHANNEL_TAG_DESCRIPTION);
+	}
+
+	rss_item_init ();
 	
 	if (!rss_nstable) {
 		rss_nstable = g_hash_table_new (g_str_hash, g_str_equal);
@@ -36,6 +36,43 @@ extern GHashTable *RssToMetadataMapping;
 extern GHashTable	*rss_nstable;
 extern GHashTable	*ns_rss_ns_uri_table;
 
+/* item tags with special handling */
+enum {
+	RSS_ITEM_TAG_UNKNOWN = 0,
+	RSS_ITEM_TAG_PUBDATE,
+	RSS_ITEM_TAG_ENCLOSURE,
+	RSS_ITEM_TAG_GUID,
+	RSS_ITEM_TAG_TITLE,
+	RSS_ITEM_TAG_LINK,
+	RSS_ITEM_TAG_DESCRIPTION,
+	RSS_ITEM_TAG_SOURCE
+};
+
+/* interned tag name -> tag id */
+static GHashTable *rssItemTags = NULL;
+
+static void
+rss_item_add_tag (const gchar *name, gint tag)
+{
+	g_hash_table_insert (rssItemTags, (gpointer)xml_intern_name (name), GINT_TO_POINTER (tag));
+}
+
+void
+rss_item_init (void)
+{
+	if (rssItemTags)
+		return;
+
+	rssItemTags = g_hash_table_new (g_direct_hash, g_direct_equal);
+	rss_item_add_tag ("pubDate", RSS_ITEM_TAG_PUBDATE);
+	rss_item_add_tag ("enclosure", RSS_ITEM_TAG_ENCLOSURE);
+	rss_item_add_tag ("guid", RSS_ITEM_TAG_GUID);
+	rss_item_add_tag ("title", RSS_ITEM_TAG_TITLE);
+	rss_item_add_tag ("link", RSS_ITEM_TAG_LINK);
+	rss_item_add_tag ("description", RSS_ITEM_TAG_DESCRIPTION);
+	rss_item_add_tag ("source", RSS_ITEM_TAG_SOURCE);
+}
+
 /* method to parse standard tags for each item element */
 itemPtr
 parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
@@ -45,9 +82,9 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 	parseItemTagFunc	pf;
 	
 	g_assert(NULL != cur);
+	g_assert(NULL != rssItemTags);
 
-	ctxt->item = item_new ();
-	ctxt->item->tmpdata = g_hash_table_new_full (g_str_hash, g_str_equal, NULL, g_free);
+	feed_parser_ctxt_new_item (ctxt);
 	
 	/* try to get an item about id */
 	tmp = xml_get_attribute (cur, "about");
@@ -66,8 +103,8 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 		
 		/* check namespace of this tag */
 		if (cur->ns) {
-			if((cur->ns->href && (nsh = (NsHandler *)g_hash_table_lookup(ns_rss_ns_uri_table, (gpointer)cur->ns->href))) ||
-			   (cur->ns->prefix && (nsh = (NsHandler *)g_hash_table_lookup(rss_nstable, (gpointer)cur->ns->prefix)))) {
+			nsh = feed_parser_ctxt_get_ns_handler (ctxt, cur->ns, rss_nstable, ns_rss_ns_uri_table);
+			if (nsh) {
 				pf = nsh->parseItemTag;
 				if (pf)
 					(*pf)(ctxt, cur);
@@ -78,7 +115,8 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 			}
 		} /* explicitly no following else!!! */
 		
-		/* check for metadata tags */
+		/* check for metadata tags, names are interned so
+		   both tables can be looked up by pointer */
 		tmp2 = g_hash_table_lookup(RssToMetadataMapping, cur->name);
 		if (tmp2) {
 			tmp3 = (gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE);
@@ -86,16 +124,20 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 				ctxt->item->metadata = metadata_list_append(ctxt->item->metadata, tmp2, tmp3);
 				g_free(tmp3);
 			}
+			cur = cur->next;
+			continue;
 		}
+
 		/* check for specific tags */
-		else if(!xmlStrcmp(cur->name, BAD_CAST"pubDate")) {
+		switch (GPOINTER_TO_INT (g_hash_table_lookup (rssItemTags, cur->name))) {
+		case RSS_ITEM_TAG_PUBDATE:
  			tmp = (gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, 1);
 			if (tmp) {
 				ctxt->item->time = date_parse_RFC822 (tmp);
 				g_free(tmp);
 			}
-		} 
-		else if(!xmlStrcmp(cur->name, BAD_CAST"enclosure")) {
+			break;
+		case RSS_ITEM_TAG_ENCLOSURE:
 			/* RSS 0.93 allows multiple enclosures */
 			tmp = xml_get_attribute (cur, "url");
 			if (tmp) {
@@ -125,8 +167,8 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 				g_free (type);
 				g_free (lengthStr);
 			}
-		} 
-		else if(!xmlStrcmp(cur->name, BAD_CAST"guid")) {
+			break;
+		case RSS_ITEM_TAG_GUID:
 			if(!item_get_id(ctxt->item)) {
 				tmp = (gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, 1);
 				if (tmp) {
@@ -142,22 +184,22 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 					xmlFree(tmp);
 				}
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"title")) {
+			break;
+		case RSS_ITEM_TAG_TITLE:
  			tmp = unhtmlize((gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE));
 			if (tmp) {
 				item_set_title(ctxt->item, tmp);
 				g_free(tmp);
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"link")) {
+			break;
+		case RSS_ITEM_TAG_LINK:
  			tmp = unhtmlize((gchar *)xmlNodeListGetString(ctxt->doc, cur->xmlChildrenNode, TRUE));
 			if (tmp) {
 				item_set_source(ctxt->item, tmp);
 				g_free(tmp);
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"description")) {
+			break;
+		case RSS_ITEM_TAG_DESCRIPTION:
  			tmp = xhtml_extract (cur, 0, NULL);
 			if (tmp) {
 				/* don't overwrite content:encoded descriptions... */
@@ -165,8 +207,8 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 					item_set_description(ctxt->item, tmp);
 				g_free(tmp);
 			}
-		}
-		else if(!xmlStrcmp(cur->name, BAD_CAST"source")) {
+			break;
+		case RSS_ITEM_TAG_SOURCE:
 			tmp = xml_get_attribute (cur, "url");
 			if (tmp) {
 				metadata_list_set (&(ctxt->item->metadata), "realSourceUrl", g_strchomp (tmp));
@@ -177,6 +219,7 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 				metadata_list_set (&(ctxt->item->metadata), "realSourceTitle", g_strchomp (tmp));
 				g_free(tmp);
 			}
+			break;
 		}
 		
 		cur = cur->next;
@@ -184,8 +227,7 @@ parseRSSItem (feedParserCtxtPtr ctxt, xmlNodePtr cur)
 
 	ctxt->item->readStatus = FALSE;
 
-	g_hash_table_destroy(ctxt->item->tmpdata);
-	ctxt->item->tmpdata = NULL;
+	feed_parser_ctxt_finish_item (ctxt);
 	
 	return ctxt->item;
 }
@@ -24,6 +24,12 @@
 #include "item.h"
 #include "feed_parser.h"
 
+/**
+ * Sets up the item tag dispatch table. Must be called
+ * once before the first item is parsed.
+ */
+void rss_item_init (void);
+
 itemPtr parseRSSItem(feedParserCtxtPtr ctxt, xmlNodePtr cur);
 
 #endif
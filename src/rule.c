@@ -88,7 +88,9 @@ rule_check_item_title (rulePtr rule, itemPtr item)
 static gboolean
 rule_check_item_description (rulePtr rule, itemPtr item)
 {
-	return (NULL != item->description && NULL != g_strstr_len (item->description, -1, rule->value));
+	const gchar *description = item_get_description (item);
+
+	return (NULL != description && NULL != g_strstr_len (description, -1, rule->value));
 }
 
 static gboolean
@@ -118,13 +120,12 @@ rule_check_item_has_enc (rulePtr rule, itemPtr item)
 static gboolean
 rule_check_item_category (rulePtr rule, itemPtr item)
 {
-	GSList	*iter = metadata_list_get_values (item->metadata, "category");
+	GPtrArray	*categories = metadata_list_get_values (item_get_metadata (item), "category");
+	guint		i;
 
-	while (iter) {
-		if (g_str_equal (rule->value, (gchar *)iter->data))
+	for (i = 0; categories && i < categories->len; i++) {
+		if (g_str_equal (rule->value, (gchar *)g_ptr_array_index (categories, i)))
 			return TRUE;
-
-		iter = g_slist_next (iter);
 	}
 
 	return FALSE;
@@ -141,10 +142,42 @@ rule_check_feed_title (rulePtr rule, itemPtr item)
 	return (NULL != feedNode->title && NULL != g_strstr_len (feedNode->title, -1, rule->value));
 }
 
+/* rule conditions on item headers, for rules not needing descriptions or metadata */
+
+static gboolean
+rule_check_header_title (rulePtr rule, itemHeaderPtr header)
+{
+	return (NULL != header->title && NULL != g_strstr_len (header->title, -1, rule->value));
+}
+
+static gboolean
+rule_check_header_is_unread (rulePtr rule, itemHeaderPtr header)
+{
+	return !header->readStatus;
+}
+
+static gboolean
+rule_check_header_is_flagged (rulePtr rule, itemHeaderPtr header)
+{
+	return header->flagStatus;
+}
+
+static gboolean
+rule_check_header_feed_title (rulePtr rule, itemHeaderPtr header)
+{
+	nodePtr feedNode = node_from_id (header->parentNodeId);
+
+	if (!feedNode)
+		return FALSE;
+
+	return (NULL != feedNode->title && NULL != g_strstr_len (feedNode->title, -1, rule->value));
+}
+
 /* rule initialization */
 
 static void
 rule_info_add (ruleCheckFunc checkFunc,
+          ruleHeaderCheckFunc headerCheckFunc,
           const gchar *ruleId, 
           gchar *title,
           gchar *positive,
@@ -160,6 +193,7 @@ rule_info_add (ruleCheckFunc checkFunc,
 	ruleInfo->negative = negative;
 	ruleInfo->needsParameter = needsParameter;	
 	ruleInfo->checkFunc = checkFunc;
+	ruleInfo->headerCheckFunc = headerCheckFunc;
 	ruleFunctions = g_slist_append (ruleFunctions, ruleInfo);
 }
 
@@ -168,17 +202,17 @@ rule_init (void)
 {
 	debug_enter ("rule_init");
 
-	/*        SQL condition builder function	in-memory check function	feedlist.opml rule id           rule menu label         positive menu option    negative menu option    has param */ 
-	/*        ========================================================================================================================================================================================*/
+	/*        in-memory check function	header check function		feedlist.opml rule id           rule menu label         positive menu option    negative menu option    has param */ 
+	/*        ================================================================================================================================================================================================*/
 	
-	rule_info_add (rule_check_item_all,		ITEM_MATCH_RULE_ID,		_("Item"),		_("does contain"),	_("does not contain"),	TRUE);
-	rule_info_add (rule_check_item_title,		ITEM_TITLE_MATCH_RULE_ID,	_("Item title"),	_("does contain"),	_("does not contain"),	TRUE);
-	rule_info_add (rule_check_item_description,	ITEM_DESC_MATCH_RULE_ID,	_("Item body"),		_("does contain"),	_("does not contain"),	TRUE);
-	rule_info_add (rule_check_item_is_unread,	"unread",			_("Read status"),	_("is unread"),		_("is read"),		FALSE);
-	rule_info_add (rule_check_item_is_flagged,	"flagged",			_("Flag status"),	_("is flagged"),	_("is unflagged"),	FALSE);
-	rule_info_add (rule_check_item_has_enc,		"enclosure",			_("Podcast"),		_("included"),		_("not included"),	FALSE);
-	rule_info_add (rule_check_item_category,	"category",			_("Category"),		_("is set"),		_("is not set"),	TRUE);
-	rule_info_add (rule_check_feed_title,		FEED_TITLE_MATCH_RULE_ID,	_("Feed title"),	_("does contain"),	_("does not contain"),	TRUE);
+	rule_info_add (rule_check_item_all,		NULL,				ITEM_MATCH_RULE_ID,		_("Item"),		_("does contain"),	_("does not contain"),	TRUE);
+	rule_info_add (rule_check_item_title,		rule_check_header_title,	ITEM_TITLE_MATCH_RULE_ID,	_("Item title"),	_("does contain"),	_("does not contain"),	TRUE);
+	rule_info_add (rule_check_item_description,	NULL,				ITEM_DESC_MATCH_RULE_ID,	_("Item body"),		_("does contain"),	_("does not contain"),	TRUE);
+	rule_info_add (rule_check_item_is_unread,	rule_check_header_is_unread,	"unread",			_("Read status"),	_("is unread"),		_("is read"),		FALSE);
+	rule_info_add (rule_check_item_is_flagged,	rule_check_header_is_flagged,	"flagged",			_("Flag status"),	_("is flagged"),	_("is unflagged"),	FALSE);
+	rule_info_add (rule_check_item_has_enc,		NULL,				"enclosure",			_("Podcast"),		_("included"),		_("not included"),	FALSE);
+	rule_info_add (rule_check_item_category,	NULL,				"category",			_("Category"),		_("is set"),		_("is not set"),	TRUE);
+	rule_info_add (rule_check_feed_title,		rule_check_header_feed_title,	FEED_TITLE_MATCH_RULE_ID,	_("Feed title"),	_("does contain"),	_("does not contain"),	TRUE);
 
 	debug_exit ("rule_init");
 }
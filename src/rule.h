@@ -24,6 +24,7 @@
 #include <glib.h>
 
 #include "item.h"
+#include "item_header.h"
 
 /** rule info structure */
 typedef struct ruleInfo {
@@ -34,6 +35,7 @@ typedef struct ruleInfo {
 	gboolean	needsParameter;	/**< some rules may require no parameter... */
 	
 	gpointer	checkFunc;	/**< the item check function */
+	gpointer	headerCheckFunc;	/**< the item header check function (or NULL if the rule needs the full item) */
 } *ruleInfoPtr;
 
 /** structure to store a rule instance */
@@ -46,6 +48,9 @@ typedef struct rule {
 /** function type used to check items */
 typedef gboolean (*ruleCheckFunc)	(rulePtr rule, itemPtr item);
 
+/** function type used to check item headers */
+typedef gboolean (*ruleHeaderCheckFunc)	(rulePtr rule, itemHeaderPtr header);
+
 /**
  * Returns a list of rule infos. To be used for rule editor 
  * dialog setup.
@@ -40,6 +40,15 @@
 #define FEED_PROTOCOL_PREFIX "feed://"
 #define FEED_PROTOCOL_PREFIX2 "feed:"
 
+/* Scheduled updates are started in batches once per second, but
+   only while the update queue is not backed up. */
+#define SCHEDULED_UPDATE_BATCH		10
+
+static GQueue	*scheduledUpdates = NULL;	/**< node ids of subscriptions to update */
+static guint	scheduledUpdateTimer = 0;
+
+static subscriptionUpdatedFunc	updatedFunc = NULL;
+
 subscriptionPtr
 subscription_new (const gchar *source,
                   const gchar *filter,
@@ -140,6 +149,8 @@ subscription_favicon_downloaded (gpointer user_data)
 void
 subscription_update_favicon (subscriptionPtr subscription)
 {
+	subscription_load_metadata (subscription);
+
 	debug1 (DEBUG_UPDATE, "trying to download favicon.ico for \"%s\"", node_get_title (subscription->node));
 	liferea_shell_set_status_bar (_("Updating favicon for \"%s\""), node_get_title (subscription->node));
 	g_get_current_time (&subscription->updateState->lastFaviconPoll);
@@ -200,10 +211,15 @@ subscription_process_update_result (const struct updateResult * const result, gp
 	nodePtr		node = subscription->node;
 	gboolean	processing = FALSE;
 	GTimeVal	now;
+	gint64		start, downloadTime;
 
 	/* 1. preprocessing */
 
 	g_assert (subscription->updateJob);
+	start = g_get_monotonic_time ();
+	downloadTime = start - subscription->updateJob->startTime;
+	subscription_load_metadata (subscription);
+
 	/* update the subscription URL on permanent redirects */
 	if ((301 == result->httpstatus) && result->source && !g_str_equal (result->source, subscription->updateJob->request->source)) {
 		debug2 (DEBUG_UPDATE, "The URL of \"%s\" has changed permanently and was updated with \"%s\"", node_get_title(node), result->source);
@@ -255,6 +271,15 @@ subscription_process_update_result (const struct updateResult * const result, gp
 		feedlist_new_items (node->newCount);
 		feedlist_node_was_updated (node);
 	}
+
+	if (updatedFunc)
+		(*updatedFunc) (subscription, result, downloadTime, g_get_monotonic_time () - start);
+}
+
+void
+subscription_set_updated_func (subscriptionUpdatedFunc func)
+{
+	updatedFunc = func;
 }
 
 void
@@ -274,6 +299,8 @@ subscription_update (subscriptionPtr subscription, guint flags)
 	if (subscription_can_be_updated (subscription)) {
 		liferea_shell_set_status_bar (_("Updating \"%s\""), node_get_title (subscription->node));
 
+		subscription_load_metadata (subscription);
+
 		g_get_current_time (&now);
 		subscription_reset_update_counter (subscription, &now);
 
@@ -291,6 +318,43 @@ subscription_update (subscriptionPtr subscription, guint flags)
 	}
 }
 
+static gboolean
+subscription_scheduled_update_cb (gpointer user_data)
+{
+	guint	i, queued, active;
+
+	update_get_job_counts (&queued, &active);
+
+	for (i = queued; i < SCHEDULED_UPDATE_BATCH && !g_queue_is_empty (scheduledUpdates); i++) {
+		gchar	*id = g_queue_pop_head (scheduledUpdates);
+		nodePtr	node = node_from_id (id);
+
+		/* The node might have been removed in the meantime */
+		if (node && node->subscription)
+			subscription_update (node->subscription, 0);
+		g_free (id);
+	}
+
+	if (g_queue_is_empty (scheduledUpdates)) {
+		scheduledUpdateTimer = 0;
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+void
+subscription_schedule_update (subscriptionPtr subscription)
+{
+	if (!scheduledUpdates)
+		scheduledUpdates = g_queue_new ();
+
+	g_queue_push_tail (scheduledUpdates, g_strdup (subscription->node->id));
+
+	if (!scheduledUpdateTimer)
+		scheduledUpdateTimer = g_timeout_add_seconds (1, subscription_scheduled_update_cb, NULL);
+}
+
 void
 subscription_auto_update (subscriptionPtr subscription)
 {
@@ -504,6 +568,12 @@ subscription_import (xmlNodePtr xml, gboolean trusted)
 		if (tmp && !xmlStrcmp (tmp, BAD_CAST "true"))
 			subscription->updateOptions->dontUseProxy = TRUE;
 		xmlFree (tmp);
+
+		/* download size limit */
+		tmp = xmlGetProp (xml, BAD_CAST "maxSize");
+		if (tmp)
+			subscription->updateOptions->maxSize = MAX (0, common_parse_long (tmp, 0));
+		xmlFree (tmp);
 	
 		/* authentication options */
 		subscription->updateOptions->username = xmlGetProp (xml, BAD_CAST "username");
@@ -533,6 +603,12 @@ subscription_export (subscriptionPtr subscription, xmlNodePtr xml, gboolean trus
 
 		if (subscription->updateOptions->dontUseProxy)
 			xmlNewProp (xml, BAD_CAST"dontUseProxy", BAD_CAST"true");
+
+		if (subscription->updateOptions->maxSize) {
+			gchar *maxSize = g_strdup_printf ("%u", subscription->updateOptions->maxSize);
+			xmlNewProp (xml, BAD_CAST"maxSize", BAD_CAST maxSize);
+			g_free (maxSize);
+		}
 		
 		if (!liferea_auth_has_active_store ()) {
 			if (subscription->updateOptions->username)
@@ -573,9 +649,49 @@ subscription_to_xml (subscriptionPtr subscription, xmlNodePtr xml)
 	if (subscription->filterError)
 		xmlNewTextChild (xml, NULL, "filterError", subscription->filterError);
 
+	subscription_load_metadata (subscription);
 	metadata_add_xml_nodes (subscription->metadata, xml);
 }
 
+typedef struct metadataMerge {
+	subscriptionPtr	subscription;
+	const gchar	*lastKey;	/**< key of the previous value (interned) */
+} metadataMerge;
+
+static void
+subscription_metadata_merge_cb (const gchar *key, const gchar *value, guint index, gpointer user_data)
+{
+	metadataMerge	*merge = (metadataMerge *)user_data;
+
+	/* The values of a key are passed in a row: the first one
+	   replaces the loaded values, the others are appended */
+	if (key != merge->lastKey)
+		metadata_list_set (&merge->subscription->metadata, key, value);
+	else
+		merge->subscription->metadata = metadata_list_append_checked (merge->subscription->metadata, key, value);
+
+	merge->lastKey = key;
+}
+
+void
+subscription_load_metadata (subscriptionPtr subscription)
+{
+	GSList		*preset;
+	metadataMerge	merge = { subscription, NULL };
+
+	if (subscription->metadataLoaded)
+		return;
+
+	subscription->metadataLoaded = TRUE;
+
+	preset = subscription->metadata;
+	subscription->metadata = NULL;
+	db_subscription_load (subscription);
+
+	metadata_list_foreach (preset, subscription_metadata_merge_cb, &merge);
+	metadata_list_free (preset);
+}
+
 void
 subscription_free (subscriptionPtr subscription)
 {
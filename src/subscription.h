@@ -53,6 +53,7 @@ typedef struct subscription {
 	guint		defaultInterval;	/**< optional update interval as specified by the feed in minutes */
 	
 	GSList		*metadata;		/**< metadata list assigned to this subscription */
+	gboolean	metadataLoaded;		/**< TRUE if metadata was loaded from the DB (see subscription_load_metadata()) */
 	
 	gchar		*updateError;		/**< textual description of processing errors */
 	gchar		*httpError;		/**< textual description of HTTP protocol errors */
@@ -105,6 +106,16 @@ void subscription_export (subscriptionPtr subscription, xmlNodePtr xml, gboolean
  */
 void subscription_to_xml (subscriptionPtr subscription, xmlNodePtr xml);
 
+/**
+ * Loads the metadata of the given subscription from the DB if not
+ * yet done. To keep the startup fast, metadata is loaded only on the
+ * first update or rendering. Values set before loading (e.g. the
+ * homepage from the feed list OPML) take precedence over stored ones.
+ *
+ * @param subscription	the subscription
+ */
+void subscription_load_metadata (subscriptionPtr subscription);
+
 /**
  * Triggers updating a subscription. Will download the 
  * the document indicated by the source URL of the subscription.
@@ -116,6 +127,34 @@ void subscription_to_xml (subscriptionPtr subscription, xmlNodePtr xml);
  */
 void subscription_update (subscriptionPtr subscription, guint flags);
 
+/**
+ * Function type called after the result of a subscription update
+ * was processed.
+ *
+ * @param subscription		the subscription
+ * @param result		the update result
+ * @param downloadTime		time from starting the request until processing in microseconds
+ * @param processingTime	time of the result processing in microseconds
+ */
+typedef void (*subscriptionUpdatedFunc) (subscriptionPtr subscription, const struct updateResult * const result, gint64 downloadTime, gint64 processingTime);
+
+/**
+ * Sets a function to be called after every processed subscription
+ * update, e.g. to report the updates when running headless.
+ *
+ * @param func		the function (or NULL)
+ */
+void subscription_set_updated_func (subscriptionUpdatedFunc func);
+
+/**
+ * Schedules an update of the given subscription. Other than
+ * subscription_update() the update is started later to spread
+ * the updates of many new subscriptions (e.g. on import).
+ *
+ * @param subscription	the subscription
+ */
+void subscription_schedule_update (subscriptionPtr subscription);
+
 /**
  * Called when auto updating. Checks whether the subscription
  * needs to be updated (according to it's update interval) and
@@ -0,0 +1,267 @@
+/**
+ * @file bench_pipeline.c  Benchmark of feed parsing, merging and DB storage
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <glib.h>
+#include <glib/gstdio.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#ifdef __GLIBC__
+#include <malloc.h>
+#endif
+
+#include "db.h"
+#include "feed.h"
+#include "feed_parser.h"
+#include "item.h"
+#include "itemset.h"
+#include "node.h"
+#include "subscription.h"
+#include "xml.h"
+
+/* Runs every feed of the corpus through the same steps as a feed
+   update: parsing, merging into the item set and storing into the
+   DB. Each feed is processed twice, first into an empty item set
+   and then again to measure the duplicate detection of an update
+   without changes.
+
+   Usage: bench_pipeline [corpus directory]
+
+   The DB is created in a temporary profile directory that is
+   removed afterwards. Results are printed as one JSON object per
+   line, so that runs of different commits can be compared. */
+
+#define BENCH_MANY_ITEMS	2000		/* items of the synthetic large feed */
+#define BENCH_HUGE_ITEM_SIZE	(4*1024*1024)	/* content size of the synthetic single item feed */
+
+/* The pipeline is linked together with the rest of Liferea */
+void liferea_shutdown (void) { }
+
+static gsize
+bench_heap_in_use (void)
+{
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 33))
+	return mallinfo2 ().uordblks;
+#elif defined(__GLIBC__)
+	return (guint)mallinfo ().uordblks;
+#else
+	return 0;
+#endif
+}
+
+static glong
+bench_peak_rss (void)
+{
+	struct rusage	usage;
+
+	if (0 != getrusage (RUSAGE_SELF, &usage))
+		return 0;
+
+	return usage.ru_maxrss;		/* in kB on Linux */
+}
+
+static gchar *
+bench_synthetic_many_items (guint count)
+{
+	GString	*buffer;
+	guint	i;
+
+	buffer = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	                       "<rss version=\"2.0\" xmlns:dc=\"http://purl.org/dc/elements/1.1/\">\n"
+	                       "<channel><title>Synthetic feed</title><link>http://example.com/</link>\n");
+	for (i = 0; i < count; i++)
+		g_string_append_printf (buffer,
+		                        "<item><title>Item %u</title><link>http://example.com/%u</link>"
+		                        "<guid>synthetic-%u</guid><dc:creator>Author %u</dc:creator>"
+		                        "<pubDate>Sat, 15 Oct 2016 %02u:%02u:00 +0000</pubDate>"
+		                        "<description>&lt;p&gt;Description of item %u&lt;/p&gt;</description></item>\n",
+		                        i, i, i, i % 10, (i / 60) % 24, i % 60, i);
+	g_string_append (buffer, "</channel></rss>\n");
+
+	return g_string_free (buffer, FALSE);
+}
+
+static gchar *
+bench_synthetic_huge_item (gsize size)
+{
+	GString	*buffer;
+
+	buffer = g_string_new ("<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+	                       "<rss version=\"2.0\" xmlns:content=\"http://purl.org/rss/1.0/modules/content/\">\n"
+	                       "<channel><title>Synthetic huge item</title><link>http://example.com/</link>\n"
+	                       "<item><title>Huge item</title><guid>synthetic-huge</guid><content:encoded><![CDATA[");
+	while (buffer->len < size)
+		g_string_append (buffer, "<p>Lorem ipsum dolor sit amet, <a href=\"http://example.com/\">consectetur</a> adipiscing elit.</p>\n");
+	g_string_append (buffer, "]]></content:encoded></item></channel></rss>\n");
+
+	return g_string_free (buffer, FALSE);
+}
+
+static nodePtr
+bench_node_new (const gchar *name)
+{
+	subscriptionPtr	subscription;
+	feedPtr		feed;
+	nodePtr		node;
+
+	feed = feed_new ();
+	/* An explicit limit avoids reading the preferences and
+	   dropping items, which would need the item list UI */
+	feed->cacheLimit = CACHE_UNLIMITED;
+
+	node = node_new (feed_get_node_type ());
+	node_set_title (node, name);
+	node_set_data (node, feed);
+
+	subscription = subscription_new ("http://example.com/feed", NULL, NULL);
+	node_set_subscription (node, subscription);
+
+	return node;
+}
+
+static void
+bench_run_pass (nodePtr node, const gchar *name, const gchar *pass, const gchar *data, gsize length)
+{
+	feedParserCtxtPtr	ctxt;
+	itemSetPtr		itemSet;
+	gint64			start, parsed, merged;
+	gsize			heap;
+	guint			items, newCount = 0;
+
+	heap = bench_heap_in_use ();
+	start = g_get_monotonic_time ();
+
+	ctxt = feed_create_parser_ctxt ();
+	ctxt->subscription = node->subscription;
+	ctxt->feed = (feedPtr)node->data;
+	ctxt->data = (gchar *)data;
+	ctxt->dataLength = length;
+	feed_parse (ctxt);
+	items = g_list_length (ctxt->items);
+
+	parsed = g_get_monotonic_time ();
+
+	if (!ctxt->failed) {
+		itemSet = node_get_itemset (node);
+		newCount = itemset_merge_items (itemSet, ctxt->items, ctxt->feed->valid, FALSE);
+		itemset_free (itemSet);
+	}
+	feed_free_parser_ctxt (ctxt);
+
+	merged = g_get_monotonic_time ();
+
+	printf ("{\"corpus\": \"%s\", \"pass\": \"%s\", \"bytes\": %" G_GSIZE_FORMAT ", "
+	        "\"items\": %u, \"new_items\": %u, \"parse_ms\": %.3f, \"merge_ms\": %.3f, "
+	        "\"items_per_sec\": %.1f, \"heap_growth_bytes\": %" G_GSSIZE_FORMAT ", \"peak_rss_kb\": %ld}\n",
+	        name, pass, length, items, newCount,
+	        (parsed - start) / 1000.0, (merged - parsed) / 1000.0,
+	        (merged > start)?(items * (gdouble)G_USEC_PER_SEC / (merged - start)):0.0,
+	        (gssize)(bench_heap_in_use () - heap), bench_peak_rss ());
+	fflush (stdout);
+}
+
+static void
+bench_run (const gchar *name, const gchar *data, gsize length)
+{
+	nodePtr	node = bench_node_new (name);
+
+	bench_run_pass (node, name, "initial", data, length);
+	bench_run_pass (node, name, "update", data, length);
+}
+
+static void
+bench_remove_dir (const gchar *path)
+{
+	const gchar	*filename;
+	GDir		*dir;
+
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		while ((filename = g_dir_read_name (dir))) {
+			gchar *child = g_build_filename (path, filename, NULL);
+
+			if (g_file_test (child, G_FILE_TEST_IS_DIR))
+				bench_remove_dir (child);
+			else
+				g_unlink (child);
+			g_free (child);
+		}
+		g_dir_close (dir);
+	}
+	g_rmdir (path);
+}
+
+int
+main (int argc, char *argv[])
+{
+	const gchar	*dirname, *filename;
+	gchar		*profile, *data;
+	gsize		length;
+	gint64		start;
+	GDir		*dir;
+
+	dirname = (argc > 1)?argv[1]:TEST_DATA_DIR "/feeds";
+
+	/* Must happen before GLib caches the user directories */
+	profile = g_build_filename (g_get_tmp_dir (), "liferea-bench-XXXXXX", NULL);
+	if (!mkdtemp (profile))
+		g_error ("Could not create temporary profile directory \"%s\"!", profile);
+	g_setenv ("XDG_CACHE_HOME", profile, TRUE);
+	g_setenv ("XDG_CONFIG_HOME", profile, TRUE);
+	g_setenv ("XDG_DATA_HOME", profile, TRUE);
+
+	xml_init ();
+	db_init ();
+
+	start = g_get_monotonic_time ();
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir)
+		g_error ("Could not open corpus directory \"%s\"!", dirname);
+
+	while ((filename = g_dir_read_name (dir))) {
+		gchar *path = g_build_filename (dirname, filename, NULL);
+
+		if (g_file_get_contents (path, &data, &length, NULL)) {
+			bench_run (filename, data, length);
+			g_free (data);
+		}
+		g_free (path);
+	}
+	g_dir_close (dir);
+
+	data = bench_synthetic_many_items (BENCH_MANY_ITEMS);
+	bench_run ("synthetic-many-items", data, strlen (data));
+	g_free (data);
+
+	data = bench_synthetic_huge_item (BENCH_HUGE_ITEM_SIZE);
+	bench_run ("synthetic-huge-item", data, strlen (data));
+	g_free (data);
+
+	printf ("{\"corpus\": \"total\", \"seconds\": %.3f, \"peak_rss_kb\": %ld}\n",
+	        (g_get_monotonic_time () - start) / (gdouble)G_USEC_PER_SEC, bench_peak_rss ());
+
+	db_deinit ();
+	bench_remove_dir (profile);
+	g_free (profile);
+
+	return 0;
+}
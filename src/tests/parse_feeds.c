@@ -0,0 +1,224 @@
+/**
+ * @file parse_feeds.c  Test cases and benchmark for the feed parsers
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "feed.h"
+#include "feed_parser.h"
+#include "item.h"
+#include "metadata.h"
+#include "node.h"
+#include "subscription.h"
+#include "xml.h"
+
+/* Run the benchmark with "parse_feeds -m perf". The corpus
+   directory can be overridden by setting LIFEREA_FEED_CORPUS. */
+
+#define BENCHMARK_ROUNDS	50
+
+/* The parsers are linked together with the rest of Liferea */
+void liferea_shutdown (void) { }
+
+typedef struct tc {
+	gchar	*filename;
+	gchar	*title;
+	guint	items;
+	guint	enclosures;
+	gchar	*metadata;	/**< metadata every item must have */
+} *tcPtr;
+
+struct tc tc_rss20	= { "rss20.xml",	"Example Planet",	40, 8,  "commentFeedUri" };
+struct tc tc_rss10	= { "rss10.rdf",	"Example News",		30, 0,  "slash" };
+struct tc tc_atom10	= { "atom10.xml",	"Example Blog",		40, 10, "author" };
+
+static subscriptionPtr
+parse_feeds_subscription_new (void)
+{
+	subscriptionPtr	subscription;
+	nodePtr		node;
+
+	node = node_new (feed_get_node_type ());
+	node_set_title (node, "test");
+	node_set_data (node, feed_new ());
+
+	subscription = subscription_new ("http://example.com/feed", NULL, NULL);
+	node_set_subscription (node, subscription);
+
+	return subscription;
+}
+
+/* Parses the given feed and returns the list of new items */
+static GList *
+parse_feeds_parse (subscriptionPtr subscription, gchar *data, gsize length, gchar **title)
+{
+	feedParserCtxtPtr	ctxt;
+	GList			*items;
+	gboolean		success;
+
+	ctxt = feed_create_parser_ctxt ();
+	ctxt->subscription = subscription;
+	ctxt->feed = (feedPtr)subscription->node->data;
+	ctxt->data = data;
+	ctxt->dataLength = length;
+
+	success = feed_parse (ctxt);
+	g_assert (success);
+
+	items = ctxt->items;
+	if (title)
+		*title = g_strdup (ctxt->title);
+	feed_free_parser_ctxt (ctxt);
+
+	return items;
+}
+
+static void
+tc_parse (gconstpointer user_data)
+{
+	tcPtr		tc = (tcPtr)user_data;
+	subscriptionPtr	subscription;
+	GList		*items, *iter;
+	gchar		*filename, *data, *title;
+	gsize		length;
+	guint		enclosures = 0;
+	gboolean	success;
+
+	filename = g_build_filename (TEST_DATA_DIR, "feeds", tc->filename, NULL);
+	success = g_file_get_contents (filename, &data, &length, NULL);
+	g_assert (success);
+
+	subscription = parse_feeds_subscription_new ();
+	items = parse_feeds_parse (subscription, data, length, &title);
+
+	g_assert_cmpstr (title, ==, tc->title);
+	g_assert_cmpuint (g_list_length (items), ==, tc->items);
+
+	for (iter = items; iter; iter = g_list_next (iter)) {
+		itemPtr item = (itemPtr)iter->data;
+
+		/* per item scratch data must be detached after parsing */
+		g_assert (NULL == item->tmpdata);
+		g_assert (NULL != item_get_title (item));
+		g_assert (NULL != metadata_list_get (item->metadata, tc->metadata));
+		if (item->hasEnclosure)
+			enclosures++;
+		item_unload (item);
+	}
+	g_assert_cmpuint (enclosures, ==, tc->enclosures);
+
+	g_list_free (items);
+	g_free (title);
+	g_free (data);
+	g_free (filename);
+}
+
+static GSList *
+benchmark_load_corpus (gsize *size)
+{
+	const gchar	*dirname, *filename;
+	GSList		*corpus = NULL;
+	GDir		*dir;
+
+	dirname = g_getenv ("LIFEREA_FEED_CORPUS");
+	if (!dirname)
+		dirname = TEST_DATA_DIR "/feeds";
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir)
+		return NULL;
+
+	*size = 0;
+	while ((filename = g_dir_read_name (dir))) {
+		gchar	*path = g_build_filename (dirname, filename, NULL);
+		gchar	*content;
+		gsize	length;
+
+		if (g_file_get_contents (path, &content, &length, NULL)) {
+			corpus = g_slist_prepend (corpus, content);
+			*size += length;
+		}
+		g_free (path);
+	}
+	g_dir_close (dir);
+
+	return corpus;
+}
+
+static void
+tc_benchmark (void)
+{
+	subscriptionPtr	subscription;
+	GSList		*corpus, *iter;
+	GTimer		*timer;
+	gsize		size = 0;
+	guint		i, items = 0;
+
+	corpus = benchmark_load_corpus (&size);
+	if (!corpus) {
+		g_test_message ("no benchmark corpus found");
+		return;
+	}
+
+	subscription = parse_feeds_subscription_new ();
+
+	timer = g_timer_new ();
+	for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+		for (iter = corpus; iter; iter = g_slist_next (iter)) {
+			gchar	*content = (gchar *)iter->data;
+			GList	*list, *item;
+
+			list = parse_feeds_parse (subscription, content, strlen (content), NULL);
+			for (item = list; item; item = g_list_next (item)) {
+				item_unload ((itemPtr)item->data);
+				items++;
+			}
+			g_list_free (list);
+		}
+	}
+	g_timer_stop (timer);
+
+	g_test_minimized_result (g_timer_elapsed (timer, NULL),
+	                         "parsed %u feeds (%" G_GSIZE_FORMAT " bytes, %u items) %u times in %.3fs, %.1f MB/s, %.0f items/s",
+	                         g_slist_length (corpus), size, items / BENCHMARK_ROUNDS, BENCHMARK_ROUNDS,
+	                         g_timer_elapsed (timer, NULL),
+	                         (size * BENCHMARK_ROUNDS) / g_timer_elapsed (timer, NULL) / (1024 * 1024),
+	                         items / g_timer_elapsed (timer, NULL));
+
+	g_timer_destroy (timer);
+	g_slist_free_full (corpus, g_free);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	xml_init ();
+
+	g_test_add_data_func ("/parse_feeds/rss20",	&tc_rss20,	&tc_parse);
+	g_test_add_data_func ("/parse_feeds/rss10",	&tc_rss10,	&tc_parse);
+	g_test_add_data_func ("/parse_feeds/atom10",	&tc_atom10,	&tc_parse);
+
+	if (g_test_perf ())
+		g_test_add_func ("/parse_feeds/benchmark", &tc_benchmark);
+
+	return g_test_run();
+}
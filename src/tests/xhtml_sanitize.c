@@ -0,0 +1,164 @@
+/**
+ * @file xhtml_sanitize.c  Test cases and benchmark for HTML sanitizing
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include <glib.h>
+#include <string.h>
+
+#include "xml.h"
+
+/* Run the benchmark with "xhtml_sanitize -m perf". The corpus
+   directory can be overridden by setting LIFEREA_SANITIZE_CORPUS. */
+
+#define BENCHMARK_ROUNDS	200
+
+typedef struct tc {
+	gchar	*html;
+	gchar	*expected;
+} *tcPtr;
+
+struct tc tc_plain		= { "Just text & entities &amp; more", "Just text & entities &amp; more" };
+struct tc tc_markup		= { "<p class=\"x\">Some <b>bold</b> text<br/></p>", "<p class=\"x\">Some <b>bold</b> text<br/></p>" };
+struct tc tc_script		= { "a<script>alert('x');</script>b", "ab" };
+struct tc tc_script_attr	= { "a<SCRIPT type=\"text/javascript\" src=\"x.js\"></SCRIPT >b", "ab" };
+struct tc tc_script_unclosed	= { "a<script>alert('x');", "a" };
+struct tc tc_script_in_string	= { "a<script>document.write('<p>');</script>b", "ab" };
+struct tc tc_iframe		= { "<p>a<iframe src=\"http://example.com\" width=\"5\">fallback</iframe>b</p>", "<p>ab</p>" };
+struct tc tc_meta		= { "a<meta http-equiv=\"refresh\" content=\"0\">b", "ab" };
+struct tc tc_onload		= { "<img src=\"x.png\" onload=\"evil()\" alt='y'>", "<img src=\"x.png\" alt='y'>" };
+struct tc tc_onclick		= { "<a href=\"#\" ONCLICK='evil(\"a>b\")'>x</a>", "<a href=\"#\">x</a>" };
+struct tc tc_unquoted		= { "<div onmouseover=evil() id=x>y</div>", "<div id=x>y</div>" };
+struct tc tc_unknown_handler	= { "<div onbeforematch=\"evil()\" onfutureevent='evil()' id=x>y</div>", "<div id=x>y</div>" };
+struct tc tc_comment		= { "a<!-- <script>x</script> -->b", "a<!-- <script>x</script> -->b" };
+struct tc tc_less_than		= { "if a < b and c<d", "if a < b and c<d" };
+struct tc tc_wbr		= { "long<wbr>word<WBR/>", "longword" };
+struct tc tc_body		= { "<body class=\"x\"><p>a</p></body>", "<p>a</p>" };
+
+static void
+tc_sanitize (gconstpointer user_data)
+{
+	tcPtr	tc = (tcPtr)user_data;
+	gchar	*result;
+
+	result = xhtml_sanitize (tc->html);
+	g_assert_cmpstr (result, ==, tc->expected);
+	g_free (result);
+}
+
+static void
+tc_strip_dhtml_keeps_body (void)
+{
+	gchar	*result;
+
+	result = xhtml_strip_dhtml ("<body><wbr>a<script>x</script></body>");
+	g_assert_cmpstr (result, ==, "<body><wbr>a</body>");
+	g_free (result);
+}
+
+static GSList *
+benchmark_load_corpus (gsize *size)
+{
+	const gchar	*dirname, *filename;
+	GSList		*corpus = NULL;
+	GDir		*dir;
+
+	dirname = g_getenv ("LIFEREA_SANITIZE_CORPUS");
+	if (!dirname)
+		dirname = TEST_DATA_DIR "/item_bodies";
+
+	dir = g_dir_open (dirname, 0, NULL);
+	if (!dir)
+		return NULL;
+
+	*size = 0;
+	while ((filename = g_dir_read_name (dir))) {
+		gchar	*path = g_build_filename (dirname, filename, NULL);
+		gchar	*content;
+		gsize	length;
+
+		if (g_file_get_contents (path, &content, &length, NULL)) {
+			corpus = g_slist_prepend (corpus, content);
+			*size += length;
+		}
+		g_free (path);
+	}
+	g_dir_close (dir);
+
+	return corpus;
+}
+
+static void
+tc_benchmark (void)
+{
+	GSList	*corpus, *iter;
+	GTimer	*timer;
+	gsize	size = 0;
+	guint	i;
+
+	corpus = benchmark_load_corpus (&size);
+	if (!corpus) {
+		g_test_message ("no benchmark corpus found");
+		return;
+	}
+
+	timer = g_timer_new ();
+	for (i = 0; i < BENCHMARK_ROUNDS; i++) {
+		for (iter = corpus; iter; iter = g_slist_next (iter))
+			g_free (xhtml_sanitize ((gchar *)iter->data));
+	}
+	g_timer_stop (timer);
+
+	g_test_minimized_result (g_timer_elapsed (timer, NULL),
+	                         "sanitized %u documents (%" G_GSIZE_FORMAT " bytes) %u times in %.3fs, %.1f MB/s",
+	                         g_slist_length (corpus), size, BENCHMARK_ROUNDS,
+	                         g_timer_elapsed (timer, NULL),
+	                         (size * BENCHMARK_ROUNDS) / g_timer_elapsed (timer, NULL) / (1024 * 1024));
+
+	g_timer_destroy (timer);
+	g_slist_free_full (corpus, g_free);
+}
+
+int
+main (int argc, char *argv[])
+{
+	g_test_init (&argc, &argv, NULL);
+
+	g_test_add_data_func ("/xhtml_sanitize/plain",		&tc_plain,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/markup",		&tc_markup,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/script",		&tc_script,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/script_attr",	&tc_script_attr,	&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/script_unclosed",	&tc_script_unclosed,	&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/script_in_string",	&tc_script_in_string,	&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/iframe",		&tc_iframe,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/meta",		&tc_meta,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/onload",		&tc_onload,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/onclick",	&tc_onclick,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/unquoted",	&tc_unquoted,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/unknown_handler",	&tc_unknown_handler,	&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/comment",	&tc_comment,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/less_than",	&tc_less_than,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/wbr",		&tc_wbr,		&tc_sanitize);
+	g_test_add_data_func ("/xhtml_sanitize/body",		&tc_body,		&tc_sanitize);
+	g_test_add_func ("/xhtml_sanitize/strip_dhtml_keeps_body", &tc_strip_dhtml_keeps_body);
+
+	if (g_test_perf ())
+		g_test_add_func ("/xhtml_sanitize/benchmark", &tc_benchmark);
+
+	return g_test_run();
+}
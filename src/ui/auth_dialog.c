@@ -25,6 +25,7 @@
 #include "common.h"
 #include "debug.h"
 #include "ui/liferea_dialog.h"
+#include "ui/liferea_shell.h"
 
 #define AUTH_DIALOG_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE ((object), AUTH_DIALOG_TYPE, AuthDialogPrivate))
 
@@ -149,6 +150,10 @@ auth_dialog_new (subscriptionPtr subscription, gint flags)
 {
 	AuthDialog *ad;
 	
+	/* Nobody to ask when running headless */
+	if (!liferea_shell_get_window ())
+		return NULL;
+
 	if (subscription->activeAuth) {
 		debug0 (DEBUG_UPDATE, "Missing/wrong authentication. Skipping, as a dialog is already active.");
 		return NULL;
@@ -242,7 +242,8 @@ void
 enclosure_list_view_load (EnclosureListView *elv, itemPtr item)
 {
 	GSList		*list, *filteredList;
-	guint		len;
+	GPtrArray	*values;
+	guint		len, i;
 
 	/* Ugly workaround to prevent race on startup when item is selected
 	   but enclosure list view not yet initialized. */
@@ -261,9 +262,10 @@ enclosure_list_view_load (EnclosureListView *elv, itemPtr item)
 	
 	/* load list into tree view */
 	filteredList = NULL;
-	list = metadata_list_get_values (item->metadata, "enclosure");
-	while (list) {
-		enclosurePtr enclosure = enclosure_from_string (list->data);
+	values = metadata_list_get_values (item_get_metadata (item), "enclosure");
+	for (i = 0; values && i < values->len; i++) {
+		gchar *value = g_ptr_array_index (values, i);
+		enclosurePtr enclosure = enclosure_from_string (value);
 		if (enclosure) {
 			// Filter unwanted MIME types (we only want audio/* and video/*)
 			if (enclosure->mime &&
@@ -301,16 +303,14 @@ enclosure_list_view_load (EnclosureListView *elv, itemPtr item)
 					            ES_DOWNLOADED, enclosure->downloaded,
 						    ES_SIZE, enclosure->size,
 						    ES_SIZE_STR, sizeStr,
-						    ES_SERIALIZED, list->data,
+						    ES_SERIALIZED, value,
 						    -1);
 				g_free (sizeStr);
 
 				elv->priv->enclosures = g_slist_append (elv->priv->enclosures, enclosure);
-				filteredList = g_slist_append (filteredList, list->data);
+				filteredList = g_slist_append (filteredList, value);
 			}
 		}
-		
-		list = g_slist_next (list);
 	}
 
 	/* decide visibility of the list */
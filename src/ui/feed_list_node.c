@@ -36,6 +36,14 @@
 static GHashTable	*flIterHash = NULL;	/**< hash table used for fast node id <-> tree iter lookup */
 static GtkWidget	*nodenamedialog = NULL;
 
+/* Row updates are not done immediately but collected and done at
+   once before the next redraw. This way a node and its parent folders
+   are updated only once even if many items of a subtree change. */
+static GHashTable	*dirtyNodes = NULL;	/**< ids of nodes whose row needs an update */
+static guint		dirtyFlushId = 0;	/**< idle source id of the row update */
+static gulong		rowUpdates = 0;		/**< row updates done */
+static gulong		rowUpdatesSaved = 0;	/**< row updates saved by coalescing */
+
 GtkTreeIter *
 feed_list_node_to_iter (const gchar *nodeId)
 {
@@ -75,6 +83,12 @@ feed_list_node_is_expanded (const gchar *nodeId)
 	GtkTreeIter	*iter;
 	gboolean 	expanded = FALSE;
 	
+	/* Keep the loaded state when running headless */
+	if (!feedstore) {
+		nodePtr node = node_from_id (nodeId);
+		return node && node->expanded;
+	}
+
 	if (feedlist_reduced_unread)
 		return FALSE;
 
@@ -191,6 +205,9 @@ feed_list_node_add (nodePtr node)
 	gint		position;
 	GtkTreeIter	*iter, *parentIter = NULL;
 
+	if (!feedstore)
+		return;	/* running headless */
+
 	debug2 (DEBUG_GUI, "adding node \"%s\" as child of parent=\"%s\"", node_get_title(node), (NULL != node->parent)?node_get_title(node->parent):"feed list root");
 
 	g_assert (NULL != node->parent);
@@ -279,8 +296,8 @@ feed_list_node_remove_node (nodePtr node)
 	}
 }
 
-void
-feed_list_node_update (const gchar *nodeId)
+static void
+feed_list_node_update_row (const gchar *nodeId)
 {
 	GtkTreeIter	*iter;
 	gchar		*label, *count = NULL;
@@ -291,7 +308,7 @@ feed_list_node_update (const gchar *nodeId)
 
 	node = node_from_id (nodeId);
 	iter = feed_list_node_to_iter (nodeId);
-	if (!iter)
+	if (!node || !iter)
 		return;
 
 	/* Initialize unread item color Pango CSS */
@@ -346,8 +363,62 @@ feed_list_node_update (const gchar *nodeId)
 	g_free (label);
 	g_free (count);
 
-	if (node->parent)
-		feed_list_node_update (node->parent->id);
+	rowUpdates++;
+}
+
+static gboolean
+feed_list_node_flush_updates (gpointer user_data)
+{
+	GHashTable	*nodes = dirtyNodes;
+	GHashTableIter	iter;
+	gpointer	nodeId;
+
+	dirtyFlushId = 0;
+	dirtyNodes = NULL;
+
+	debug3 (DEBUG_GUI, "updating %u feed list rows (%lu updates done, %lu saved so far)", g_hash_table_size (nodes), rowUpdates, rowUpdatesSaved);
+
+	g_hash_table_iter_init (&iter, nodes);
+	while (g_hash_table_iter_next (&iter, &nodeId, NULL))
+		feed_list_node_update_row ((const gchar *)nodeId);
+
+	g_hash_table_destroy (nodes);
+
+	return FALSE;
+}
+
+void
+feed_list_node_update (const gchar *nodeId)
+{
+	nodePtr	node;
+
+	if (!feedstore)
+		return;	/* running headless */
+
+	if (!dirtyNodes)
+		dirtyNodes = g_hash_table_new_full (g_str_hash, g_str_equal, g_free, NULL);
+
+	if (!dirtyFlushId)
+		dirtyFlushId = g_idle_add_full (G_PRIORITY_HIGH_IDLE, feed_list_node_flush_updates, NULL, NULL);
+
+	/* Each parent folder shows the sum of its children,
+	   so it needs an update too. Once a dirty parent is
+	   found all further parents are already dirty. */
+	for (node = node_from_id (nodeId); node; node = node->parent) {
+		if (g_hash_table_contains (dirtyNodes, node->id)) {
+			for (; node; node = node->parent)
+				rowUpdatesSaved++;
+			return;
+		}
+		g_hash_table_add (dirtyNodes, g_strdup (node->id));
+	}
+}
+
+void
+feed_list_node_get_update_counts (gulong *updates, gulong *saved)
+{
+	*updates = rowUpdates;
+	*saved = rowUpdatesSaved;
 }
 
 /* node renaming dialog */
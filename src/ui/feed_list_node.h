@@ -91,12 +91,23 @@ gboolean feed_list_node_is_expanded (const gchar *nodeId);
 void feed_list_node_set_expansion (nodePtr folder, gboolean expanded);
 
 /**
- * Updates the tree view entry of the given node.
+ * Updates the tree view entry of the given node and its parent
+ * folders. The update is done before the next redraw, multiple
+ * updates of the same node until then are done only once.
  *
  * @param nodeId	the node id
  */
 void feed_list_node_update (const gchar *nodeId);
 
+/**
+ * Returns the number of tree view entry updates done and
+ * the number of updates saved by merging multiple updates.
+ *
+ * @param updates	returns the number of updates done
+ * @param saved		returns the number of updates saved
+ */
+void feed_list_node_get_update_counts (gulong *updates, gulong *saved);
+
 /**
  * Open dialog to rename a given node.
  *
@@ -231,6 +231,32 @@ feed_list_view_sort_folder (nodePtr folder)
 	feedlist_schedule_save ();
 }
 
+void
+feed_list_view_add_nodes (GSList *nodes)
+{
+	GtkTreeView	*treeview;
+
+	if (!feedstore)
+		return;	/* running headless */
+
+	treeview = GTK_TREE_VIEW (liferea_shell_lookup ("feedlist"));
+	/* Unset the model from the view while inserting, so that
+	   the view doesn't process every single new row. */
+	gtk_tree_view_set_model (treeview, NULL);
+	for (; nodes; nodes = g_slist_next (nodes)) {
+		nodePtr node = (nodePtr)nodes->data;
+		if (!feed_list_node_to_iter (node->id))
+			feed_list_node_add (node);
+	}
+
+	/* During startup there is no root node yet and the
+	   folder expansion is restored by the feed list later. */
+	if (feedlist_get_root ())
+		feed_list_view_reduce_mode_changed ();
+	else
+		gtk_tree_view_set_model (treeview, feedlist_reduced_unread?GTK_TREE_MODEL (filter):GTK_TREE_MODEL (feedstore));
+}
+
 /* sets up the entry list store and connects it to the entry list
    view in the main window */
 void
@@ -59,6 +59,14 @@ void feed_list_view_init (GtkTreeView *treeview);
  */
 void feed_list_view_sort_folder (nodePtr folder);
 
+/**
+ * Adds the given nodes to the feed list at once. Used
+ * for bulk imports. Parents must precede their children.
+ *
+ * @param nodes	list of nodes
+ */
+void feed_list_view_add_nodes (GSList *nodes);
+
 void on_menu_delete (GtkWidget *widget, gpointer user_data);
 
 void on_menu_update (void);
@@ -25,6 +25,7 @@
 #endif
 
 #include "common.h"
+#include "ui/liferea_shell.h"
 
 static GdkPixbuf *icons[MAX_ICONS];	/**< list of icon assignments */
 
@@ -140,7 +141,8 @@ icons_load (void)
 const GdkPixbuf *
 icon_get (lifereaIcon icon)
 {
-	g_assert (NULL != *icons);		
+	/* Icons are not loaded when running headless */
+	g_assert (NULL != *icons || NULL == liferea_shell_get_window ());
 
 	return icons[icon];
 }
@@ -56,7 +56,7 @@ void icons_load (void);
  *
  * @param icon	the icon
  *
- * Returns: (transfer none): GdkPixbuf
+ * Returns: (transfer none): GdkPixbuf, NULL when running without user interface
  */
 const GdkPixbuf * icon_get (lifereaIcon icon);
 
@@ -0,0 +1,925 @@
+/**
+ * @file item_list_model.c  lazy loading GtkTreeModel for the item list
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ui/item_list_model.h"
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+
+#include <string.h>
+
+#include "common.h"
+#include "date.h"
+#include "db.h"
+#include "debug.h"
+#include "item_header.h"
+#include "node.h"
+#include "ui/icons.h"
+
+/* Number of rows whose title is fetched from the DB at once */
+#define ITEM_LIST_MODEL_PAGE_SIZE	64
+
+/* Maximum number of rows kept in the row cache */
+#define ITEM_LIST_MODEL_CACHE_SIZE	1024
+
+/* Compact per-row data, everything needed for sorting and icons */
+typedef struct itemListRow {
+	gulong		id;
+	gint64		time;
+	nodePtr		node;
+	guint		readStatus:1;
+	guint		flagStatus:1;
+	guint		hasEnclosure:1;
+} itemListRow;
+
+/* Lazily fetched and formatted row data */
+typedef struct itemListRowCache {
+	gchar		*title;		/**< raw title as found in the DB */
+	gchar		*label;		/**< formatted (markup) label */
+	gchar		*timeStr;	/**< formatted date */
+	gfloat		align;		/**< title alignment */
+} *itemListRowCachePtr;
+
+#define ITEM_LIST_MODEL_GET_PRIVATE(object)(G_TYPE_INSTANCE_GET_PRIVATE ((object), ITEM_LIST_MODEL_TYPE, ItemListModelPrivate))
+
+struct ItemListModelPrivate {
+	GArray		*rows;		/**< array of itemListRow */
+	GHashTable	*idToIndex;	/**< item id -> row index + 1 */
+	gboolean	indexValid;	/**< FALSE if idToIndex needs to be rebuilt */
+	GHashTable	*cache;		/**< item id -> itemListRowCachePtr */
+
+	gint		stamp;		/**< iter stamp, changes on every structural change */
+	gint		sortColumn;
+	GtkSortType	sortOrder;
+	gboolean	sorted;		/**< FALSE if rows were appended unsorted */
+
+	gboolean	wide;		/**< TRUE if date is to be rendered into the label */
+};
+
+static void item_list_model_tree_model_init (GtkTreeModelIface *iface);
+static void item_list_model_tree_sortable_init (GtkTreeSortableIface *iface);
+
+static GObjectClass *parent_class = NULL;
+
+G_DEFINE_TYPE_WITH_CODE (ItemListModel, item_list_model, G_TYPE_OBJECT,
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_MODEL, item_list_model_tree_model_init)
+                         G_IMPLEMENT_INTERFACE (GTK_TYPE_TREE_SORTABLE, item_list_model_tree_sortable_init));
+
+static void
+item_list_model_row_cache_free (gpointer data)
+{
+	itemListRowCachePtr	rc = (itemListRowCachePtr)data;
+
+	g_free (rc->title);
+	g_free (rc->label);
+	g_free (rc->timeStr);
+	g_free (rc);
+}
+
+static void
+item_list_model_finalize (GObject *object)
+{
+	ItemListModelPrivate *priv = ITEM_LIST_MODEL_GET_PRIVATE (object);
+
+	g_array_free (priv->rows, TRUE);
+	g_hash_table_destroy (priv->idToIndex);
+	g_hash_table_destroy (priv->cache);
+
+	G_OBJECT_CLASS (parent_class)->finalize (object);
+}
+
+static void
+item_list_model_class_init (ItemListModelClass *klass)
+{
+	GObjectClass *object_class = G_OBJECT_CLASS (klass);
+
+	parent_class = g_type_class_peek_parent (klass);
+
+	object_class->finalize = item_list_model_finalize;
+
+	g_type_class_add_private (object_class, sizeof(ItemListModelPrivate));
+}
+
+static void
+item_list_model_init (ItemListModel *ilm)
+{
+	ilm->priv = ITEM_LIST_MODEL_GET_PRIVATE (ilm);
+	ilm->priv->rows = g_array_new (FALSE, FALSE, sizeof (itemListRow));
+	ilm->priv->idToIndex = g_hash_table_new (g_direct_hash, g_direct_equal);
+	ilm->priv->indexValid = TRUE;
+	ilm->priv->cache = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, item_list_model_row_cache_free);
+	ilm->priv->stamp = g_random_int ();
+	ilm->priv->sortColumn = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+	ilm->priv->sortOrder = GTK_SORT_ASCENDING;
+	ilm->priv->sorted = TRUE;
+}
+
+ItemListModel *
+item_list_model_new (gboolean wide)
+{
+	ItemListModel *ilm;
+
+	ilm = ITEM_LIST_MODEL (g_object_new (ITEM_LIST_MODEL_TYPE, NULL));
+	ilm->priv->wide = wide;
+
+	return ilm;
+}
+
+/* row helpers */
+
+#define ROW(ilm, i) (&g_array_index ((ilm)->priv->rows, itemListRow, (i)))
+
+static void
+item_list_model_rebuild_index (ItemListModel *ilm)
+{
+	guint i;
+
+	if (ilm->priv->indexValid)
+		return;
+
+	g_hash_table_remove_all (ilm->priv->idToIndex);
+	for (i = 0; i < ilm->priv->rows->len; i++)
+		g_hash_table_insert (ilm->priv->idToIndex, GUINT_TO_POINTER (ROW (ilm, i)->id), GUINT_TO_POINTER (i + 1));
+
+	ilm->priv->indexValid = TRUE;
+}
+
+/* returns row index + 1 or 0 if not found */
+static guint
+item_list_model_lookup (ItemListModel *ilm, gulong id)
+{
+	item_list_model_rebuild_index (ilm);
+
+	return GPOINTER_TO_UINT (g_hash_table_lookup (ilm->priv->idToIndex, GUINT_TO_POINTER (id)));
+}
+
+static void
+item_list_model_set_iter (ItemListModel *ilm, GtkTreeIter *iter, guint index)
+{
+	iter->stamp = ilm->priv->stamp;
+	iter->user_data = GUINT_TO_POINTER (index);
+	iter->user_data2 = NULL;
+	iter->user_data3 = NULL;
+}
+
+static itemListRow *
+item_list_model_iter_to_row (ItemListModel *ilm, GtkTreeIter *iter)
+{
+	guint index;
+
+	g_return_val_if_fail (iter->stamp == ilm->priv->stamp, NULL);
+
+	index = GPOINTER_TO_UINT (iter->user_data);
+	g_return_val_if_fail (index < ilm->priv->rows->len, NULL);
+
+	return ROW (ilm, index);
+}
+
+static guint
+item_list_model_row_state (itemListRow *row)
+{
+	guint state = 0;
+
+	if (row->flagStatus)
+		state += 2;
+	if (!row->readStatus)
+		state += 1;
+
+	return state;
+}
+
+/* row cache */
+
+static gfloat
+item_list_model_title_alignment (const gchar *title)
+{
+	if (!title || strlen(title) == 0)
+		return 0.;
+
+	int txt_direction = pango_find_base_dir (title, -1);
+	int app_direction = gtk_widget_get_default_direction ();
+	if ((txt_direction == PANGO_DIRECTION_LTR &&
+	     app_direction == GTK_TEXT_DIR_LTR) ||
+	    (txt_direction == PANGO_DIRECTION_RTL &&
+	     app_direction == GTK_TEXT_DIR_RTL))
+		return 0.; /* same direction, regular ("left") alignment */
+	else
+		return 1.;
+}
+
+static void
+item_list_model_row_cache_format (ItemListModel *ilm, itemListRow *row, itemListRowCachePtr rc)
+{
+	gchar	*title;
+
+	g_free (rc->label);
+	g_free (rc->timeStr);
+
+	rc->timeStr = (0 != row->time) ? date_format ((time_t)row->time, NULL) : g_strdup ("");
+
+	title = rc->title && strlen (rc->title) ? rc->title : _("*** No title ***");
+	title = g_strstrip (g_markup_escape_text (title, -1));
+
+	if (ilm->priv->wide) {
+		/* Append date to headline on hidden date column */
+		const gchar	*important = " <span background='red' color='black'> important </span> ";
+		gchar		*tmp = title;
+
+		title = g_strdup_printf ("%s%s%s %s<span size='smaller' weight='light'>— (%s)</span>",
+		                         !row->readStatus?"<span weight='bold'>":"",
+		                         title,
+		                         (FALSE == row->readStatus)?"</span>":"",
+		                         row->flagStatus?important:"",
+		                         rc->timeStr);
+		g_free (tmp);
+	}
+
+	rc->label = title;
+	rc->align = item_list_model_title_alignment (title);
+}
+
+static void
+item_list_model_row_cache_add (ItemListModel *ilm, itemListRow *row, const gchar *title)
+{
+	itemListRowCachePtr	rc = g_new0 (struct itemListRowCache, 1);
+
+	rc->title = g_strdup (title);
+	item_list_model_row_cache_format (ilm, row, rc);
+	g_hash_table_replace (ilm->priv->cache, GUINT_TO_POINTER (row->id), rc);
+}
+
+/* Fetches the titles for the page of rows around the given index */
+static void
+item_list_model_fetch_page (ItemListModel *ilm, guint index)
+{
+	gulong	ids[ITEM_LIST_MODEL_PAGE_SIZE];
+	guint	indices[ITEM_LIST_MODEL_PAGE_SIZE];
+	guint	i, start, end, count = 0;
+
+	start = index - (index % ITEM_LIST_MODEL_PAGE_SIZE);
+	end = MIN (start + ITEM_LIST_MODEL_PAGE_SIZE, ilm->priv->rows->len);
+
+	/* Simply drop the whole cache when it is full, the rows
+	   currently needed are refetched in a single query anyway */
+	if (g_hash_table_size (ilm->priv->cache) + ITEM_LIST_MODEL_PAGE_SIZE > ITEM_LIST_MODEL_CACHE_SIZE)
+		g_hash_table_remove_all (ilm->priv->cache);
+
+	for (i = start; i < end; i++) {
+		gulong id = ROW (ilm, i)->id;
+		if (!g_hash_table_lookup (ilm->priv->cache, GUINT_TO_POINTER (id))) {
+			indices[count] = i;
+			ids[count++] = id;
+		}
+	}
+
+	item_header_prefetch (ids, count);
+
+	/* Items vanished from the DB get an empty entry to avoid refetching */
+	for (i = 0; i < count; i++) {
+		itemHeaderPtr header = item_header_get (ids[i]);
+		item_list_model_row_cache_add (ilm, ROW (ilm, indices[i]), header?header->title:NULL);
+	}
+}
+
+static itemListRowCachePtr
+item_list_model_get_row_cache (ItemListModel *ilm, guint index)
+{
+	itemListRowCachePtr	rc;
+	gulong			id = ROW (ilm, index)->id;
+
+	rc = g_hash_table_lookup (ilm->priv->cache, GUINT_TO_POINTER (id));
+	if (!rc) {
+		item_list_model_fetch_page (ilm, index);
+		rc = g_hash_table_lookup (ilm->priv->cache, GUINT_TO_POINTER (id));
+	}
+
+	return rc;
+}
+
+/* sorting */
+
+/* Compares two rows, the titles are only needed when sorting by title */
+static gint
+item_list_model_compare (ItemListModel *ilm, itemListRow *ra, const gchar *ta, itemListRow *rb, const gchar *tb)
+{
+	gint	result = 0;
+
+	switch (ilm->priv->sortColumn) {
+		case IS_STATE:
+		case IS_STATEICON:
+			result = (gint)item_list_model_row_state (ra) - (gint)item_list_model_row_state (rb);
+			break;
+		case IS_PARENT:
+		case IS_SOURCE:
+		case IS_FAVICON:
+			if (ra->node != rb->node && ra->node->id && rb->node->id)
+				result = strcmp (ra->node->id, rb->node->id);
+			break;
+		case IS_LABEL:
+			result = g_ascii_strcasecmp (ta?ta:"", tb?tb:"");
+			break;
+		case IS_TIME:
+		case IS_TIME_STR:
+		default:
+			result = (ra->time > rb->time) - (ra->time < rb->time);
+			break;
+	}
+
+	/* ensure a stable order for equal keys */
+	if (0 == result)
+		result = (ra->id > rb->id) - (ra->id < rb->id);
+
+	if (GTK_SORT_DESCENDING == ilm->priv->sortOrder)
+		result = -result;
+
+	return result;
+}
+
+static gint
+item_list_model_compare_rows (ItemListModel *ilm, guint a, guint b)
+{
+	gchar	*ta;
+	gint	result;
+
+	if (IS_LABEL != ilm->priv->sortColumn)
+		return item_list_model_compare (ilm, ROW (ilm, a), NULL, ROW (ilm, b), NULL);
+
+	/* copy as fetching the second row might drop the first from the cache */
+	ta = g_strdup (item_list_model_get_row_cache (ilm, a)->title);
+	result = item_list_model_compare (ilm, ROW (ilm, a), ta, ROW (ilm, b), item_list_model_get_row_cache (ilm, b)->title);
+	g_free (ta);
+
+	return result;
+}
+
+static gint
+item_list_model_compare_indices (gconstpointer a, gconstpointer b, gpointer user_data)
+{
+	return item_list_model_compare_rows (ITEM_LIST_MODEL (user_data), *(const guint *)a, *(const guint *)b);
+}
+
+/* Determines the new order (new_order[newpos] = oldpos) for sorting by title */
+static void
+item_list_model_sort_by_title (ItemListModel *ilm, gint *new_order)
+{
+	guint		i, n, pos = 0, len = ilm->priv->rows->len;
+	gulong		*ids = g_new (gulong, len);
+	gulong		*sorted = g_new (gulong, len);
+	gboolean	*placed = g_new0 (gboolean, len);
+
+	for (i = 0; i < len; i++)
+		ids[i] = ROW (ilm, i)->id;
+
+	n = db_item_ids_sort_by_title (ids, len, GTK_SORT_DESCENDING == ilm->priv->sortOrder, sorted);
+
+	for (i = 0; i < n; i++) {
+		guint index = item_list_model_lookup (ilm, sorted[i]);
+		if (index && !placed[index - 1]) {
+			placed[index - 1] = TRUE;
+			new_order[pos++] = index - 1;
+		}
+	}
+
+	/* keep rows unknown to the DB at the end */
+	for (i = 0; i < len; i++) {
+		if (!placed[i])
+			new_order[pos++] = i;
+	}
+
+	g_free (placed);
+	g_free (sorted);
+	g_free (ids);
+}
+
+static void
+item_list_model_resort (ItemListModel *ilm)
+{
+	GArray		*rows;
+	GtkTreePath	*path;
+	gint		*new_order;
+	guint		i, len = ilm->priv->rows->len;
+
+	ilm->priv->sorted = TRUE;
+
+	if (GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID == ilm->priv->sortColumn ||
+	    GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID == ilm->priv->sortColumn)
+		return;
+
+	if (len < 2)
+		return;
+
+	debug_start_measurement (DEBUG_GUI);
+
+	new_order = g_new (gint, len);
+	if (IS_LABEL == ilm->priv->sortColumn) {
+		item_list_model_sort_by_title (ilm, new_order);
+	} else {
+		for (i = 0; i < len; i++)
+			new_order[i] = i;
+		g_qsort_with_data (new_order, len, sizeof (gint), item_list_model_compare_indices, ilm);
+	}
+
+	rows = g_array_sized_new (FALSE, FALSE, sizeof (itemListRow), len);
+	for (i = 0; i < len; i++)
+		g_array_append_val (rows, *ROW (ilm, new_order[i]));
+	g_array_free (ilm->priv->rows, TRUE);
+	ilm->priv->rows = rows;
+
+	ilm->priv->indexValid = FALSE;
+	ilm->priv->stamp++;
+
+	path = gtk_tree_path_new ();
+	gtk_tree_model_rows_reordered (GTK_TREE_MODEL (ilm), path, NULL, new_order);
+	gtk_tree_path_free (path);
+
+	g_free (new_order);
+
+	debug_end_measurement (DEBUG_GUI, "item list sort");
+}
+
+void
+item_list_model_sort (ItemListModel *ilm)
+{
+	if (!ilm->priv->sorted)
+		item_list_model_resort (ilm);
+}
+
+/* item list model methods */
+
+static gboolean
+item_list_model_item_to_row (itemPtr item, itemListRow *row)
+{
+	row->node = node_from_id (item->nodeId);
+	if (!row->node)
+		return FALSE;	/* comment items do cause this... maybe filtering them earlier would be a good idea... */
+
+	row->id = item->id;
+	row->time = item->time;
+	row->readStatus = item->readStatus?1:0;
+	row->flagStatus = item->flagStatus?1:0;
+	row->hasEnclosure = item->hasEnclosure?1:0;
+
+	return TRUE;
+}
+
+static void
+item_list_model_emit_row_inserted (ItemListModel *ilm, guint index)
+{
+	GtkTreePath	*path;
+	GtkTreeIter	iter;
+
+	item_list_model_set_iter (ilm, &iter, index);
+	path = gtk_tree_path_new_from_indices (index, -1);
+	gtk_tree_model_row_inserted (GTK_TREE_MODEL (ilm), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+void
+item_list_model_append_item (ItemListModel *ilm, itemPtr item)
+{
+	itemListRow	row;
+
+	if (item_list_model_lookup (ilm, item->id)) {
+		item_list_model_update_item (ilm, item);
+		return;
+	}
+
+	if (!item_list_model_item_to_row (item, &row))
+		return;
+
+	g_array_append_val (ilm->priv->rows, row);
+	g_hash_table_insert (ilm->priv->idToIndex, GUINT_TO_POINTER (row.id), GUINT_TO_POINTER (ilm->priv->rows->len));
+	ilm->priv->sorted = FALSE;
+
+	/* We have the title at hand, so prime the cache while there is room */
+	if (g_hash_table_size (ilm->priv->cache) < ITEM_LIST_MODEL_CACHE_SIZE)
+		item_list_model_row_cache_add (ilm, &row, item->title);
+
+	item_list_model_emit_row_inserted (ilm, ilm->priv->rows->len - 1);
+}
+
+void
+item_list_model_insert_item (ItemListModel *ilm, itemPtr item)
+{
+	itemListRow	row;
+	guint		low, high, pos;
+
+	if (item_list_model_lookup (ilm, item->id)) {
+		item_list_model_update_item (ilm, item);
+		return;
+	}
+
+	if (!ilm->priv->sorted) {
+		item_list_model_append_item (ilm, item);
+		return;
+	}
+
+	if (!item_list_model_item_to_row (item, &row))
+		return;
+
+	/* Binary search the sorted position, the new row is compared
+	   directly as it is not part of the model yet */
+	pos = ilm->priv->rows->len;
+	if (GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID != ilm->priv->sortColumn &&
+	    GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID != ilm->priv->sortColumn) {
+		low = 0;
+		high = ilm->priv->rows->len;
+		while (low < high) {
+			guint		mid = low + (high - low) / 2;
+			const gchar	*title = NULL;
+
+			if (IS_LABEL == ilm->priv->sortColumn)
+				title = item_list_model_get_row_cache (ilm, mid)->title;
+			if (item_list_model_compare (ilm, ROW (ilm, mid), title, &row, item->title) < 0)
+				low = mid + 1;
+			else
+				high = mid;
+		}
+		pos = low;
+	}
+
+	g_array_insert_val (ilm->priv->rows, pos, row);
+	item_list_model_row_cache_add (ilm, &row, item->title);
+
+	ilm->priv->indexValid = FALSE;
+	ilm->priv->stamp++;
+
+	item_list_model_emit_row_inserted (ilm, pos);
+}
+
+void
+item_list_model_remove_item (ItemListModel *ilm, gulong id)
+{
+	GtkTreePath	*path;
+	guint		index;
+
+	index = item_list_model_lookup (ilm, id);
+	if (!index)
+		return;
+
+	g_array_remove_index (ilm->priv->rows, index - 1);
+	g_hash_table_remove (ilm->priv->cache, GUINT_TO_POINTER (id));
+
+	ilm->priv->indexValid = FALSE;
+	ilm->priv->stamp++;
+
+	path = gtk_tree_path_new_from_indices (index - 1, -1);
+	gtk_tree_model_row_deleted (GTK_TREE_MODEL (ilm), path);
+	gtk_tree_path_free (path);
+}
+
+static void
+item_list_model_emit_row_changed (ItemListModel *ilm, guint index)
+{
+	GtkTreePath	*path;
+	GtkTreeIter	iter;
+
+	item_list_model_set_iter (ilm, &iter, index);
+	path = gtk_tree_path_new_from_indices (index, -1);
+	gtk_tree_model_row_changed (GTK_TREE_MODEL (ilm), path, &iter);
+	gtk_tree_path_free (path);
+}
+
+void
+item_list_model_update_item (ItemListModel *ilm, itemPtr item)
+{
+	itemListRow	*row;
+	guint		index;
+
+	index = item_list_model_lookup (ilm, item->id);
+	if (!index)
+		return;
+
+	/* Note: like before the row is not moved on changes of
+	   sort relevant attributes to avoid confusing the user */
+	row = ROW (ilm, index - 1);
+	row->readStatus = item->readStatus?1:0;
+	row->flagStatus = item->flagStatus?1:0;
+	row->hasEnclosure = item->hasEnclosure?1:0;
+
+	item_list_model_row_cache_add (ilm, row, item->title);
+	item_list_model_emit_row_changed (ilm, index - 1);
+}
+
+void
+item_list_model_update_all_items (ItemListModel *ilm)
+{
+	gulong	ids[ITEM_LIST_MODEL_PAGE_SIZE];
+	guint	i, j, count, len = ilm->priv->rows->len;
+
+	/* Titles are refetched on demand, so just drop them */
+	g_hash_table_remove_all (ilm->priv->cache);
+
+	/* Check the states using the item header cache page by page */
+	for (i = 0; i < len; i += count) {
+		count = MIN (ITEM_LIST_MODEL_PAGE_SIZE, len - i);
+		for (j = 0; j < count; j++)
+			ids[j] = ROW (ilm, i + j)->id;
+
+		item_header_prefetch (ids, count);
+
+		for (j = 0; j < count; j++) {
+			itemListRow	*row = ROW (ilm, i + j);
+			itemHeaderPtr	header = item_header_get (row->id);
+
+			if (!header)
+				continue;
+
+			if (row->readStatus == header->readStatus && row->flagStatus == header->flagStatus)
+				continue;
+
+			row->readStatus = header->readStatus;
+			row->flagStatus = header->flagStatus;
+			item_list_model_emit_row_changed (ilm, i + j);
+		}
+	}
+}
+
+gboolean
+item_list_model_contains_id (ItemListModel *ilm, gulong id)
+{
+	return 0 != item_list_model_lookup (ilm, id);
+}
+
+gboolean
+item_list_model_id_to_iter (ItemListModel *ilm, gulong id, GtkTreeIter *iter)
+{
+	guint index = item_list_model_lookup (ilm, id);
+
+	if (!index)
+		return FALSE;
+
+	item_list_model_set_iter (ilm, iter, index - 1);
+	return TRUE;
+}
+
+/* GtkTreeModel interface */
+
+static GtkTreeModelFlags
+item_list_model_get_flags (GtkTreeModel *model)
+{
+	return GTK_TREE_MODEL_LIST_ONLY;
+}
+
+static gint
+item_list_model_get_n_columns (GtkTreeModel *model)
+{
+	return ITEMSTORE_LEN;
+}
+
+static GType
+item_list_model_get_column_type (GtkTreeModel *model, gint index)
+{
+	switch (index) {
+		case IS_TIME:		return G_TYPE_UINT64;
+		case IS_TIME_STR:	return G_TYPE_STRING;
+		case IS_LABEL:		return G_TYPE_STRING;
+		case IS_STATEICON:	return GDK_TYPE_PIXBUF;
+		case IS_NR:		return G_TYPE_ULONG;
+		case IS_PARENT:		return G_TYPE_POINTER;
+		case IS_FAVICON:	return GDK_TYPE_PIXBUF;
+		case IS_ENCICON:	return GDK_TYPE_PIXBUF;
+		case IS_ENCLOSURE:	return G_TYPE_BOOLEAN;
+		case IS_SOURCE:		return G_TYPE_POINTER;
+		case IS_STATE:		return G_TYPE_UINT;
+		case ITEMSTORE_WEIGHT:	return G_TYPE_INT;
+		case ITEMSTORE_ALIGN:	return G_TYPE_FLOAT;
+		default:
+			g_return_val_if_reached (G_TYPE_INVALID);
+	}
+}
+
+static gboolean
+item_list_model_get_iter (GtkTreeModel *model, GtkTreeIter *iter, GtkTreePath *path)
+{
+	ItemListModel	*ilm = ITEM_LIST_MODEL (model);
+	gint		index;
+
+	if (gtk_tree_path_get_depth (path) != 1)
+		return FALSE;
+
+	index = gtk_tree_path_get_indices (path)[0];
+	if (index < 0 || (guint)index >= ilm->priv->rows->len)
+		return FALSE;
+
+	item_list_model_set_iter (ilm, iter, index);
+	return TRUE;
+}
+
+static GtkTreePath *
+item_list_model_get_path (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	g_return_val_if_fail (iter->stamp == ITEM_LIST_MODEL (model)->priv->stamp, NULL);
+
+	return gtk_tree_path_new_from_indices (GPOINTER_TO_UINT (iter->user_data), -1);
+}
+
+static void
+item_list_model_get_value (GtkTreeModel *model, GtkTreeIter *iter, gint column, GValue *value)
+{
+	ItemListModel		*ilm = ITEM_LIST_MODEL (model);
+	itemListRow		*row;
+	itemListRowCachePtr	rc;
+
+	g_value_init (value, item_list_model_get_column_type (model, column));
+
+	row = item_list_model_iter_to_row (ilm, iter);
+	if (!row)
+		return;
+
+	switch (column) {
+		case IS_TIME:
+			g_value_set_uint64 (value, (guint64)row->time);
+			break;
+		case IS_TIME_STR:
+			rc = item_list_model_get_row_cache (ilm, GPOINTER_TO_UINT (iter->user_data));
+			g_value_set_string (value, rc->timeStr);
+			break;
+		case IS_LABEL:
+			rc = item_list_model_get_row_cache (ilm, GPOINTER_TO_UINT (iter->user_data));
+			g_value_set_string (value, rc->label);
+			break;
+		case ITEMSTORE_ALIGN:
+			rc = item_list_model_get_row_cache (ilm, GPOINTER_TO_UINT (iter->user_data));
+			g_value_set_float (value, rc->align);
+			break;
+		case IS_STATEICON:
+			g_value_set_object (value, (gpointer)(row->flagStatus ? icon_get (ICON_FLAG) :
+			                                      !row->readStatus ? icon_get (ICON_UNREAD) :
+			                                      NULL));
+			break;
+		case IS_NR:
+			g_value_set_ulong (value, row->id);
+			break;
+		case IS_PARENT:
+		case IS_SOURCE:
+			g_value_set_pointer (value, row->node);
+			break;
+		case IS_FAVICON:
+			g_value_set_object (value, ilm->priv->wide?node_get_large_icon (row->node):node_get_icon (row->node));
+			break;
+		case IS_ENCICON:
+			g_value_set_object (value, row->hasEnclosure?(gpointer)icon_get (ICON_ENCLOSURE):NULL);
+			break;
+		case IS_ENCLOSURE:
+			g_value_set_boolean (value, row->hasEnclosure);
+			break;
+		case IS_STATE:
+			g_value_set_uint (value, item_list_model_row_state (row));
+			break;
+		case ITEMSTORE_WEIGHT:
+			g_value_set_int (value, row->readStatus ? PANGO_WEIGHT_NORMAL : PANGO_WEIGHT_BOLD);
+			break;
+	}
+}
+
+static gboolean
+item_list_model_iter_next (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	ItemListModel	*ilm = ITEM_LIST_MODEL (model);
+	guint		index = GPOINTER_TO_UINT (iter->user_data) + 1;
+
+	if (iter->stamp != ilm->priv->stamp || index >= ilm->priv->rows->len) {
+		iter->stamp = 0;
+		return FALSE;
+	}
+
+	iter->user_data = GUINT_TO_POINTER (index);
+	return TRUE;
+}
+
+static gboolean
+item_list_model_iter_nth_child (GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent, gint n)
+{
+	ItemListModel	*ilm = ITEM_LIST_MODEL (model);
+
+	if (parent || n < 0 || (guint)n >= ilm->priv->rows->len)
+		return FALSE;
+
+	item_list_model_set_iter (ilm, iter, n);
+	return TRUE;
+}
+
+static gboolean
+item_list_model_iter_children (GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *parent)
+{
+	return item_list_model_iter_nth_child (model, iter, parent, 0);
+}
+
+static gboolean
+item_list_model_iter_has_child (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	return FALSE;
+}
+
+static gint
+item_list_model_iter_n_children (GtkTreeModel *model, GtkTreeIter *iter)
+{
+	if (iter)
+		return 0;
+
+	return ITEM_LIST_MODEL (model)->priv->rows->len;
+}
+
+static gboolean
+item_list_model_iter_parent (GtkTreeModel *model, GtkTreeIter *iter, GtkTreeIter *child)
+{
+	return FALSE;
+}
+
+static void
+item_list_model_tree_model_init (GtkTreeModelIface *iface)
+{
+	iface->get_flags	= item_list_model_get_flags;
+	iface->get_n_columns	= item_list_model_get_n_columns;
+	iface->get_column_type	= item_list_model_get_column_type;
+	iface->get_iter		= item_list_model_get_iter;
+	iface->get_path		= item_list_model_get_path;
+	iface->get_value	= item_list_model_get_value;
+	iface->iter_next	= item_list_model_iter_next;
+	iface->iter_children	= item_list_model_iter_children;
+	iface->iter_has_child	= item_list_model_iter_has_child;
+	iface->iter_n_children	= item_list_model_iter_n_children;
+	iface->iter_nth_child	= item_list_model_iter_nth_child;
+	iface->iter_parent	= item_list_model_iter_parent;
+}
+
+/* GtkTreeSortable interface */
+
+static gboolean
+item_list_model_get_sort_column_id (GtkTreeSortable *sortable, gint *sort_column_id, GtkSortType *order)
+{
+	ItemListModel *ilm = ITEM_LIST_MODEL (sortable);
+
+	if (sort_column_id)
+		*sort_column_id = ilm->priv->sortColumn;
+	if (order)
+		*order = ilm->priv->sortOrder;
+
+	return (GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID != ilm->priv->sortColumn &&
+	        GTK_TREE_SORTABLE_DEFAULT_SORT_COLUMN_ID != ilm->priv->sortColumn);
+}
+
+static void
+item_list_model_set_sort_column_id (GtkTreeSortable *sortable, gint sort_column_id, GtkSortType order)
+{
+	ItemListModel *ilm = ITEM_LIST_MODEL (sortable);
+
+	if (ilm->priv->sortColumn == sort_column_id &&
+	    ilm->priv->sortOrder == order &&
+	    ilm->priv->sorted)
+		return;
+
+	ilm->priv->sortColumn = sort_column_id;
+	ilm->priv->sortOrder = order;
+
+	item_list_model_resort (ilm);
+	gtk_tree_sortable_sort_column_changed (sortable);
+}
+
+static void
+item_list_model_set_sort_func (GtkTreeSortable *sortable, gint sort_column_id, GtkTreeIterCompareFunc func, gpointer data, GDestroyNotify destroy)
+{
+	/* Sorting is built-in, custom sort functions are not supported */
+	g_warning ("item_list_model_set_sort_func() is not supported!");
+}
+
+static void
+item_list_model_set_default_sort_func (GtkTreeSortable *sortable, GtkTreeIterCompareFunc func, gpointer data, GDestroyNotify destroy)
+{
+	g_warning ("item_list_model_set_default_sort_func() is not supported!");
+}
+
+static gboolean
+item_list_model_has_default_sort_func (GtkTreeSortable *sortable)
+{
+	return FALSE;
+}
+
+static void
+item_list_model_tree_sortable_init (GtkTreeSortableIface *iface)
+{
+	iface->get_sort_column_id	= item_list_model_get_sort_column_id;
+	iface->set_sort_column_id	= item_list_model_set_sort_column_id;
+	iface->set_sort_func		= item_list_model_set_sort_func;
+	iface->set_default_sort_func	= item_list_model_set_default_sort_func;
+	iface->has_default_sort_func	= item_list_model_has_default_sort_func;
+}
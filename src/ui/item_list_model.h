@@ -0,0 +1,163 @@
+/**
+ * @file item_list_model.h  lazy loading GtkTreeModel for the item list
+ *
+ * Copyright (C) 2016 Lars Windolf <lars.windolf@gmx.de>
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#ifndef _ITEM_LIST_MODEL_H
+#define _ITEM_LIST_MODEL_H
+
+#include <glib-object.h>
+#include <glib.h>
+#include <gtk/gtk.h>
+
+#include "item.h"
+
+/* This class realizes a flat GtkTreeModel for the ItemListView. Instead
+   of materializing every row like a GtkTreeStore it only keeps a compact
+   array of item ids plus the few attributes needed for sorting. Titles
+   and formatted dates are fetched from the DB in pages when GTK asks for
+   a row and kept in a small bounded row cache. */
+
+/** Enumeration of the columns in the item list model. */
+enum is_columns {
+	IS_TIME,		/**< Time of item creation */
+	IS_TIME_STR,		/**< Time of item creation as a string*/
+	IS_LABEL,		/**< Displayed name */
+	IS_STATEICON,		/**< Pixbuf reference to the item's state icon */
+	IS_NR,			/**< Item id, to lookup item ptr from parent feed */
+	IS_PARENT,		/**< Parent node pointer */
+	IS_FAVICON,		/**< Pixbuf reference to the item's feed's icon */
+	IS_ENCICON,		/**< Pixbuf reference to the item's enclosure icon */
+	IS_ENCLOSURE,		/**< Flag whether enclosure is attached or not */
+	IS_SOURCE,		/**< Source node pointer */
+	IS_STATE,		/**< Original item state (unread, flagged...) for sorting */
+	ITEMSTORE_WEIGHT,		/**< Flag whether weight is to be bold and "unread" icon is to be shown */
+	ITEMSTORE_ALIGN,        /**< How to align title (RTL support) */
+	ITEMSTORE_LEN		/**< Number of columns in the itemstore */
+};
+
+G_BEGIN_DECLS
+
+#define ITEM_LIST_MODEL_TYPE		(item_list_model_get_type ())
+#define ITEM_LIST_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_CAST ((obj), ITEM_LIST_MODEL_TYPE, ItemListModel))
+#define ITEM_LIST_MODEL_CLASS(klass)	(G_TYPE_CHECK_CLASS_CAST ((klass), ITEM_LIST_MODEL_TYPE, ItemListModelClass))
+#define IS_ITEM_LIST_MODEL(obj)		(G_TYPE_CHECK_INSTANCE_TYPE ((obj), ITEM_LIST_MODEL_TYPE))
+#define IS_ITEM_LIST_MODEL_CLASS(klass)	(G_TYPE_CHECK_CLASS_TYPE ((klass), ITEM_LIST_MODEL_TYPE))
+
+typedef struct ItemListModel		ItemListModel;
+typedef struct ItemListModelClass	ItemListModelClass;
+typedef struct ItemListModelPrivate	ItemListModelPrivate;
+
+struct ItemListModel
+{
+	GObject		parent;
+
+	/*< private >*/
+	ItemListModelPrivate	*priv;
+};
+
+struct ItemListModelClass
+{
+	GObjectClass parent_class;
+};
+
+GType item_list_model_get_type (void);
+
+/**
+ * Create a new empty item list model.
+ *
+ * @param wide	TRUE if the date is to be rendered into the label
+ *
+ * @returns a new ItemListModel
+ */
+ItemListModel * item_list_model_new (gboolean wide);
+
+/**
+ * Appends an item without keeping the sort order. To be used
+ * for batch loading unattached models. Call item_list_model_sort()
+ * afterwards.
+ *
+ * @param ilm	the ItemListModel
+ * @param item	the item to add
+ */
+void item_list_model_append_item (ItemListModel *ilm, itemPtr item);
+
+/**
+ * Inserts an item at its sorted position. To be used for single
+ * items added by background updates.
+ *
+ * @param ilm	the ItemListModel
+ * @param item	the item to add
+ */
+void item_list_model_insert_item (ItemListModel *ilm, itemPtr item);
+
+/**
+ * Removes the row of the given item id.
+ *
+ * @param ilm	the ItemListModel
+ * @param id	the item id
+ */
+void item_list_model_remove_item (ItemListModel *ilm, gulong id);
+
+/**
+ * Updates the row of the given item with the item's current state.
+ *
+ * @param ilm	the ItemListModel
+ * @param item	the item
+ */
+void item_list_model_update_item (ItemListModel *ilm, itemPtr item);
+
+/**
+ * Reloads the state of all rows from the DB and drops the row cache.
+ *
+ * @param ilm	the ItemListModel
+ */
+void item_list_model_update_all_items (ItemListModel *ilm);
+
+/**
+ * Checks whether the given item id is in the model.
+ *
+ * @param ilm	the ItemListModel
+ * @param id	the item id
+ *
+ * @returns TRUE if the item is in the model
+ */
+gboolean item_list_model_contains_id (ItemListModel *ilm, gulong id);
+
+/**
+ * Determines the tree iter of a given item id.
+ *
+ * @param ilm	the ItemListModel
+ * @param id	the item id
+ * @param iter	the iter to set
+ *
+ * @returns TRUE if the item is in the model
+ */
+gboolean item_list_model_id_to_iter (ItemListModel *ilm, gulong id, GtkTreeIter *iter);
+
+/**
+ * Sorts the model according to the current sort column if it
+ * is not yet sorted (e.g. after batch loading).
+ *
+ * @param ilm	the ItemListModel
+ */
+void item_list_model_sort (ItemListModel *ilm);
+
+G_END_DECLS
+
+#endif
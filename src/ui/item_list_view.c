@@ -42,6 +42,7 @@
 #include "social.h"
 #include "ui/browser_tabs.h"
 #include "ui/icons.h"
+#include "ui/item_list_model.h"
 #include "ui/liferea_shell.h"
 #include "ui/popup_menu.h"
 #include "ui/ui_common.h"
@@ -53,29 +54,16 @@
  * 1.) Mass-adding items to a sorting enabled tree store.
  * 2.) Mass-loading items to an attached tree store.
  *
- * To avoid both problems we merge against a visible tree store only for single
+ * To avoid both problems we merge against a visible model only for single
  * items that are added/removed by background updates and load complete feeds or
- * collections of feeds only by adding items to a new unattached tree store.
+ * collections of feeds only by adding items to a new unattached model.
+ *
+ * Additionally the ItemListModel does not materialize rows. It only keeps
+ * a compact array of item ids and fetches titles from the DB for the rows
+ * GTK actually asks for. To profit from this the normal view uses fixed
+ * height mode, so that GTK does not need to measure every row.
  */
 
-/** Enumeration of the columns in the itemstore. */
-enum is_columns {
-	IS_TIME,		/**< Time of item creation */
-	IS_TIME_STR,		/**< Time of item creation as a string*/
-	IS_LABEL,		/**< Displayed name */
-	IS_STATEICON,		/**< Pixbuf reference to the item's state icon */
-	IS_NR,			/**< Item id, to lookup item ptr from parent feed */
-	IS_PARENT,		/**< Parent node pointer */
-	IS_FAVICON,		/**< Pixbuf reference to the item's feed's icon */
-	IS_ENCICON,		/**< Pixbuf reference to the item's enclosure icon */
-	IS_ENCLOSURE,		/**< Flag whether enclosure is attached or not */
-	IS_SOURCE,		/**< Source node pointer */
-	IS_STATE,		/**< Original item state (unread, flagged...) for sorting */
-	ITEMSTORE_WEIGHT,		/**< Flag whether weight is to be bold and "unread" icon is to be shown */
-	ITEMSTORE_ALIGN,        /**< How to align title (RTL support) */
-	ITEMSTORE_LEN		/**< Number of columns in the itemstore */
-};
-
 typedef enum {
 	DEFAULT,
 	INTERNAL,
@@ -124,10 +112,8 @@ launch_item_selected (open_link_target_type open_link_target)
 struct ItemListViewPrivate {
 	GtkTreeView	*treeview;
 	
-	GHashTable 	*item_id_to_iter;	/**< hash table used for fast item id->tree iter lookup */
-
 	gboolean	batch_mode;		/**< TRUE if we are in batch adding mode */
-	GtkTreeStore	*batch_itemstore;	/**< GtkTreeStore prepared unattached and to be set on update() */
+	ItemListModel	*batch_model;		/**< ItemListModel prepared unattached and to be set on update() */
 
 	GtkTreeViewColumn	*enclosureColumn;
 	GtkTreeViewColumn	*faviconColumn;
@@ -145,10 +131,8 @@ item_list_view_finalize (GObject *object)
 {
 	ItemListViewPrivate *priv = ITEM_LIST_VIEW_GET_PRIVATE (object);
 
-	if (priv->item_id_to_iter)
-		g_hash_table_destroy (priv->item_id_to_iter);
-	if (priv->batch_itemstore)
-		g_object_unref (priv->batch_itemstore);
+	if (priv->batch_model)
+		g_object_unref (priv->batch_model);
 
 	G_OBJECT_CLASS (parent_class)->finalize (object);
 }
@@ -167,10 +151,20 @@ item_list_view_class_init (ItemListViewClass *klass)
 
 /* helper functions for item <-> iter conversion */
 
+/* returns the model items are currently merged against */
+static ItemListModel *
+item_list_view_get_model (ItemListView *ilv)
+{
+	if (ilv->priv->batch_mode)
+		return ilv->priv->batch_model;
+
+	return ITEM_LIST_MODEL (gtk_tree_view_get_model (ilv->priv->treeview));
+}
+
 gboolean
 item_list_view_contains_id (ItemListView *ilv, gulong id)
 {
-	return (NULL != g_hash_table_lookup (ilv->priv->item_id_to_iter, GUINT_TO_POINTER (id)));
+	return item_list_model_contains_id (item_list_view_get_model (ilv), id);
 }
 
 static gulong
@@ -185,47 +179,7 @@ item_list_view_iter_to_id (ItemListView *ilv, GtkTreeIter *iter)
 static gboolean
 item_list_view_id_to_iter (ItemListView *ilv, gulong id, GtkTreeIter *iter)
 {
-	GtkTreeIter *old_iter;
-
-	old_iter = g_hash_table_lookup (ilv->priv->item_id_to_iter, GUINT_TO_POINTER (id));
-	if (!old_iter)
-		return FALSE;
-	
-	*iter = *old_iter;
-	return TRUE;
-}
-
-static gint
-item_list_view_date_sort_func (GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer user_data)
-{
-	guint64	timea, timeb;
-	double	diff;
-
-	gtk_tree_model_get (model, a, IS_TIME, &timea, -1);
-	gtk_tree_model_get (model, b, IS_TIME, &timeb, -1);
-	diff = difftime ((time_t)timeb, (time_t)timea);
-	
-	if (diff < 0)
-		return 1;
-		
-	if (diff > 0)
-		return -1;
-	
-	return 0;
-}
-
-static gint
-item_list_view_favicon_sort_func (GtkTreeModel *model, GtkTreeIter *a, GtkTreeIter *b, gpointer user_data)
-{
-	nodePtr	node1, node2;
-	
-	gtk_tree_model_get (model, a, IS_SOURCE, &node1, -1);
-	gtk_tree_model_get (model, b, IS_SOURCE, &node2, -1);
-	
-	if (!node1->id || !node2->id)
-		return 0;
-		
-	return strcmp (node1->id, node2->id);
+	return item_list_model_id_to_iter (item_list_view_get_model (ilv), id, iter);
 }
 
 void
@@ -254,30 +208,6 @@ item_list_view_set_sort_column (ItemListView *ilv, nodeViewSortType sortType, gb
 	                                      sortReversed?GTK_SORT_DESCENDING:GTK_SORT_ASCENDING);
 }
 
-/**
- * Creates a GtkTreeStore to be filled with ui_itemlist_set_items
- * and to be set with ui_itemlist_set_tree_store().
- */
-static GtkTreeStore *
-item_list_view_create_tree_store (void)
-{
-	return gtk_tree_store_new (ITEMSTORE_LEN,
-	                    G_TYPE_UINT64,	/* IS_TIME */
-	                    G_TYPE_STRING, 	/* IS_TIME_STR */
-	                    G_TYPE_STRING,	/* IS_LABEL */
-	                    GDK_TYPE_PIXBUF,	/* IS_STATEICON */
-	                    G_TYPE_ULONG,	/* IS_NR */
-	                    G_TYPE_POINTER,	/* IS_PARENT */
-	                    GDK_TYPE_PIXBUF,	/* IS_FAVICON */
-	                    GDK_TYPE_PIXBUF,	/* IS_ENCICON */
-	                    G_TYPE_BOOLEAN,	/* IS_ENCLOSURE */
-	                    G_TYPE_POINTER,	/* IS_SOURCE */
-	                    G_TYPE_UINT,	/* IS_STATE */
-			    G_TYPE_INT,		/* ITEMSTORE_WEIGHT */
-			    G_TYPE_FLOAT        /* ITEMSTORE_ALIGN */
-	);
-}
-
 static void
 on_itemlist_selection_changed (GtkTreeSelection *selection, gpointer user_data)
 {
@@ -333,7 +263,7 @@ itemlist_sort_column_changed_cb (GtkTreeSortable *treesortable, gpointer user_da
  * Sets a GtkTreeView to the active GtkTreeView.
  */
 static void
-item_list_view_set_tree_store (ItemListView *ilv, GtkTreeStore *itemstore)
+item_list_view_set_tree_store (ItemListView *ilv, ItemListModel *itemstore)
 {
 	GtkTreeModel    	*model;
 	GtkTreeSelection	*select;
@@ -344,8 +274,6 @@ item_list_view_set_tree_store (ItemListView *ilv, GtkTreeStore *itemstore)
 	if (model)
 		g_object_unref (model);
 	
-	gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (itemstore), IS_TIME, item_list_view_date_sort_func, NULL, NULL);
-	gtk_tree_sortable_set_sort_func (GTK_TREE_SORTABLE (itemstore), IS_SOURCE, item_list_view_favicon_sort_func, NULL, NULL);
 	g_signal_connect (G_OBJECT (itemstore), "sort-column-changed", G_CALLBACK (itemlist_sort_column_changed_cb), NULL);
 	
 	gtk_tree_view_set_model (ilv->priv->treeview, GTK_TREE_MODEL (itemstore));
@@ -360,19 +288,18 @@ item_list_view_set_tree_store (ItemListView *ilv, GtkTreeStore *itemstore)
 void
 item_list_view_remove_item (ItemListView *ilv, itemPtr item)
 {
-	GtkTreeIter	*iter;
+	GtkTreeIter	iter;
 
 	g_assert (NULL != item);
-	iter = g_hash_table_lookup (ilv->priv->item_id_to_iter, GUINT_TO_POINTER (item->id));
-	if (iter) {
+	if (item_list_view_id_to_iter (ilv, item->id, &iter)) {
 		/* Using the GtkTreeIter check if it is currently selected. If yes,
 		   scroll down by one in the sorted GtkTreeView to ensure something
 		   is selected after removing the GtkTreeIter */
-		if (gtk_tree_selection_iter_is_selected (gtk_tree_view_get_selection (ilv->priv->treeview), iter))
+		if (!ilv->priv->batch_mode &&
+		    gtk_tree_selection_iter_is_selected (gtk_tree_view_get_selection (ilv->priv->treeview), &iter))
 			ui_common_treeview_move_cursor (ilv->priv->treeview, 1);
 	
-		gtk_tree_store_remove (GTK_TREE_STORE (gtk_tree_view_get_model (ilv->priv->treeview)), iter);
-		g_hash_table_remove (ilv->priv->item_id_to_iter, GUINT_TO_POINTER (item->id));
+		item_list_model_remove_item (item_list_view_get_model (ilv), item->id);
 	} else {
 		g_warning ("Fatal: item to be removed not found in iter lookup hash!");
 	}
@@ -383,10 +310,12 @@ void
 item_list_view_clear (ItemListView *ilv)
 {
 	GtkAdjustment		*adj;
-	GtkTreeStore		*itemstore;
+	GtkTreeModel		*itemstore;
 	GtkTreeSelection	*select;
+	gint			sortColumn = GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID;
+	GtkSortType		sortType = GTK_SORT_ASCENDING;
 
-	itemstore = GTK_TREE_STORE (gtk_tree_view_get_model (ilv->priv->treeview));
+	itemstore = gtk_tree_view_get_model (ilv->priv->treeview);
 
 	/* unselecting all items is important to remove items
 	   whose removal is deferred until unselecting */
@@ -400,109 +329,39 @@ item_list_view_clear (ItemListView *ilv)
 	/* Disconnect signal handler to be safe */
 	g_signal_handlers_disconnect_by_func (G_OBJECT (select), G_CALLBACK (on_itemlist_selection_changed), ilv);
 
-	if (itemstore)
-		gtk_tree_store_clear (itemstore);
-	if (ilv->priv->item_id_to_iter)
-		g_hash_table_destroy (ilv->priv->item_id_to_iter);
-	
-	ilv->priv->item_id_to_iter = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+	/* Instead of removing all rows one by one just drop the model,
+	   the new one will be attached on the next update() */
+	if (itemstore) {
+		gtk_tree_sortable_get_sort_column_id (GTK_TREE_SORTABLE (itemstore), &sortColumn, &sortType);
+		gtk_tree_view_set_model (ilv->priv->treeview, NULL);
+		g_object_unref (itemstore);
+	}
 	
 	/* enable batch mode for following item adds */
+	if (ilv->priv->batch_model)
+		g_object_unref (ilv->priv->batch_model);
 	ilv->priv->batch_mode = TRUE;
-	ilv->priv->batch_itemstore = item_list_view_create_tree_store ();
-}
+	ilv->priv->batch_model = item_list_model_new (ilv->priv->wideView);
 
-static gfloat
-item_list_title_alignment (gchar *title)
-{
-	if (!title || strlen(title) == 0)
-		return 0.;
-
-	/* debug5 (DEBUG_HTML, "title ***%s*** first bytes %02hhx%02hhx%02hhx pango %d",
-		title, title[0], title[1], title[2], pango_find_base_dir (title, -1)); */
-	int txt_direction = pango_find_base_dir (title, -1);
-  	int app_direction = gtk_widget_get_default_direction ();
-	if ((txt_direction == PANGO_DIRECTION_LTR &&
-	     app_direction == GTK_TEXT_DIR_LTR) ||
-	    (txt_direction == PANGO_DIRECTION_RTL &&
-	     app_direction == GTK_TEXT_DIR_RTL))
-		return 0.; /* same direction, regular ("left") alignment */
-	else
-		return 1.;
+	/* keep sorting like before so that update() can sort unattached */
+	if (GTK_TREE_SORTABLE_UNSORTED_SORT_COLUMN_ID != sortColumn)
+		gtk_tree_sortable_set_sort_column_id (GTK_TREE_SORTABLE (ilv->priv->batch_model), sortColumn, sortType);
 }
 
 void
 item_list_view_update_item (ItemListView *ilv, itemPtr item)
 {
-	GtkTreeStore	*itemstore;
-	GtkTreeIter	iter;
-	gchar		*title, *time_str;
-	const GdkPixbuf	*state_icon;
-	
-	if (!item_list_view_id_to_iter (ilv, item->id, &iter))
-		return;
-	
-	time_str = (0 != item->time) ? date_format ((time_t)item->time, NULL) : g_strdup ("");
-
-	title = item->title && strlen (item->title) ? item->title : _("*** No title ***");
-	title = g_strstrip (g_markup_escape_text (title, -1));
-
-	if (ilv->priv->wideView) {
-		/* Append date to headline on hidden date column */
-		const gchar	*important = " <span background='red' color='black'> important </span> ";
-		gchar		*tmp = title;
-
-		title = g_strdup_printf ("%s%s%s %s<span size='smaller' weight='light'>— (%s)</span>",
-		                         !item->readStatus?"<span weight='bold'>":"",
-		                         title,
-		                         (FALSE == item->readStatus)?"</span>":"",
-		                         item->flagStatus?important:"",
-		                         time_str);
-		g_free (tmp);
-	}
-
-	state_icon = item->flagStatus ? icon_get (ICON_FLAG) :
-	             !item->readStatus ? icon_get (ICON_UNREAD) :
-		     NULL;
-
-	if (ilv->priv->batch_mode)
-		itemstore = ilv->priv->batch_itemstore;
-	else
-		itemstore = GTK_TREE_STORE (gtk_tree_view_get_model (ilv->priv->treeview));
-
-	gtk_tree_store_set (itemstore,
-	                    &iter,
-		            IS_LABEL, title,
-			    IS_TIME_STR, time_str,
-			    IS_STATEICON, state_icon,
-			    ITEMSTORE_ALIGN, item_list_title_alignment (title),
-	                    ITEMSTORE_WEIGHT, item->readStatus ? PANGO_WEIGHT_NORMAL : PANGO_WEIGHT_BOLD,
-			    -1);
-
-	g_free (time_str);
-	g_free (title);
-}
-
-static void
-item_list_view_update_item_foreach (gpointer key,
-                                    gpointer value,
-                                    gpointer user_data)
-{
-	itemPtr 	item;
-	
-	item = item_load (GPOINTER_TO_UINT (key) /* id */);
-	if (!item)
-		return;
-
-	item_list_view_update_item (ITEM_LIST_VIEW (user_data), item);
-	
-	item_unload (item);
+	item_list_model_update_item (item_list_view_get_model (ilv), item);
 }
 
 void 
 item_list_view_update_all_items (ItemListView *ilv) 
 {
-	g_hash_table_foreach (ilv->priv->item_id_to_iter, item_list_view_update_item_foreach, (gpointer)ilv);
+	/* Reloads the states of all rows with a few DB queries and
+	   drops all cached titles, which are then refetched only
+	   for the visible rows on redraw. */
+	item_list_model_update_all_items (item_list_view_get_model (ilv));
+	gtk_widget_queue_draw (GTK_WIDGET (ilv->priv->treeview));
 }
 
 void
@@ -512,7 +371,10 @@ item_list_view_update (ItemListView *ilv, gboolean hasEnclosures)
 	gtk_tree_view_column_set_visible (ilv->priv->enclosureColumn, hasEnclosures);
 
 	if (ilv->priv->batch_mode) {
-		item_list_view_set_tree_store (ilv, ilv->priv->batch_itemstore);
+		/* sort before attaching to avoid a reordering of the view */
+		item_list_model_sort (ilv->priv->batch_model);
+		item_list_view_set_tree_store (ilv, ilv->priv->batch_model);
+		ilv->priv->batch_model = NULL;
 		ilv->priv->batch_mode = FALSE;
 	} else {
 		/* Nothing to do in non-batch mode as items were added
@@ -608,7 +470,7 @@ on_item_list_view_button_press_event (GtkWidget *treeview, GdkEventButton *event
 		return FALSE;
 
 	if (gtk_tree_model_get_iter (gtk_tree_view_get_model (ilv->priv->treeview), &iter, path))
-		item = item_load (item_list_view_iter_to_id (ilv, &iter));
+		item = item_load_light (item_list_view_iter_to_id (ilv, &iter));
 		
 	gtk_tree_path_free (path);
 	
@@ -683,7 +545,15 @@ static void
 item_list_view_init (ItemListView *ilv)
 {
 	ilv->priv = ITEM_LIST_VIEW_GET_PRIVATE (ilv);
-	ilv->priv->item_id_to_iter = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+}
+
+/* Fixed sizing is required for all columns to enable fixed height mode */
+static void
+item_list_view_column_set_fixed (GtkTreeViewColumn *column, gint width)
+{
+	gtk_tree_view_column_set_sizing (column, GTK_TREE_VIEW_COLUMN_FIXED);
+	if (width > 0)
+		gtk_tree_view_column_set_fixed_width (column, width);
 }
 
 ItemListView *
@@ -693,8 +563,11 @@ item_list_view_create (gboolean wide)
 	GtkCellRenderer		*renderer;
 	GtkTreeViewColumn 	*column, *headline_column;
 	GtkWidget 		*ilscrolledwindow;
+	gint			iconWidth = 0, iconHeight = 0;
 
 	ilv = g_object_new (ITEM_LIST_VIEW_TYPE, NULL);
+	ilv->priv->wideView = wide;
+	gtk_icon_size_lookup (GTK_ICON_SIZE_MENU, &iconWidth, &iconHeight);
 		
 	ilscrolledwindow = gtk_scrolled_window_new (NULL, NULL);
 	gtk_widget_show (ilscrolledwindow);
@@ -714,7 +587,7 @@ item_list_view_create (gboolean wide)
 	gtk_widget_set_name (GTK_WIDGET (ilv->priv->treeview), "itemlist");
 	gtk_tree_view_set_rules_hint (ilv->priv->treeview, TRUE);
 
-	item_list_view_set_tree_store (ilv, item_list_view_create_tree_store ());
+	item_list_view_set_tree_store (ilv, item_list_model_new (wide));
 
 	renderer = gtk_cell_renderer_pixbuf_new ();
 	column = gtk_tree_view_column_new_with_attributes ("", renderer, "pixbuf", IS_STATEICON, NULL);
@@ -723,11 +596,15 @@ item_list_view_create (gboolean wide)
 	gtk_tree_view_column_set_sort_column_id (column, IS_STATE);
 	if (wide)
 		gtk_tree_view_column_set_visible (column, FALSE);
+	else
+		item_list_view_column_set_fixed (column, iconWidth + 8);
 	
 	renderer = gtk_cell_renderer_pixbuf_new ();
 	column = gtk_tree_view_column_new_with_attributes ("", renderer, "pixbuf", IS_ENCICON, NULL);
 	gtk_tree_view_append_column (ilv->priv->treeview, column);
 	ilv->priv->enclosureColumn = column;
+	if (!wide)
+		item_list_view_column_set_fixed (column, iconWidth + 8);
 
 	renderer = gtk_cell_renderer_text_new ();
 	column = gtk_tree_view_column_new_with_attributes (_("Date"), renderer, 
@@ -739,7 +616,19 @@ item_list_view_create (gboolean wide)
 	g_object_set (column, "resizable", TRUE, NULL);
 	if (wide) {
 		gtk_tree_view_column_set_visible (column, FALSE);
-		ilv->priv->wideView = TRUE;
+	} else {
+		/* Size the date column by the widest of sample dates in
+		   each of the date formats as rows are not measured */
+		static const guint sampleDays[] = { 0, 1, 3, 8, 400 };
+		guint i;
+		gint width = 0;
+
+		for (i = 0; i < G_N_ELEMENTS (sampleDays); i++) {
+			gchar *sample = date_format (time (NULL) - sampleDays[i] * 24 * 60 * 60, NULL);
+			width = MAX (width, get_cell_renderer_width (GTK_WIDGET (ilv->priv->treeview), renderer, sample, PANGO_WEIGHT_BOLD));
+			g_free (sample);
+		}
+		item_list_view_column_set_fixed (column, width + 8);
 	}
 
 	renderer = gtk_cell_renderer_pixbuf_new ();
@@ -747,6 +636,8 @@ item_list_view_create (gboolean wide)
 	gtk_tree_view_column_set_sort_column_id (column, IS_SOURCE);
 	gtk_tree_view_append_column (ilv->priv->treeview, column);
 	ilv->priv->faviconColumn = column;
+	if (!wide)
+		item_list_view_column_set_fixed (column, iconWidth + 8);
 	
 	renderer = gtk_cell_renderer_text_new ();
 	headline_column = gtk_tree_view_column_new_with_attributes (_("Headline"), renderer, 
@@ -762,6 +653,13 @@ item_list_view_create (gboolean wide)
 	} else {
 		g_object_set (renderer, "ellipsize", PANGO_ELLIPSIZE_END, NULL);
 		gtk_tree_view_column_add_attribute (headline_column, renderer, "weight", ITEMSTORE_WEIGHT);
+		item_list_view_column_set_fixed (headline_column, 0);
+		gtk_tree_view_column_set_expand (headline_column, TRUE);
+
+		/* With all rows having the same height GTK only needs to
+		   fetch the visible rows from the lazy loading model. The
+		   wide view wraps headlines and cannot use this. */
+		gtk_tree_view_set_fixed_height_mode (ilv->priv->treeview, TRUE);
 	}
 
 	/* And connect signals */
@@ -778,61 +676,16 @@ item_list_view_create (gboolean wide)
 	return ilv;
 }
 
-static void
-item_list_view_add_item_to_tree_store (ItemListView *ilv, GtkTreeStore *itemstore, itemPtr item)
-{
-	gint		state = 0;
-	nodePtr		node;
-	GtkTreeIter	*iter;
-	GtkTreeIter	old_iter;
-	gboolean	exists;
-		
-	if (item->flagStatus)
-		state += 2;
-	if (!item->readStatus)
-		state += 1;
-		
-	node = node_from_id (item->nodeId);
-	if(!node)
-		return;	/* comment items do cause this... maybe filtering them earlier would be a good idea... */
-		
-	exists = item_list_view_id_to_iter (ilv, item->id, &old_iter);
-	iter = &old_iter;
-	
-	if (!exists) 
-	{
-		iter = g_new0 (GtkTreeIter, 1);
-		gtk_tree_store_prepend (itemstore, iter, NULL);
-		g_hash_table_insert (ilv->priv->item_id_to_iter, GUINT_TO_POINTER (item->id), (gpointer)iter);
-	}
-
-	gtk_tree_store_set (itemstore, iter,
-		                       IS_TIME, (guint64)item->time,
-		                       IS_NR, item->id,
-				       IS_PARENT, node,
-		                       IS_FAVICON, ilv->priv->wideView?node_get_large_icon (node):node_get_icon (node),
-		                       IS_ENCICON, item->hasEnclosure?icon_get (ICON_ENCLOSURE):NULL,
-				       IS_ENCLOSURE, item->hasEnclosure,
-				       IS_SOURCE, node,
-				       IS_STATE, state,
-		                       -1);		                       
-}
-
 void 
 item_list_view_add_item (ItemListView *ilv, itemPtr item)
 {
-	GtkTreeStore	*itemstore;
-
 	if (ilv->priv->batch_mode) {
-		/* either merge to new unattached GtkTreeStore */
-		item_list_view_add_item_to_tree_store (ilv, ilv->priv->batch_itemstore, item);
+		/* either append to new unattached model and sort later */
+		item_list_model_append_item (ilv->priv->batch_model, item);
 	} else {
-		/* or merge to visible item store */	
-		itemstore = GTK_TREE_STORE (gtk_tree_view_get_model (ilv->priv->treeview));
-		item_list_view_add_item_to_tree_store (ilv, itemstore, item);
+		/* or merge to visible model at the sorted position */
+		item_list_model_insert_item (item_list_view_get_model (ilv), item);
 	}
-	
-	item_list_view_update_item (ilv, item);
 }
 
 void
@@ -973,13 +826,14 @@ item_list_view_find_unread_item (ItemListView *ilv, gulong startId)
 	else
 		valid = gtk_tree_model_get_iter_first (model, &iter);
 	
+	/* Check the unread state using the model to avoid loading each item */
 	while (valid) {
-		itemPtr	item = item_load (item_list_view_iter_to_id (ilv, &iter));
-		if (item) {
-			if (!item->readStatus)
-				return item;
-			item_unload (item);
-		}
+		guint	state = 0;
+
+		gtk_tree_model_get (model, &iter, IS_STATE, &state, -1);
+		if (state & 1)
+			return item_load_light (item_list_view_iter_to_id (ilv, &iter));
+
 		valid = gtk_tree_model_iter_next (model, &iter);
 	}
 
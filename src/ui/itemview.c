@@ -152,6 +152,9 @@ itemview_class_init (ItemViewClass *klass)
 void
 itemview_clear (void) 
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	item_list_view_clear (itemview->priv->itemListView);
 	htmlview_clear ();
 	enclosure_list_view_hide (itemview->priv->enclosureView);
@@ -173,6 +176,9 @@ itemview_set_mode (itemViewMode mode)
 void
 itemview_set_displayed_node (nodePtr node)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	if (node == itemview->priv->node)
 		return;
 		
@@ -188,6 +194,9 @@ itemview_set_displayed_node (nodePtr node)
 void
 itemview_add_item (itemPtr item)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	itemview->priv->hasEnclosures |= item->hasEnclosure;
 
 	if (ITEMVIEW_ALL_ITEMS != itemview->priv->mode)
@@ -203,6 +212,9 @@ itemview_add_item (itemPtr item)
 void
 itemview_remove_item (itemPtr item)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	if (!item_list_view_contains_id (itemview->priv->itemListView, item->id))
 		return;
 
@@ -249,6 +261,9 @@ itemview_select_enclosure (guint position)
 void
 itemview_update_item (itemPtr item)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	/* Always update the GtkTreeView (bail-out done in ui_itemlist_update_item() */
 	if (ITEMVIEW_ALL_ITEMS != itemview->priv->mode)
 		item_list_view_update_item (itemview->priv->itemListView, item);
@@ -282,6 +297,9 @@ itemview_update_item (itemPtr item)
 void
 itemview_update_all_items (void)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	/* Always update the GtkTreeView (bail-out done in ui_itemlist_update_item() */
 	if (ITEMVIEW_ALL_ITEMS != itemview->priv->mode)
 		item_list_view_update_all_items (itemview->priv->itemListView);
@@ -293,6 +311,9 @@ itemview_update_all_items (void)
 void
 itemview_update_node_info (nodePtr node)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	/* Bail if we do internal browsing, and no item is shown */
 	if (itemview->priv->browsing)
 		return;
@@ -313,6 +334,9 @@ itemview_update_node_info (nodePtr node)
 void
 itemview_update (void)
 {
+	if (!itemview)
+		return;	/* running headless */
+
 	item_list_view_update (itemview->priv->itemListView, itemview->priv->hasEnclosures);
 	
 	if (itemview->priv->node) {
@@ -479,7 +479,8 @@ liferea_shell_set_status_bar (const char *format, ...)
 	va_list		args;
 	gchar		*text;
 	
-	if (shell->priv->statusbarLocked)
+	/* No status bar when running headless */
+	if (!shell || shell->priv->statusbarLocked)
 		return;
 
 	g_return_if_fail (format != NULL);
@@ -497,6 +498,9 @@ liferea_shell_set_important_status_bar (const char *format, ...)
 	va_list		args;
 	gchar		*text;
 	
+	if (!shell)
+		return;
+
 	g_return_if_fail (format != NULL);
 
 	va_start (args, format);
@@ -1433,6 +1437,9 @@ liferea_shell_toggle_visibility (void)
 GtkWidget *
 liferea_shell_get_window (void)
 {
+	if (!shell)
+		return NULL;
+
 	return GTK_WIDGET (shell->priv->window);
 }
 
@@ -30,6 +30,7 @@
 
 #include <libpeas/peas-extension-set.h>
 
+#include <glib/gstdio.h>
 #include <unistd.h>
 #include <stdio.h>
 #include <sys/wait.h>
@@ -50,6 +51,17 @@ static GAsyncQueue *pendingHighPrioJobs = NULL;
 static GAsyncQueue *pendingJobs = NULL;
 static guint numberOfActiveJobs = 0;
 #define MAX_ACTIVE_JOBS	5
+static guint maxActiveJobs = MAX_ACTIVE_JOBS;
+
+/* Hosts failing this often in a row are parked, so that their
+   requests do not block update slots waiting for timeouts. The
+   parking time doubles with every failed probe. */
+#define HOST_FAILURE_THRESHOLD	3
+#define HOST_BACKOFF_MIN	60		/* seconds */
+#define HOST_BACKOFF_MAX	(6 * 60 * 60)	/* seconds */
+
+static GHashTable *failingHosts = NULL;	/**< interned host name -> updateHost */
+static gulong postponedCount = 0;
 
 /* update state interface */
 
@@ -101,6 +113,35 @@ update_state_set_cookies (updateStatePtr state, const gchar *cookies)
 		state->cookies = g_strdup (cookies);
 }
 
+guint64
+update_state_get_content_hash (updateStatePtr state)
+{
+	return state->contentHash;
+}
+
+void
+update_state_set_content_hash (updateStatePtr state, guint64 contentHash)
+{
+	state->contentHash = contentHash;
+}
+
+guint64
+update_state_hash_content (const gchar *data, gsize length)
+{
+	guint64	hash = G_GUINT64_CONSTANT (14695981039346656037);	/* 64 bit FNV-1a */
+	gsize	i;
+
+	for (i = 0; i < length; i++) {
+		hash ^= (guchar)data[i];
+		hash *= G_GUINT64_CONSTANT (1099511628211);
+	}
+
+	/* Mix in the length and keep 0 for "no hash" */
+	hash ^= length;
+
+	return hash?hash:1;
+}
+
 updateStatePtr
 update_state_copy (updateStatePtr state)
 {
@@ -110,6 +151,7 @@ update_state_copy (updateStatePtr state)
 	update_state_set_lastmodified (newState, update_state_get_lastmodified (state));
 	update_state_set_cookies (newState, update_state_get_cookies (state));
 	update_state_set_etag (newState, update_state_get_etag (state));
+	update_state_set_content_hash (newState, update_state_get_content_hash (state));
 	
 	return newState;
 }
@@ -145,6 +187,7 @@ update_request_free (updateRequestPtr request)
 	g_free (request->postdata);
 	g_free (request->source);
 	g_free (request->filtercmd);
+	g_free (request->spoolId);
 	g_free (request);
 }
 
@@ -197,6 +240,7 @@ update_options_copy (updateOptionsPtr options)
 	newOptions->username = g_strdup (options->username);
 	newOptions->password = g_strdup (options->password);
 	newOptions->dontUseProxy = options->dontUseProxy;
+	newOptions->maxSize = options->maxSize;
 	
 	return newOptions;
 }
@@ -231,6 +275,7 @@ update_job_new (gpointer owner,
 	job->user_data = user_data;
 	job->flags = flags;	
 	job->state = REQUEST_STATE_INITIALIZED;
+	job->host = network_get_host (request->source);
 	
 	return job;
 }
@@ -487,6 +532,275 @@ update_job_run (updateJobPtr job)
 	}
 }
 
+/* update result spool
+
+   Successful results of requests with a spool id are written to
+   the cache before they are processed, and removed after the result
+   processing callback returned, i.e. after the results were stored
+   in the DB. So results still waiting for processing when Liferea is
+   stopped (or crashes) are not lost. They are passed to the next
+   request with the same spool id instead of downloading again.
+
+   Every result consists of a body file and a state key file. The
+   state file is written last and marks the result as complete. So
+   the spool costs a body write and an unlink per successful download
+   of changed content.
+
+   Before a result is replayed the attempt is recorded in the state
+   file. A result that was replayed before and is still spooled made
+   Liferea crash or stop while processing it, so it is dropped
+   instead of being replayed on every start. */
+
+#define SPOOL_GROUP		"result"
+#define SPOOL_MAX_ATTEMPTS	1	/* replays of a spooled result */
+
+static void
+update_spool_get_filenames (const gchar *id, gchar **stateFile, gchar **bodyFile)
+{
+	*stateFile = common_create_cache_filename ("spool", id, "state");
+	*bodyFile = common_create_cache_filename ("spool", id, "body");
+}
+
+static void
+update_spool_write (updateJobPtr job)
+{
+	updateResultPtr	result = job->result;
+	GKeyFile	*keyFile;
+	GError		*error = NULL;
+	gchar		*stateFile, *bodyFile, *data;
+	gsize		length;
+
+	update_spool_get_filenames (job->request->spoolId, &stateFile, &bodyFile);
+
+	if (g_file_set_contents (bodyFile, result->data, result->size, &error)) {
+		keyFile = g_key_file_new ();
+		g_key_file_set_integer (keyFile, SPOOL_GROUP, "httpstatus", result->httpstatus);
+		g_key_file_set_int64 (keyFile, SPOOL_GROUP, "lastModified", update_state_get_lastmodified (result->updateState));
+		if (result->source)
+			g_key_file_set_string (keyFile, SPOOL_GROUP, "source", result->source);
+		if (result->contentType)
+			g_key_file_set_string (keyFile, SPOOL_GROUP, "contentType", result->contentType);
+		if (update_state_get_etag (result->updateState))
+			g_key_file_set_string (keyFile, SPOOL_GROUP, "etag", update_state_get_etag (result->updateState));
+
+		data = g_key_file_to_data (keyFile, &length, NULL);
+		if (g_file_set_contents (stateFile, data, length, &error))
+			job->spooled = TRUE;
+		g_free (data);
+		g_key_file_free (keyFile);
+	}
+
+	if (error) {
+		g_warning ("Could not spool update result of %s: %s", job->request->source, error->message);
+		g_error_free (error);
+		g_unlink (bodyFile);
+	}
+
+	g_free (stateFile);
+	g_free (bodyFile);
+}
+
+/* Returns TRUE if the result of the job is to be spooled. Content
+   that is unchanged since the last update (see feed_process_update_result())
+   is not, as it won't be stored anyway. The hash is passed on in the
+   result update state to not calculate it twice. */
+static gboolean
+update_spool_needed (updateJobPtr job)
+{
+	updateResultPtr	result = job->result;
+	guint64		contentHash;
+
+	if (!job->request->spoolId || !result->data ||
+	    result->httpstatus < 200 || result->httpstatus >= 300)
+		return FALSE;
+
+	/* The post filter may change the content, a delta is never complete */
+	if (job->request->filtercmd || 226 == result->httpstatus || !job->request->updateState)
+		return TRUE;
+
+	contentHash = update_state_hash_content (result->data, result->size);
+	update_state_set_content_hash (result->updateState, contentHash);
+
+	if (contentHash == update_state_get_content_hash (job->request->updateState)) {
+		debug1 (DEBUG_UPDATE, "not spooling unchanged content (%s)", job->request->source);
+		return FALSE;
+	}
+
+	return TRUE;
+}
+
+/* Loads a spooled result into the job. Returns FALSE if there is none. */
+static gboolean
+update_spool_read (updateJobPtr job)
+{
+	updateResultPtr	result = job->result;
+	GKeyFile	*keyFile;
+	gchar		*stateFile, *bodyFile, *tmp, *data;
+	gsize		length;
+	gint		attempts;
+
+	if (!job->request->spoolId)
+		return FALSE;
+
+	update_spool_get_filenames (job->request->spoolId, &stateFile, &bodyFile);
+
+	keyFile = g_key_file_new ();
+	if (!g_key_file_load_from_file (keyFile, stateFile, G_KEY_FILE_NONE, NULL)) {
+		g_key_file_free (keyFile);
+		g_free (stateFile);
+		g_free (bodyFile);
+		return FALSE;
+	}
+
+	attempts = g_key_file_get_integer (keyFile, SPOOL_GROUP, "attempts", NULL);
+	if (attempts >= SPOOL_MAX_ATTEMPTS) {
+		g_warning ("Dropping spooled update result of %s, processing it failed before", job->request->source);
+		update_spool_remove (job->request->spoolId);
+	} else if (g_file_get_contents (bodyFile, &result->data, &result->size, NULL)) {
+		/* Record the attempt before the result is processed */
+		g_key_file_set_integer (keyFile, SPOOL_GROUP, "attempts", attempts + 1);
+		data = g_key_file_to_data (keyFile, &length, NULL);
+		if (!g_file_set_contents (stateFile, data, length, NULL))
+			g_warning ("Could not update spool state file %s!", stateFile);
+		g_free (data);
+
+		result->returncode = 0;
+		result->httpstatus = g_key_file_get_integer (keyFile, SPOOL_GROUP, "httpstatus", NULL);
+		result->source = g_key_file_get_string (keyFile, SPOOL_GROUP, "source", NULL);
+		result->contentType = g_key_file_get_string (keyFile, SPOOL_GROUP, "contentType", NULL);
+		update_state_set_lastmodified (result->updateState, g_key_file_get_int64 (keyFile, SPOOL_GROUP, "lastModified", NULL));
+		tmp = g_key_file_get_string (keyFile, SPOOL_GROUP, "etag", NULL);
+		update_state_set_etag (result->updateState, tmp);
+		g_free (tmp);
+		job->spooled = TRUE;
+	}
+	g_key_file_free (keyFile);
+
+	g_free (stateFile);
+	g_free (bodyFile);
+
+	return job->spooled;
+}
+
+void
+update_spool_remove (const gchar *id)
+{
+	gchar	*stateFile, *bodyFile;
+
+	update_spool_get_filenames (id, &stateFile, &bodyFile);
+	g_unlink (stateFile);
+	g_unlink (bodyFile);
+	g_free (stateFile);
+	g_free (bodyFile);
+}
+
+GSList *
+update_spool_get_ids (void)
+{
+	const gchar	*filename;
+	gchar		*path;
+	GSList		*ids = NULL;
+	GDir		*dir;
+
+	path = g_build_filename (g_get_user_cache_dir (), "liferea", "spool", NULL);
+	dir = g_dir_open (path, 0, NULL);
+	if (dir) {
+		while ((filename = g_dir_read_name (dir))) {
+			if (g_str_has_suffix (filename, ".state"))
+				ids = g_slist_prepend (ids, g_strndup (filename, strlen (filename) - strlen (".state")));
+		}
+		g_dir_close (dir);
+	}
+	g_free (path);
+
+	return ids;
+}
+
+/* host health tracking */
+
+/* Returns FALSE if the host of the job is parked. Lets a single
+   job through as a probe when the parking time is over, or when
+   the user explicitly requested the update. */
+static gboolean
+update_host_check (updateJobPtr job)
+{
+	updateHostPtr	host;
+
+	if (!job->host || !failingHosts)
+		return TRUE;
+
+	host = g_hash_table_lookup (failingHosts, job->host);
+	if (!host || !host->retryTime)
+		return TRUE;
+
+	/* Updates requested by the user always get through */
+	if (!(job->flags & FEED_REQ_PRIORITY_HIGH) &&
+	    (host->probing || g_get_monotonic_time () < host->retryTime))
+		return FALSE;
+
+	debug1 (DEBUG_UPDATE, "probing parked host %s", job->host);
+	host->probing = TRUE;
+
+	return TRUE;
+}
+
+static void
+update_host_record_result (updateJobPtr job)
+{
+	updateHostPtr	host = NULL;
+	guint		shift;
+
+	if (!job->host || NETWORK_ERROR_HOST_UNAVAILABLE == job->result->returncode)
+		return;
+
+	if (!failingHosts)
+		failingHosts = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+	host = g_hash_table_lookup (failingHosts, job->host);
+	if (host)
+		host->probing = FALSE;
+
+	/* Jobs cancelled before being sent have no result at all */
+	if (!job->result->returncode && !job->result->httpstatus)
+		return;
+
+	if (!network_is_host_failure (job->result->returncode, job->result->httpstatus)) {
+		/* Cancelled probes or proxy errors keep the host parked */
+		if (host && network_is_host_response (job->result->returncode, job->result->httpstatus) &&
+		    g_hash_table_remove (failingHosts, job->host))
+			debug1 (DEBUG_UPDATE, "host %s works again", job->host);
+		return;
+	}
+
+	if (!host) {
+		host = g_new0 (struct updateHost, 1);
+		g_hash_table_insert (failingHosts, (gpointer)job->host, host);
+	}
+
+	host->failures++;
+	if (host->failures < HOST_FAILURE_THRESHOLD)
+		return;
+
+	shift = MIN (host->failures - HOST_FAILURE_THRESHOLD, 10);
+	host->retryTime = g_get_monotonic_time () + MIN ((gint64)HOST_BACKOFF_MIN << shift, HOST_BACKOFF_MAX) * G_USEC_PER_SEC;
+	debug2 (DEBUG_UPDATE, "parking host %s after %u failures", job->host, host->failures);
+}
+
+GHashTable *
+update_get_failing_hosts (void)
+{
+	if (!failingHosts)
+		failingHosts = g_hash_table_new_full (g_direct_hash, g_direct_equal, NULL, g_free);
+
+	return failingHosts;
+}
+
+gulong
+update_get_postponed_count (void)
+{
+	return postponedCount;
+}
+
 static gboolean
 update_dequeue_job (gpointer user_data)
 {
@@ -495,7 +809,7 @@ update_dequeue_job (gpointer user_data)
 	if (!pendingJobs)
 		return FALSE;	/* we must be in shutdown */
 		
-	if (numberOfActiveJobs >= MAX_ACTIVE_JOBS) 
+	if (numberOfActiveJobs >= maxActiveJobs) 
 		return FALSE;	/* we'll be called again when a job finishes */
 	
 
@@ -510,10 +824,19 @@ update_dequeue_job (gpointer user_data)
 	numberOfActiveJobs++;
 
 	job->state = REQUEST_STATE_PROCESSING;
+	job->startTime = g_get_monotonic_time ();
 
 	debug1 (DEBUG_UPDATE, "processing request (%s)", job->request->source);
 	if (job->callback == NULL) {
 		update_process_finished_job (job);
+	} else if (update_spool_read (job)) {
+		debug1 (DEBUG_UPDATE, "using spooled result (%s)", job->request->source);
+		update_process_finished_job (job);
+	} else if (!update_host_check (job)) {
+		debug1 (DEBUG_UPDATE, "postponing request for parked host %s", job->host);
+		postponedCount++;
+		job->result->returncode = NETWORK_ERROR_HOST_UNAVAILABLE;
+		update_process_finished_job (job);
 	} else {
 		update_job_run (job);
 	}
@@ -559,6 +882,31 @@ update_job_cancel_by_owner (gpointer owner)
 	}
 }
 
+void
+update_set_max_active_jobs (guint count)
+{
+	maxActiveJobs = MAX (1, count);
+}
+
+gboolean
+update_jobs_finished (void)
+{
+	return (NULL == jobs);
+}
+
+void
+update_get_job_counts (guint *queued, guint *active)
+{
+	*queued = 0;
+	*active = numberOfActiveJobs;
+
+	if (!pendingJobs)
+		return;	/* we must be in shutdown */
+
+	*queued = MAX (0, g_async_queue_length (pendingJobs)) +
+	          MAX (0, g_async_queue_length (pendingHighPrioJobs));
+}
+
 static gboolean
 update_process_result_idle_cb (gpointer user_data)
 {
@@ -567,6 +915,10 @@ update_process_result_idle_cb (gpointer user_data)
 	if (job->callback)
 		(job->callback) (job->result, job->user_data, job->flags);
 
+	/* The results are stored now */
+	if (job->spooled)
+		update_spool_remove (job->request->spoolId);
+
 	update_job_free (job);
 		
 	return FALSE;
@@ -584,10 +936,22 @@ update_process_finished_job (updateJobPtr job)
 	/* Handling abandoned requests (e.g. after feed deletion) */
 	if (job->callback == NULL) {	
 		debug1 (DEBUG_UPDATE, "freeing cancelled request (%s)", job->request->source);
+		if (job->spooled)
+			update_spool_remove (job->request->spoolId);
+		else
+			update_host_record_result (job);
 		update_job_free (job);
 		return;
 	} 
 
+	/* Spooled results were checked and written when downloaded */
+	if (!job->spooled) {
+		update_host_record_result (job);
+
+		if (update_spool_needed (job))
+			update_spool_write (job);
+	}
+
 	/* Finally execute the postfilter */
 	if (job->result->data && job->request->filtercmd) 
 		update_apply_filter (job);
@@ -617,6 +981,10 @@ update_deinit (void)
 
 	g_async_queue_unref (pendingJobs);
 	g_async_queue_unref (pendingHighPrioJobs);
+
+	if (failingHosts)
+		g_hash_table_destroy (failingHosts);
+	failingHosts = NULL;
 	
 	g_slist_free (jobs);
 	jobs = NULL;
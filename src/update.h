@@ -71,6 +71,7 @@ typedef struct updateOptions {
 	gchar		*username;	/**< username for HTTP auth */
 	gchar		*password;	/**< password for HTTP auth */
 	gboolean	dontUseProxy;	/**< no proxy flag */
+	guint		maxSize;	/**< download size limit in kB (0 for the default) */
 } *updateOptionsPtr;
 
 /** defines all state data an updatable object (e.g. a feed) needs */
@@ -80,6 +81,7 @@ typedef struct updateState {
 	GTimeVal	lastFaviconPoll;	/**< time at which the feeds favicon was last updated */
 	gchar		*cookies;		/**< cookies to be used */	
 	gchar		*etag;			/**< ETag sent by the server */
+	guint64		contentHash;		/**< hash of the last processed content (or 0) */
 } *updateStatePtr;
 
 /** structure describing a HTTP update request */
@@ -94,6 +96,8 @@ typedef struct updateRequest {
 	updateOptionsPtr options;	/**< Update options for the request */
 	gchar		*filtercmd;	/**< Command will filter output of URL */
 	updateStatePtr	updateState;	/**< Update state of the requested object (etags, last modified...) */
+	gboolean	expectFeed;	/**< TRUE if downloads not looking like a feed are to be aborted */
+	gchar		*spoolId;	/**< if set, successful results are spooled under this id until processed */
 } *updateRequestPtr;
 
 /** structure to store results of the processing of an update request */
@@ -120,8 +124,18 @@ typedef struct updateJob {
 	gpointer		user_data;	/**< result processing user data */
 	updateFlags		flags;		/**< request and result processing flags */
 	gint			state;		/**< State of the job (enum request_state) */
+	gint64			startTime;	/**< monotonic time the processing started */
+	const gchar		*host;		/**< interned host name for HTTP requests (or NULL) */
+	gboolean		spooled;	/**< TRUE if the result is stored in the spool */
 } *updateJobPtr;
 
+/** health of a host with failing update requests */
+typedef struct updateHost {
+	guint		failures;	/**< number of consecutive failures */
+	gint64		retryTime;	/**< monotonic time the parked host may be probed (0 if not parked) */
+	gboolean	probing;	/**< TRUE while a probe request is running */
+} *updateHostPtr;
+
 /**
  * Creates a new update state structure 
  *
@@ -138,6 +152,21 @@ void update_state_set_etag (updateStatePtr state, const gchar *etag);
 const gchar * update_state_get_cookies (updateStatePtr state);
 void update_state_set_cookies (updateStatePtr state, const gchar *cookies);
 
+guint64 update_state_get_content_hash (updateStatePtr state);
+void update_state_set_content_hash (updateStatePtr state, guint64 contentHash);
+
+/**
+ * Calculates the hash of downloaded content to be stored with
+ * update_state_set_content_hash(). Used to detect unchanged
+ * content when the server does not support conditional requests.
+ *
+ * @param data		the content
+ * @param length	length of the content
+ *
+ * @returns the hash (never 0)
+ */
+guint64 update_state_hash_content (const gchar *data, gsize length);
+
 /**
  * Copies the given update state.
  *
@@ -267,4 +296,65 @@ void update_job_cancel_by_owner (gpointer owner);
  */
 gint update_job_get_state (updateJobPtr job);
 
+/**
+ * Sets the number of update jobs processed at the same time.
+ * The default suits interactive use, where the user should not
+ * notice the update processing.
+ *
+ * @param count		maximum number of active jobs
+ */
+void update_set_max_active_jobs (guint count);
+
+/**
+ * Checks whether all update jobs are done, including the
+ * processing of their results.
+ *
+ * @returns TRUE if there are no jobs
+ */
+gboolean update_jobs_finished (void);
+
+/**
+ * Returns the number of update jobs waiting to be processed
+ * and the number of jobs currently processed.
+ *
+ * @param queued	returns the number of pending jobs
+ * @param active	returns the number of active jobs
+ */
+void update_get_job_counts (guint *queued, guint *active);
+
+/**
+ * Returns the spool ids of all results which were downloaded
+ * but not processed before the last shutdown. Requests with
+ * the same spool id get the spooled result instead of downloading
+ * again.
+ *
+ * @returns list of spool ids (to be free'd using g_slist_free_full())
+ */
+GSList * update_spool_get_ids (void);
+
+/**
+ * Drops the spooled result with the given spool id.
+ *
+ * @param id		the spool id
+ */
+void update_spool_remove (const gchar *id);
+
+/**
+ * Returns the health of all hosts whose last update requests
+ * failed. Hosts with too many consecutive failures are parked:
+ * their requests fail at once until the retry time, when a single
+ * request is let through to probe the host.
+ *
+ * @returns hash of interned host names to updateHostPtr (owned by the update code)
+ */
+GHashTable * update_get_failing_hosts (void);
+
+/**
+ * Returns the number of update requests not sent since
+ * startup, because their host was parked.
+ *
+ * @returns number of postponed requests
+ */
+gulong update_get_postponed_count (void);
+
 #endif
@@ -22,6 +22,7 @@
 
 #include "db.h"
 #include "debug.h"
+#include "item_header.h"
 #include "itemset.h"
 #include "node.h"
 #include "vfolder.h"
@@ -42,16 +43,23 @@ vfolder_loader_fetch_cb (gpointer user_data, GSList **resultItems)
 	vfolder->loadOffset += VFOLDER_LOADER_BATCH_SIZE;
 
 	if (result) {
-		/* 2. Match all items against search folder */
+		/* 2. Match all items against search folder. Use the item
+		      headers to avoid loading items that can't match. */
+		item_header_prefetch_list (items->ids);
+
 		iter = items->ids;
 		while (iter) {
-			gulong id = GPOINTER_TO_UINT (iter->data);
+			gulong		id = GPOINTER_TO_UINT (iter->data);
+			itemHeaderPtr	header = item_header_get (id);
+			gboolean	decided;
 
-			itemPtr	item = db_item_load (id);
-			if (itemset_check_item (vfolder->itemset, item))
-				*resultItems = g_slist_append (*resultItems, item);
-			else
-				item_unload (item);
+			if (header && itemset_check_item_header (vfolder->itemset, header, &decided)) {
+				itemPtr	item = item_load_light (id);
+				if (item && (decided || itemset_check_item (vfolder->itemset, item)))
+					*resultItems = g_slist_append (*resultItems, item);
+				else if (item)
+					item_unload (item);
+			}
 
 			iter = g_list_next (iter);
 		}
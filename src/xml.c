@@ -28,6 +28,8 @@
 #include <libxml/xmlerror.h>
 #include <libxml/uri.h>
 #include <libxml/parser.h>
+#include <libxml/parserInternals.h>
+#include <libxml/dict.h>
 #include <libxml/entities.h>
 #include <libxml/HTMLparser.h>
 #include <libxml/xpath.h>
@@ -222,70 +224,236 @@ xhtml_is_well_formed (const gchar *data)
 	return result;
 }
 
-static GSList *dhtml_strippers = NULL;
-static GSList *unsupported_tag_strippers = NULL;
+/* Single pass HTML sanitizer
 
-static void
-xhtml_stripper_add (GSList **strippers, const gchar *pattern)
+   Instead of running a chain of regular expressions over the HTML (each
+   pass allocating a full copy) the HTML is tokenized once. Text and
+   comments are copied as they are, tags are checked by name and their
+   attributes are only rewritten if an event handler attribute (any
+   attribute starting with "on") is found. */
+
+#define XHTML_STRIP_DHTML	(1<<0)	/**< strip script, iframe, meta and all on* attributes */
+#define XHTML_STRIP_UNSUPPORTED	(1<<1)	/**< strip wbr and body tags */
+
+static gboolean
+xhtml_sanitize_tag_is (const gchar *name, gsize len, const gchar *tag)
+{
+	return (strlen (tag) == len) && (0 == g_ascii_strncasecmp (name, tag, len));
+}
+
+/* Returns TRUE if the given attribute name is an event handler. As
+   new events keep being added to browsers every attribute starting
+   with "on" is treated as one, including harmless ones like "one". */
+static gboolean
+xhtml_sanitize_is_event_handler (const gchar *name, gsize len)
+{
+	return (len > 2) && (0 == g_ascii_strncasecmp (name, "on", 2));
+}
+
+/* Scans the attributes of a tag starting after the tag name up
+   to the closing '>'. If out is given all attributes except event
+   handlers are copied to it. Returns the position of the '>' or
+   NULL for an unterminated tag. Sets *handlers to TRUE if event
+   handler attributes were found. */
+static const gchar *
+xhtml_sanitize_attributes (const gchar *p, GString *out, gboolean *handlers)
+{
+	while (*p) {
+		const gchar	*start = p, *name;
+		gsize		nameLen;
+
+		while (g_ascii_isspace (*p))
+			p++;
+
+		if ('>' == *p) {
+			if (out)
+				g_string_append_len (out, start, p - start);
+			return p;
+		}
+
+		name = p;
+		while (*p && !g_ascii_isspace (*p) && '=' != *p && '>' != *p && '/' != *p)
+			p++;
+		nameLen = p - name;
+
+		if (0 == nameLen) {
+			/* stray character like the '/' of "<br/>" */
+			if (!*p)
+				return NULL;
+			p++;
+		} else {
+			const gchar *value = p;
+
+			while (g_ascii_isspace (*value))
+				value++;
+
+			if ('=' == *value) {
+				value++;
+				while (g_ascii_isspace (*value))
+					value++;
+
+				if ('"' == *value || '\'' == *value) {
+					gchar quote = *value++;
+
+					value = strchr (value, quote);
+					if (!value)
+						return NULL;
+					value++;
+				} else {
+					while (*value && !g_ascii_isspace (*value) && '>' != *value)
+						value++;
+				}
+				p = value;
+			}
+
+			if (xhtml_sanitize_is_event_handler (name, nameLen)) {
+				*handlers = TRUE;
+				continue;	/* drop event handler */
+			}
+		}
+
+		if (out)
+			g_string_append_len (out, start, p - start);
+	}
+
+	return NULL;
+}
+
+/* Returns the position after the closing tag of the given element
+   or NULL if there is none. */
+static const gchar *
+xhtml_sanitize_skip_element (const gchar *p, const gchar *name, gsize len)
 {
-	GError *err = NULL;
-	GRegex *expr;
-	
-	expr = g_regex_new (pattern, G_REGEX_CASELESS | G_REGEX_UNGREEDY | G_REGEX_DOTALL | G_REGEX_OPTIMIZE, 0, &err);
-	if (err) {
-		g_warning ("xhtml_strip_setup: %s\n", err->message);
-		g_error_free (err);
-		return;
+	while ((p = strchr (p, '<'))) {
+		const gchar *q = p + 1;
+
+		if ('/' == *q) {
+			q++;
+			while (g_ascii_isspace (*q))
+				q++;
+			if (0 == g_ascii_strncasecmp (q, name, len) && !g_ascii_isalnum (q[len])) {
+				q = strchr (q + len, '>');
+				return q?q + 1:NULL;
+			}
+		}
+		p = q;
 	}
-	*strippers = g_slist_append (*strippers, expr);
+
+	return NULL;
 }
 
 static gchar *
-xhtml_strip (const gchar *html, GSList *strippers)
+xhtml_sanitize_internal (const gchar *html, guint flags)
 {
-	gchar *result = g_strdup (html);
-	GSList *iter = strippers;
-	
-	while (iter) {
-		GError *err = NULL;
-		GRegex *expr = (GRegex *)iter->data;
-		gchar *tmp = result;
-		result = g_regex_replace (expr, tmp, -1, 0, "", 0, &err);
-		if (err) {
-			g_warning ("xhtml_strip: %s\n", err->message);
-			g_error_free (err);
-			err = NULL;
+	const gchar	*p = html, *lt;
+	GString		*out;
+
+	if (!html)
+		return NULL;
+
+	out = g_string_sized_new (strlen (html));
+
+	while ((lt = strchr (p, '<'))) {
+		const gchar	*name, *end, *q;
+		gsize		len;
+		gboolean	closing = FALSE, handlers = FALSE, dangerous;
+
+		g_string_append_len (out, p, lt - p);
+		p = lt + 1;
+
+		/* comments are copied unchanged */
+		if (g_str_has_prefix (p, "!--")) {
+			end = strstr (p + 3, "-->");
+			end = end?end + 3:p + strlen (p);
+			g_string_append_len (out, lt, end - lt);
+			p = end;
+			continue;
+		}
+
+		q = p;
+		if ('/' == *q) {
+			closing = TRUE;
+			q++;
+		}
+		while (g_ascii_isspace (*q))
+			q++;
+
+		name = q;
+		while (g_ascii_isalnum (*q) || ':' == *q || '-' == *q || '_' == *q)
+			q++;
+		len = q - name;
+
+		if (0 == len) {
+			/* no tag: a stray '<', a doctype or a processing instruction */
+			g_string_append_c (out, '<');
+			continue;
+		}
+
+		dangerous = xhtml_sanitize_tag_is (name, len, "script") ||
+		            xhtml_sanitize_tag_is (name, len, "iframe") ||
+		            xhtml_sanitize_tag_is (name, len, "meta");
+
+		end = xhtml_sanitize_attributes (q, NULL, &handlers);
+		if (!end) {
+			/* Unterminated tag at the end of the document, most
+			   likely just text like "a<b". Keep it if harmless. */
+			if (!((flags & XHTML_STRIP_DHTML) && (dangerous || handlers)))
+				g_string_append (out, lt);
+			p = NULL;
+			break;
+		}
+		p = end + 1;
+
+		if (dangerous && (flags & XHTML_STRIP_DHTML)) {
+			if (!xhtml_sanitize_tag_is (name, len, "meta")) {
+				/* drop the element including its content, for a
+				   missing end tag drop everything that follows */
+				if (!closing && '/' != *(end - 1)) {
+					p = xhtml_sanitize_skip_element (p, name, len);
+					if (!p)
+						break;
+				}
+			}
+			continue;
+		}
+
+		if (flags & XHTML_STRIP_UNSUPPORTED) {
+			if (xhtml_sanitize_tag_is (name, len, "wbr") ||
+			    xhtml_sanitize_tag_is (name, len, "body"))
+				continue;
+		}
+
+		if (handlers && (flags & XHTML_STRIP_DHTML)) {
+			g_string_append_len (out, lt, q - lt);
+			xhtml_sanitize_attributes (q, out, &handlers);
+			g_string_append_c (out, '>');
+		} else {
+			g_string_append_len (out, lt, p - lt);
 		}
-		g_free (tmp);
-		iter = g_slist_next (iter);
 	}
 
-	return result;
+	if (p && *p)
+		g_string_append (out, p);
+
+	return g_string_free (out, FALSE);
+}
+
+gchar *
+xhtml_sanitize (const gchar *html)
+{
+	return xhtml_sanitize_internal (html, XHTML_STRIP_DHTML | XHTML_STRIP_UNSUPPORTED);
 }
 
 gchar *
 xhtml_strip_dhtml (const gchar *html)
 {
-	if (!dhtml_strippers) {
-		xhtml_stripper_add (&dhtml_strippers, "\\s+onload='[^']+'");
-		xhtml_stripper_add (&dhtml_strippers, "\\s+onload=\"[^\"]+\"");
-		xhtml_stripper_add (&dhtml_strippers, "<\\s*script\\s*>.*</\\s*script\\s*>");
-		xhtml_stripper_add (&dhtml_strippers, "<\\s*meta\\s*>.*</\\s*meta\\s*>");
-		xhtml_stripper_add (&dhtml_strippers, "<\\s*iframe[^>]*\\s*>.*</\\s*iframe\\s*>");
-	}
-	
-	return xhtml_strip (html, dhtml_strippers);
+	return xhtml_sanitize_internal (html, XHTML_STRIP_DHTML);
 }
 
 gchar *
 xhtml_strip_unsupported_tags (const gchar *html)
 {
-	if (!unsupported_tag_strippers) {
-		xhtml_stripper_add(&unsupported_tag_strippers, "<\\s*/?wbr[^>]*/?\\s*>");
-		xhtml_stripper_add(&unsupported_tag_strippers, "<\\s*/?body[^>]*/?\\s*>");
-	}
-	
-	return xhtml_strip(html, unsupported_tag_strippers);
+	return xhtml_sanitize_internal (html, XHTML_STRIP_UNSUPPORTED);
 }
 
 typedef struct {
@@ -511,6 +679,26 @@ xml_get_ns_attribute (xmlNodePtr node, const gchar *name, const gchar *namespace
 	return xmlGetNsProp (node, BAD_CAST name, BAD_CAST namespace);
 }
 
+/* Dictionary with the names known to the parsers. Each document gets
+   its own dictionary on top of it, so unknown names are freed together
+   with the document while known names resolve to the shared copy. */
+static xmlDictPtr names = NULL;
+
+static xmlDictPtr
+xml_get_names (void)
+{
+	if (!names)
+		names = xmlDictCreate ();
+
+	return names;
+}
+
+const xmlChar *
+xml_intern_name (const gchar *name)
+{
+	return xmlDictLookup (xml_get_names (), BAD_CAST name, -1);
+}
+
 xmlDocPtr
 xml_parse (gchar *data, size_t length, errorCtxtPtr errCtx)
 {
@@ -519,13 +707,25 @@ xml_parse (gchar *data, size_t length, errorCtxtPtr errCtx)
 	
 	g_assert (NULL != data);
 
-	ctxt = xmlNewParserCtxt ();
+	ctxt = xmlCreateMemoryParserCtxt (data, length);
+	if (!ctxt)
+		return NULL;
+
 	ctxt->sax->getEntity = xml_process_entities;
+	xmlDictFree (ctxt->dict);
+	ctxt->dict = xmlDictCreateSub (xml_get_names ());
+	ctxt->dictNames = 1;
 	
 	if (errCtx)
 		xmlSetGenericErrorFunc (errCtx, (xmlGenericErrorFunc)xml_buffer_parse_error);
 	
-	doc = xmlSAXParseMemory (ctxt->sax, data, length, 0);
+	xmlParseDocument (ctxt);
+	doc = ctxt->myDoc;
+	ctxt->myDoc = NULL;
+	if (doc && !ctxt->wellFormed) {
+		xmlFreeDoc (doc);
+		doc = NULL;
+	}
 	
 	/* This seems to reset the errorfunc to its default, so that the
 	   GtkHTML2 module is not unhappy because it also tries to call the
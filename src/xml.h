@@ -78,7 +78,21 @@ gchar * xhtml_extract_from_string (const gchar *html, const gchar *nodeBase);
 gchar * xhtml_extract (xmlNodePtr cur, gint xhtmlMode, const gchar *defaultBase);
 
 /**
- * Strips some DHTML constructs from the given HTML string.
+ * Sanitizes HTML for rendering in a single pass. Strips scripts,
+ * iframes, meta tags and all attributes starting with "on" (see
+ * xhtml_strip_dhtml()) as well as tags we do not want to render
+ * (see xhtml_strip_unsupported_tags()).
+ *
+ * @param html	some HTML content
+ *
+ * @return newly allocated sanitized HTML string
+ */
+gchar * xhtml_sanitize (const gchar *html);
+
+/**
+ * Strips scripts, iframes, meta tags and event handler attributes
+ * from the given HTML string. Every attribute starting with "on" is
+ * stripped, so that unknown and future event handlers are removed too.
  *
  * @param html	some HTML content
  *
@@ -169,6 +183,21 @@ typedef struct errorCtxt {
  */
 xmlDocPtr xml_parse (gchar *data, size_t length, errorCtxtPtr errors);
 
+/**
+ * Returns the interned copy of an element or attribute name.
+ *
+ * All documents returned by xml_parse() intern their names in a
+ * dictionary derived from the one used here. So a node name can
+ * be compared to the result by pointer instead of with xmlStrcmp().
+ * Names should be interned once at startup, as the dictionary is
+ * shared by all parsed documents and never shrinks.
+ *
+ * @param name		the name to intern
+ *
+ * @return interned name, owned by the dictionary
+ */
+const xmlChar * xml_intern_name (const gchar *name);
+
 /**
  * Common function to create a XML DOM object from a given
  * XML buffer. This function sets up a parser context